@@ -0,0 +1,88 @@
+#! /usr/bin/env python
+
+# Compare the hits of two km3sim outputs of the same input, one with full
+# tracking of the EM showers and one with --em-param, OM by OM (the hits
+# of the 31 PMTs of a DOM summed up) and in time.
+
+import sys
+from optparse import OptionParser
+
+parser = OptionParser(usage="%prog [options] FULL.evt PARAM.evt")
+parser.add_option("--pmts-per-om", dest="pmts_per_om", type="int", default=31, help="PMTs in one optical module. [default = %default]")
+parser.add_option("--tbin", dest="tbin", type="float", default=10., help="Width (ns) of the time bins. [default = %default]")
+parser.add_option("--tmax", dest="tmax", type="float", default=1000., help="Last time (ns) after the first hit of the event. [default = %default]")
+parser.add_option("--min-pe", dest="min_pe", type="float", default=10., help="Only OMs with at least this many pe in the full run are listed. [default = %default]")
+
+(opt, args) = parser.parse_args()
+if len(args) != 2:
+  parser.print_help()
+  exit(1)
+
+
+def read_hits(filename):
+  # pe per OM and pe per time bin, the time relative to the first hit
+  # of each event
+  om_pe = {}
+  time_pe = [0.] * int(opt.tmax / opt.tbin)
+  nevents = 0
+  event_hits = []
+
+  def close_event():
+    if not event_hits:
+      return
+    t0 = min(t for (pe, t) in event_hits)
+    for (pe, t) in event_hits:
+      ibin = int((t - t0) / opt.tbin)
+      if ibin < len(time_pe):
+        time_pe[ibin] += pe
+    del event_hits[:]
+
+  for line in open(filename):
+    fields = line.split()
+    if not fields:
+      continue
+    if fields[0] == "start_event:":
+      close_event()
+      nevents += 1
+    elif fields[0] == "hit:":
+      pmt = int(fields[2])
+      pe = float(fields[3])
+      t = float(fields[4])
+      om = (pmt - 1) // opt.pmts_per_om
+      om_pe[om] = om_pe.get(om, 0.) + pe
+      event_hits.append((pe, t))
+  close_event()
+  return nevents, om_pe, time_pe
+
+
+def chi2(a, b):
+  # two sample chi2 of histograms with (nearly) poisson contents
+  value = 0.
+  ndf = 0
+  for (x, y) in zip(a, b):
+    if x + y > 0:
+      value += (x - y) ** 2 / (x + y)
+      ndf += 1
+  return value, ndf
+
+
+nfull, om_full, time_full = read_hits(args[0])
+nparam, om_param, time_param = read_hits(args[1])
+if nfull != nparam:
+  print " **** different number of events: %d and %d **** " % (nfull, nparam)
+
+total_full = sum(om_full.values())
+total_param = sum(om_param.values())
+print "events %d, total pe full %.1f param %.1f ratio %.4f" % (nfull, total_full, total_param, total_param / max(total_full, 1.))
+
+print "%8s %12s %12s %8s" % ("om", "full", "param", "ratio")
+for om in sorted(om_full.keys()):
+  if om_full[om] < opt.min_pe:
+    continue
+  print "%8d %12.1f %12.1f %8.3f" % (om + 1, om_full[om], om_param.get(om, 0.), om_param.get(om, 0.) / om_full[om])
+
+oms = sorted(set(om_full.keys()) | set(om_param.keys()))
+value, ndf = chi2([om_full.get(om, 0.) for om in oms], [om_param.get(om, 0.) for om in oms])
+print "pe per om:   chi2/ndf %.1f/%d" % (value, ndf)
+value, ndf = chi2(time_full, time_param)
+print "time of hits: chi2/ndf %.1f/%d" % (value, ndf)
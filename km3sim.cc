@@ -4,6 +4,7 @@
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <stdexcept>
 
 #include "G4RunManager.hh"
 #include "G4UImanager.hh"
@@ -19,6 +20,18 @@
 #include "KM3SteppingAction.h"
 #include "KM3EventAction.h"
 #include "KM3Detector.h"
+#include "KM3MappedFile.h"
+#include "KM3TableBuilder.h"
+#include "KM3ShowerLibrary.h"
+#include "KM3EmitterFile.h"
+#include "KM3Reweighter.h"
+#include "KM3PMTResponse.h"
+#include "KM3Digitizer.h"
+#include "KM3Background.h"
+#include "KM3Trigger.h"
+#include "KM3HitsFile.h"
+#include "KM3EvtIndex.h"
+#include "KM3Checkpoint.h"
 
 /** How to make a simple main:
  *
@@ -64,29 +77,204 @@
  * ENABLE_MIE = True
  * DISABLE_PARAM = True
  * MYFIT_PARAM = False
- * EM_PARAM = False
- * MUON_PARAM = False
- * HA_PARAM = False
- * HAMUON_PARAM = False
+ *
+ * EM_PARAM, HA_PARAM and HAMUON_PARAM are now the --em-param and
+ * --ha-param, --ha-muons options, MUON_PARAM the --muon-param and
+ * --delta-param options. --shower-library replays recorded EM showers
+ * instead of the EM_PARAM tables. --write-emitters and --read-emitters
+ * split a run in the particle and the light stages. --extended-hits and
+ * --max-qe keep what km3sim reweight needs to change the water and the
+ * quantum efficiency afterwards. --pmt-tts and --pmt-efficiencies
+ * apply the transit time spread and the efficiency of every PMT to the
+ * hits, --background adds the K40 hits and --digitize writes their
+ * pulses. --trigger drops the hits of the events the trigger would not
+ * keep. --hits-file writes the hits in compressed columns,
+ * --write-threads formats those of the OUTFILE in parallel. The evt
+ * files can be gzip compressed (see KM3CompressedStream).
+ * --first-event and --nevents run a part of INFILE through its event
+ * index, with --event-seeds for the same events as in one run.
+ * --checkpoint and --resume let a killed job go on where it stopped
  */
 
 static const char USAGE[] =
     R"(km3sim.
 
   Usage:
-    km3sim [--seed=<sd>] -p PARAMS -d DETECTOR -i INFILE -o OUTFILE
+    km3sim [options] -p PARAMS -d DETECTOR -i INFILE -o OUTFILE
+    km3sim [options] -p PARAMS -d DETECTOR --build-table=<file>
+    km3sim [options] -p PARAMS -d DETECTOR -i INFILE --record-library=<file>
+    km3sim convert-table LAYOUT TABLEIN TABLEOUT
+    km3sim merge-table [--threads=<n>] TABLEOUT PARTIAL...
+    km3sim merge-library LIBOUT LIBIN...
+    km3sim reweight [--downsample] [--seed=<sd>] NEWPARAMS EVTIN EVTOUT
+    km3sim convert-hits EVTIN HITSIN EVTOUT
     km3sim (-h | --help)
     km3sim --version
 
   Options:
-    -i INFILE         Input .evt file (e.g. from gSeaGen)
-    -o OUTFILE        Output .evt file (for JTE)
-    -p PARAMS         File with physics (seawater etc.) input parameters.
-    -d DETECTOR       File with detector geometry.
-    -h --help         Show this screen.
-    --seed=<sd>       Set the RNG seed [default: 42].
-    --version         Display the current version.
-    --no-mie          Disable mie scattering [default: false]
+    -i INFILE           Input .evt file (e.g. from gSeaGen), plain or gzip
+                        compressed
+    -o OUTFILE          Output .evt file (for JTE), gzip compressed if the
+                        name ends in .gz
+    -p PARAMS           File with physics (seawater etc.) input parameters.
+    -d DETECTOR         File with detector geometry.
+    -h --help           Show this screen.
+    LAYOUT              Blocks of a raw parametrization table: em, ha or muon.
+    PARTIAL             Histograms saved by --build-table. They are summed
+                        per particle and energy, the particles are written
+                        in the order they first appear.
+    LIBIN               Shower libraries saved by --record-library or
+                        merge-library.
+    NEWPARAMS           Parameter file the hits of EVTIN, written with
+                        --extended-hits, are reweighted to. Every hit gets
+                        a hit_weight word.
+    HITSIN              Hits file written with --hits-file, whose hits and
+                        muon truth are put back into EVTIN, the OUTFILE of
+                        the same run.
+    --downsample        Keep the photons of every hit with the probability
+                        of their weight instead, e.g. to go from a --max-qe
+                        run to a lower quantum efficiency.
+    --threads=<n>       Threads normalizing the merged tables, 0 for one
+                        per core [default: 0].
+    --seed=<sd>         Set the RNG seed [default: 42].
+    --first-event=<n>   Number in INFILE, from 0, of the first event to
+                        simulate [default: 0].
+    --nevents=<n>       Number of events to simulate, all the ones after
+                        --first-event if not given.
+    --input-index=<file>
+                        Index of the events of INFILE instead of
+                        INFILE.idx. It is built if missing or out of date.
+    --event-seeds       Seed every event from --seed and its number in
+                        INFILE, so that the jobs of a run split with
+                        --first-event get the events of a single run.
+    --checkpoint=<file> Record in <file> how far the run got, every
+                        --checkpoint-interval, with the events done written
+                        out. Implies --event-seeds.
+    --checkpoint-interval=<s>
+                        Seconds between the checkpoints [default: 600].
+    --resume            Go on from the checkpoint, if there is one: OUTFILE
+                        is cut back to it and the next events appended. The
+                        other options must be those of the first job.
+    --can=<shape>       Volume used to cull particles and light: cylinder,
+                        hull (convex hull of the strings) or blocks (one
+                        cylinder per group of strings) [default: cylinder].
+    --block-gap=<m>     Largest string spacing (m) inside one block
+                        [default: 200].
+    --stacking=<file>   Per particle thresholds and stages overriding the
+                        default stacking policy.
+    --pool-retain=<MB>  Track memory (MB) kept from one event to the next
+                        [default: 256].
+    --em-param=<file>   EM shower parametrization tables. When given, e+, e-
+                        and gamma showers are replaced by sampled hits.
+    --em-threshold=<GeV>
+                        Lowest energy (GeV) of a parametrized EM shower
+                        [default: 1].
+    --shower-library=<file>
+                        Library of recorded EM showers. When given, e+, e-
+                        and gamma showers are replaced by the photons of
+                        library showers, which are then propagated.
+    --library-threshold=<GeV>
+                        Lowest energy (GeV) of a replayed EM shower
+                        [default: 1].
+    --ha-param=<file>   Hadronic shower parametrization tables. When given,
+                        hadronic showers are replaced by sampled hits.
+    --ha-threshold=<GeV>
+                        Lowest energy (GeV) of a parametrized hadronic
+                        shower [default: 10].
+    --ha-muons=<file>   Library of the muons from hadronic showers, added to
+                        the parametrized showers. The index is <file>.idx
+                        unless given with --ha-muons-index.
+    --ha-muons-index=<file>
+                        Index of the muon library.
+    --delta-param=<file>
+                        Muon parametrization tables. When given, the muon
+                        delta rays below --delta-cut are not tracked and
+                        their light is sampled along the muons instead.
+    --muon-param=<file> Muon parametrization tables. When given, the
+                        primary muons create no Cherenkov photons and their
+                        light is sampled along each step instead.
+    --delta-cut=<MeV>   Lowest energy (MeV) of a tracked muon delta ray
+                        [default: 100].
+    --build-table=<file>
+                        Instead of a normal run, inject the particles below
+                        and save the histograms of the photons for the
+                        parametrization tables. The injected events are
+                        written to <file>.evt.
+    --build-particle=<pdg>
+                        PDG code of the injected particles [default: 11].
+    --build-energy=<GeV>
+                        Kinetic energy (GeV) of the injected particles
+                        [default: 100].
+    --build-events=<n>  Number of injected particles [default: 1000].
+    --build-vertex=<xyz>
+                        Position (m) of the injected particles
+                        [default: 0,0,0].
+    --record-library=<file>
+                        Instead of a normal run, record the photons of the
+                        INFILE events into a shower library. Every event
+                        must have one e-, e+ or gamma, e.g. the <file>.evt
+                        written by --build-table.
+    --realisations=<n>  Number of times the photons of every event are
+                        generated, propagated and detected over the same
+                        charged particles. Every realisation is written
+                        as a copy of the event with its own hits and a
+                        realisation tag [default: 1].
+    --write-emitters=<file>
+                        First stage of a split run: track the particles of
+                        INFILE and save their Cherenkov emitting segments
+                        instead of generating photons. OUTFILE gets the
+                        events without hits.
+    --read-emitters=<file>
+                        Second stage of a split run: generate, propagate
+                        and detect the photons of the segments saved by
+                        --write-emitters, with INFILE the OUTFILE of the
+                        first stage. Only the events the first stage
+                        completed are simulated, and only the light from
+                        within its can, which has to hold the detector.
+    --extended-hits     Write the wavelength, path length, Mie scatters and
+                        the water lengths of every detected photon as
+                        hit_photon words, for km3sim reweight.
+    --max-qe            Let the photons pass the highest quantum
+                        efficiency of the cathods at every wavelength, to
+                        be downsampled to the real curve. Implies
+                        --extended-hits.
+    --pmt-tts=<ns>      Gaussian sigma (ns) of the transit time spread of
+                        the PMTs, 0 for none [default: 0].
+    --pmt-efficiencies=<file>
+                        Efficiencies of the PMTs, lines of the pmt id of
+                        the detector file and the efficiency. The hits of
+                        a PMT are thinned, or duplicated above 1.
+    --digitize          Write the time-over-threshold pulses of the PMTs
+                        as hit_raw words instead of the photoelectrons,
+                        without a separate OmSim pass.
+    --pulse-model=<file>
+                        Threshold, gain spread and time-over-threshold
+                        curve of the pulses, overriding the defaults of
+                        --digitize.
+    --background        Add the K40 and dark count hits of the PMTs, singles
+                        and coincidences within the DOMs, around the hits
+                        of every event.
+    --background-model=<file>
+                        Rates and time window of the background, overriding
+                        the defaults of --background.
+    --hits-file=<file>  Write the hits and the muon truth to a compressed
+                        columnar file instead of OUTFILE, which keeps the
+                        rest of the events. km3sim convert-hits makes the
+                        evt file of the run.
+    --write-threads=<n> Threads formatting the hits of the events with
+                        more than 100000 of them [default: 1].
+    --trigger           Emulate the trigger on the hits of every event: L1s
+                        of the DOMs, then enough DOMs with an L1 within a
+                        window. Every event gets a trigger word.
+    --trigger-model=<file>
+                        Windows and multiplicities of the trigger,
+                        overriding the defaults of --trigger.
+    --untriggered=<mode>
+                        What is written of an event that does not trigger:
+                        full, summary (no hits) or nothing
+                        [default: summary].
+    --version           Display the current version.
+    --no-mie            Disable mie scattering [default: false]
 )";
 
 int main(int argc, const char **argv)
@@ -94,13 +282,186 @@ int main(int argc, const char **argv)
   std::map<std::string, docopt::value> args =
     docopt::docopt(USAGE, {argv + 1, argv + argc}, true, "KM3Sim 2.0");
 
+  // add the header of the mappable format to a raw table and stop
+  if (args["convert-table"].asBool()) {
+    KM3MappedFile::Convert(args["LAYOUT"].asString(),
+                           args["TABLEIN"].asString(),
+                           args["TABLEOUT"].asString());
+    return 0;
+  }
+  // sum the histograms of table building jobs into a table and stop
+  if (args["merge-table"].asBool()) {
+    KM3TableBuilder::Merge(args["PARTIAL"].asStringList(),
+                           args["TABLEOUT"].asString(),
+                           args["--threads"].asLong());
+    return 0;
+  }
+  // put the showers of many libraries in one and stop
+  if (args["merge-library"].asBool()) {
+    KM3ShowerRecorder::Merge(args["LIBIN"].asStringList(),
+                             args["LIBOUT"].asString());
+    return 0;
+  }
+  // weights or downsamples the hits of a run for other parameters and stop
+  if (args["reweight"].asBool()) {
+    CLHEP::HepRandom::setTheSeed(args["--seed"].asLong());
+    KM3Reweighter aReweighter(args["NEWPARAMS"].asString());
+    aReweighter.Run(args["EVTIN"].asString(), args["EVTOUT"].asString(),
+                    args["--downsample"].asBool());
+    return 0;
+  }
+  // puts the hits of a hits file back into the evt file and stop
+  if (args["convert-hits"].asBool()) {
+    KM3HitsReader::Convert(args["EVTIN"].asString(), args["HITSIN"].asString(),
+                           args["EVTOUT"].asString());
+    return 0;
+  }
+  G4int Realisations = args["--realisations"].asLong();
+  if (Realisations < 1)
+    G4Exception("--realisations must be at least 1", "", FatalException, "");
+  if ((Realisations > 1) &&
+      (args["--em-param"] || args["--ha-param"] || args["--delta-param"] ||
+       args["--muon-param"] || args["--shower-library"] ||
+       args["--build-table"] || args["--record-library"]))
+    G4Exception("--realisations needs the full simulation of the light", "",
+                FatalException, "");
+  if ((args["--write-emitters"] || args["--read-emitters"]) &&
+      (args["--em-param"] || args["--ha-param"] || args["--delta-param"] ||
+       args["--muon-param"] || args["--shower-library"] ||
+       args["--build-table"] || args["--record-library"]))
+    G4Exception("Emitter files need the full simulation of the light", "",
+                FatalException, "");
+  if (args["--write-emitters"] && args["--read-emitters"])
+    G4Exception("--write-emitters and --read-emitters are two stages", "",
+                FatalException, "");
+  if (args["--write-emitters"] && (Realisations > 1))
+    G4Exception("--realisations belongs to the --read-emitters stage", "",
+                FatalException, "");
+  if (args["--write-emitters"] &&
+      (args["--trigger"].asBool() || args["--background"].asBool() ||
+       args["--digitize"].asBool()))
+    G4Exception("The hits are made in the --read-emitters stage", "",
+                FatalException, "");
+  G4bool ExtendedHits =
+      args["--extended-hits"].asBool() || args["--max-qe"].asBool();
+  if (ExtendedHits &&
+      (args["--em-param"] || args["--ha-param"] || args["--delta-param"] ||
+       args["--muon-param"] || args["--shower-library"]))
+    G4Exception("Extended hits need the full simulation of the light", "",
+                FatalException, "");
+  if (args["--digitize"].asBool() && ExtendedHits)
+    G4Exception("--digitize writes no photons for the extended hits", "",
+                FatalException, "");
+  if (args["--pulse-model"] && !args["--digitize"].asBool())
+    G4Exception("--pulse-model needs --digitize", "", FatalException, "");
+  if (args["--background-model"] && !args["--background"].asBool())
+    G4Exception("--background-model needs --background", "", FatalException,
+                "");
+  if (args["--trigger-model"] && !args["--trigger"].asBool())
+    G4Exception("--trigger-model needs --trigger", "", FatalException, "");
+  if (args["--write-threads"].asLong() < 1)
+    G4Exception("--write-threads must be at least 1", "", FatalException, "");
+  if (args["--resume"].asBool() && !args["--checkpoint"])
+    G4Exception("--resume needs --checkpoint", "", FatalException, "");
+  if (args["--checkpoint"] &&
+      (args["--hits-file"] || args["--build-table"] ||
+       args["--record-library"] || args["--write-emitters"] ||
+       args["--read-emitters"]))
+    G4Exception("Only the runs writing an evt file can be checkpointed", "",
+                FatalException, "");
+  if (args["--hits-file"] && ExtendedHits)
+    G4Exception("--hits-file has no columns for the extended hits", "",
+                FatalException, "");
+  if (args["--em-param"] && args["--shower-library"])
+    G4Exception("--em-param and --shower-library cannot be used together", "",
+                FatalException, "");
+
   G4long myseed = args["--seed"].asLong();
   CLHEP::HepRandom::setTheSeed(myseed);
 
   std::string Geometry_File = args["-d"].asString();
   std::string Parameter_File = args["-p"].asString();
-  std::string infile_evt = args["-i"].asString();
-  std::string outfile_evt = args["-o"].asString();
+  std::string infile_evt;
+  std::string outfile_evt;
+  KM3TableBuilder *builder = NULL;
+  KM3ShowerRecorder *recorder = NULL;
+  if (args["--build-table"]) {
+    // the builder writes the events it injects, the hits are not kept
+    builder = new KM3TableBuilder;
+    builder->Particle = args["--build-particle"].asLong();
+    builder->Energy =
+        std::stod(args["--build-energy"].asString()) * CLHEP::GeV;
+    G4double x, y, z;
+    if (sscanf(args["--build-vertex"].asString().c_str(), "%lf,%lf,%lf", &x,
+               &y, &z) != 3)
+      G4Exception("Error reading the vertex of the injected particles", "",
+                  FatalException, "");
+    builder->Vertex = G4ThreeVector(x, y, z) * CLHEP::m;
+    infile_evt = args["--build-table"].asString() + ".evt";
+    outfile_evt = "/dev/null";
+    builder->WriteInjectionFile(infile_evt, args["--build-events"].asLong());
+  } else if (args["--record-library"]) {
+    // only the photons of the showers are kept
+    recorder = new KM3ShowerRecorder(args["--record-library"].asString());
+    infile_evt = args["-i"].asString();
+    outfile_evt = "/dev/null";
+  } else {
+    infile_evt = args["-i"].asString();
+    outfile_evt = args["-o"].asString();
+  }
+  // the events of the run, found through the index of the input file
+  std::string IndexFile = infile_evt + ".idx";
+  if (args["--input-index"]) IndexFile = args["--input-index"].asString();
+  KM3EvtIndex *EvtIndex = new KM3EvtIndex(infile_evt, IndexFile);
+  G4int FirstEvent = args["--first-event"].asLong();
+  if ((FirstEvent < 0) ||
+      ((FirstEvent > 0) && (FirstEvent >= EvtIndex->GetNumberOfEvents())))
+    G4Exception("--first-event is not an event of the input file", "",
+                FatalException, "");
+  G4int NumberOfEvents = EvtIndex->GetNumberOfEvents() - FirstEvent;
+  if (args["--nevents"]) {
+    if (args["--nevents"].asLong() < 0)
+      G4Exception("--nevents cannot be negative", "", FatalException, "");
+    if (args["--nevents"].asLong() < NumberOfEvents)
+      NumberOfEvents = args["--nevents"].asLong();
+  }
+  std::streamoff FirstEventOffset = 0;
+  if (FirstEvent > 0) FirstEventOffset = EvtIndex->GetOffset(FirstEvent);
+  delete EvtIndex;
+
+  // a resumed run does the events after its checkpoint
+  KM3Checkpoint *checkpoint = NULL;
+  std::streamoff ResumeOffset = -1;
+  if (args["--checkpoint"]) {
+    checkpoint = new KM3Checkpoint(args["--checkpoint"].asString());
+    G4double interval = 0.0;
+    try {
+      interval = std::stod(args["--checkpoint-interval"].asString());
+    } catch (const std::exception &) {
+      interval = 0.0;
+    }
+    // one gzip member per event would also come with a zero interval
+    if (!(interval > 0.0))
+      G4Exception("--checkpoint-interval must be a number of seconds above 0",
+                  "", FatalException, "");
+    checkpoint->Interval = interval;
+    if (args["--resume"].asBool() && checkpoint->Read()) {
+      G4int done = checkpoint->NextEvent - FirstEvent;
+      if ((done < 0) || (done > NumberOfEvents))
+        G4Exception("The checkpoint is not one of this run", "",
+                    FatalException, "");
+      FirstEvent = checkpoint->NextEvent;
+      NumberOfEvents -= done;
+      if ((NumberOfEvents > 0) && (checkpoint->InputOffset <= 0))
+        G4Exception("The checkpoint has no offset in the input file", "",
+                    FatalException, "");
+      if (NumberOfEvents > 0) FirstEventOffset = checkpoint->InputOffset;
+      ResumeOffset = checkpoint->OutputOffset;
+    }
+    checkpoint->FirstEvent = FirstEvent;
+    checkpoint->NextEvent = FirstEvent;
+  }
+
   G4double ParamEnergy;
   //G4int ParamNumber;
   G4int ParamParticle;
@@ -120,7 +481,16 @@ int main(int argc, const char **argv)
   // EvtIO->WriteRunHeader()
   // EvtIO->WriteEvent()
   std::cout << "Open evt files..." << std::endl;
-  KM3EvtIO *TheEVTtoWrite = new KM3EvtIO(infile_evt, outfile_evt);
+  KM3EvtIO *TheEVTtoWrite =
+      new KM3EvtIO(infile_evt, outfile_evt, ResumeOffset);
+  KM3HitsWriter *HitsWriter = NULL;
+  if (args["--hits-file"]) {
+    HitsWriter = new KM3HitsWriter(args["--hits-file"].asString());
+    TheEVTtoWrite->SetHitsWriter(HitsWriter);
+  }
+  TheEVTtoWrite->SetFormatThreads(args["--write-threads"].asLong());
+  TheEVTtoWrite->SetFirstEventOffset(FirstEventOffset);
+  if (args["--read-emitters"]) TheEVTtoWrite->SetReplaceInputHits(true);
 
   G4RunManager *runManager = new G4RunManager;
 
@@ -128,6 +498,82 @@ int main(int argc, const char **argv)
   KM3Detector *Mydet = new KM3Detector;
   Mydet->Geometry_File = Geometry_File;
   Mydet->Parameter_File = Parameter_File;
+  Mydet->CanShape = args["--can"].asString();
+  Mydet->BlockGap = std::stod(args["--block-gap"].asString()) * CLHEP::m;
+  if (args["--em-param"]) Mydet->EMParamFile = args["--em-param"].asString();
+  Mydet->EMThreshold =
+      std::stod(args["--em-threshold"].asString()) * CLHEP::GeV;
+  if (args["--shower-library"])
+    Mydet->ShowerLibraryFile = args["--shower-library"].asString();
+  Mydet->LibraryThreshold =
+      std::stod(args["--library-threshold"].asString()) * CLHEP::GeV;
+  Mydet->ShowerRecorder = recorder;
+  Mydet->Realisations = Realisations;
+  Mydet->ExtendedHits = ExtendedHits;
+  Mydet->MaxQE = args["--max-qe"].asBool();
+  Mydet->PMTResponse->TTS =
+      std::stod(args["--pmt-tts"].asString()) * CLHEP::ns;
+  if (Mydet->PMTResponse->TTS < 0.0)
+    G4Exception("--pmt-tts cannot be negative", "", FatalException, "");
+  if (args["--pmt-efficiencies"])
+    Mydet->PMTEfficiencyFile = args["--pmt-efficiencies"].asString();
+  KM3Digitizer *digitizer = NULL;
+  if (args["--digitize"].asBool()) {
+    digitizer = new KM3Digitizer;
+    if (args["--pulse-model"])
+      digitizer->ReadPulseModel(args["--pulse-model"].asString());
+  }
+  Mydet->Digitizer = digitizer;
+  KM3Background *background = NULL;
+  if (args["--background"].asBool()) {
+    background = new KM3Background;
+    background->RunSeed = myseed;
+    background->FirstEvent = FirstEvent;
+    if (args["--background-model"])
+      background->ReadModel(args["--background-model"].asString());
+  }
+  Mydet->Background = background;
+  KM3Trigger *trigger = NULL;
+  if (args["--trigger"].asBool()) {
+    trigger = new KM3Trigger;
+    if (args["--trigger-model"])
+      trigger->ReadModel(args["--trigger-model"].asString());
+    std::string untriggered = args["--untriggered"].asString();
+    if (untriggered == "full")
+      trigger->Mode = KM3Trigger::kFull;
+    else if (untriggered == "summary")
+      trigger->Mode = KM3Trigger::kSummary;
+    else if (untriggered == "nothing")
+      trigger->Mode = KM3Trigger::kNothing;
+    else
+      G4Exception("--untriggered must be full, summary or nothing", "",
+                  FatalException, "");
+  }
+  Mydet->Trigger = trigger;
+  KM3EmitterWriter *EmitterWriter = NULL;
+  KM3EmitterReader *EmitterReader = NULL;
+  if (args["--write-emitters"])
+    EmitterWriter = new KM3EmitterWriter(args["--write-emitters"].asString());
+  if (args["--read-emitters"])
+    EmitterReader = new KM3EmitterReader(args["--read-emitters"].asString());
+  Mydet->EmitterWriter = EmitterWriter;
+  Mydet->EmitterReader = EmitterReader;
+  TheEVTtoWrite->SetNumberOfRealisations(Realisations);
+  if (args["--ha-param"]) Mydet->HAParamFile = args["--ha-param"].asString();
+  Mydet->HAThreshold =
+      std::stod(args["--ha-threshold"].asString()) * CLHEP::GeV;
+  if (args["--ha-muons"]) {
+    Mydet->HAMuonsFile = args["--ha-muons"].asString();
+    Mydet->HAMuonsIndexFile = Mydet->HAMuonsFile + ".idx";
+    if (args["--ha-muons-index"])
+      Mydet->HAMuonsIndexFile = args["--ha-muons-index"].asString();
+  }
+  if (args["--delta-param"])
+    Mydet->DeltaParamFile = args["--delta-param"].asString();
+  if (args["--muon-param"])
+    Mydet->MuonParamFile = args["--muon-param"].asString();
+  Mydet->DeltaCut = std::stod(args["--delta-cut"].asString()) * CLHEP::MeV;
+  Mydet->TableBuilder = builder;
   runManager->SetUserInitialization(Mydet);
 
   std::cout << "Set physics processes..." << std::endl;
@@ -139,6 +585,12 @@ int main(int argc, const char **argv)
   runManager->SetNumberOfEventsToBeStored(0);
   KM3PrimaryGeneratorAction *myGeneratorAction = new KM3PrimaryGeneratorAction;
   myGeneratorAction->infile_evt = infile_evt;
+  myGeneratorAction->FirstEvent = FirstEvent;
+  myGeneratorAction->FirstEventOffset = FirstEventOffset;
+  myGeneratorAction->NumberOfEvents = NumberOfEvents;
+  myGeneratorAction->EventSeeds =
+      args["--event-seeds"].asBool() || (checkpoint != NULL);
+  myGeneratorAction->RunSeed = myseed;
   myGeneratorAction->idbeam = ParamParticle;
   myGeneratorAction->ParamEnergy = ParamEnergy;
   myGeneratorAction->useHEPEvt = useHEPEvt;
@@ -150,12 +602,24 @@ int main(int argc, const char **argv)
   // link between generator and tracking (to provide number of
   // initial particles to trackingAction
   myGeneratorAction->myTracking = myTracking;
+  myGeneratorAction->EmitterReader = EmitterReader;
   myGeneratorAction->Initialize();
+  // a first stage stopped early leaves fewer events in its emitter file
+  if ((EmitterReader != NULL) &&
+      (EmitterReader->GetNumberOfEvents() < myGeneratorAction->nevents))
+    myGeneratorAction->nevents = EmitterReader->GetNumberOfEvents();
   runManager->SetUserAction(myGeneratorAction);
 
   std::cout << "Call EventAction..." << std::endl;
   KM3EventAction *event_action = new KM3EventAction;
   event_action->TheEVTtoWrite = TheEVTtoWrite;
+  event_action->TrackPool.RetainSize =
+      std::stod(args["--pool-retain"].asString()) * 1024 * 1024;
+  event_action->TableBuilder = builder;
+  event_action->ShowerRecorder = recorder;
+  event_action->EmitterWriter = EmitterWriter;
+  if (checkpoint != NULL) checkpoint->TheEVTtoWrite = TheEVTtoWrite;
+  event_action->Checkpoint = checkpoint;
   myGeneratorAction->event_action = event_action;
   // generator knows event to set the number of initial particles
   runManager->SetUserAction(event_action);
@@ -166,6 +630,7 @@ int main(int argc, const char **argv)
   KM3StackingAction *myStacking = new KM3StackingAction;
   KM3SteppingAction *myStepping = new KM3SteppingAction;
   myStacking->SetDetector(Mydet);
+  if (args["--stacking"]) myStacking->PolicyFile = args["--stacking"].asString();
   myStepping->myStDetector = Mydet;
   myStepping->event_action = event_action;
   runManager->SetUserAction(myStacking);
@@ -188,8 +653,20 @@ int main(int argc, const char **argv)
   std::cout << "Start a run..." << std::endl;
   runManager->SetVerboseLevel(10);
   runManager->BeamOn(myGeneratorAction->nevents);
+  if (checkpoint != NULL) checkpoint->Save();
+  if (builder != NULL) builder->Save(args["--build-table"].asString());
+  if (recorder != NULL) recorder->Save();
 
   delete TheEVTtoWrite;
+  delete HitsWriter;
+  delete checkpoint;
+  delete builder;
+  delete recorder;
+  delete EmitterWriter;
+  delete EmitterReader;
+  delete digitizer;
+  delete background;
+  delete trigger;
 
   delete runManager;
   return 0;
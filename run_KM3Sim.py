@@ -113,10 +113,7 @@ if opt.job:
 #copy infile to local dir
 os.system("'cp' %s ./"%infile)
 infile  = os.path.split(infile)[1]
-#unzip it
-if infile[-3:]=='.gz':
-  os.system("gunzip -f %s"%infile)
-  infile = infile[:-3]
+#km3sim reads the .gz files itself, and compresses the output alike
 #copy the executable KM3Sim, the geometry and the parameter files to local dir
 #copy KM3Sim executable
 cmd = "'cp' "+os.path.join(os.environ['KM3SIM_PATH'],"KM3Sim")+" ./"
@@ -2,6 +2,9 @@
 #include "G4ExceptionHandler.hh"
 #include "G4OpMie.h"
 #include "G4ios.hh"
+#include "G4RunManager.hh"
+#include "KM3TrackInformation.h"
+#include "KM3TrackingAction.h"
 
 using CLHEP::pi;
 using CLHEP::twopi;
@@ -14,6 +17,8 @@ G4OpMie::G4OpMie(const G4String &processName, G4ProcessType type)
     G4cout << GetProcessName() << " is created " << G4endl;
   }
   thePhaseFactors = NULL;
+  CountScatters = false;
+  myTracking = NULL;
   BuildThePhysicsTable();
 }
 
@@ -32,6 +37,22 @@ G4VParticleChange *G4OpMie::PostStepDoIt(const G4Track &aTrack,
 
   const G4DynamicParticle *aParticle = aTrack.GetDynamicParticle();
 
+  if (CountScatters) {
+    // photons get their information at the first scatter, with the
+    // provenance KM3SD would take from the parent
+    KM3TrackInformation *info =
+        (KM3TrackInformation *)aTrack.GetUserInformation();
+    if (info == NULL) {
+      if (myTracking == NULL)
+        myTracking = (const KM3TrackingAction *)G4RunManager::GetRunManager()
+                         ->GetUserTrackingAction();
+      info = new KM3TrackInformation(
+          myTracking->GetProvenance(aTrack.GetParentID()));
+      aTrack.SetUserInformation(info);
+    }
+    info->Scatters++;
+  }
+
   if (verboseLevel > 0) {
     G4cout << "Scattering Photon!" << G4endl;
   }
@@ -18,6 +18,8 @@
 #include "G4PhysicsOrderedFreeVector.hh"
 #include <CLHEP/Units/SystemOfUnits.h>
 
+class KM3TrackingAction;
+
 struct PhaseFactors {
   double c0;
   double c1;
@@ -46,6 +48,10 @@ class G4OpMie : public G4VDiscreteProcess {
   G4VParticleChange *PostStepDoIt(const G4Track &aTrack, const G4Step &aStep);
   // This is the method implementing Mie scattering.
 
+  void SetCountScatters(G4bool state) { CountScatters = state; };
+  // Counts the scatters of every photon in its KM3TrackInformation, for
+  // the extended hit records.
+
  private:
   void BuildThePhysicsTable(void);
   G4double SampleAngle(void);
@@ -56,6 +62,8 @@ class G4OpMie : public G4VDiscreteProcess {
   std::vector<PhaseFactors *> *thePhaseFactors;
   CLHEP::RandGeneral *PhaseRand;
   G4double PhaseArray[1801];
+  G4bool CountScatters;
+  const KM3TrackingAction *myTracking;
 };
 
 inline G4bool G4OpMie::IsApplicable(const G4ParticleDefinition &aParticleType) {
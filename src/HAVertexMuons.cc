@@ -1,4 +1,5 @@
 #include "HAVertexMuons.h"
+#include <algorithm>
 
 HAVertexMuons::HAVertexMuons(char *MuonsFile, char *MuonsIndexFile) {
   // first open the index file
@@ -43,10 +44,9 @@ HAVertexMuons::~HAVertexMuons() {
 }
 
 G4int HAVertexMuons::GetNumberOfMuons(G4double HadronicEnergy) {
-  G4int iev;
-  for (iev = 0; iev < numevents; iev++) {
-    if (HadronicEnergy < (*theEnergies)[iev]) break;
-  }
+  // the library is ordered in energy
+  G4int iev = std::upper_bound(theEnergies->begin(), theEnergies->end(),
+                               HadronicEnergy) - theEnergies->begin();
   if (iev == numevents) iev--;
   if (iev < numevents - 1 && iev > 0) {
     if (HadronicEnergy - (*theEnergies)[iev - 1] <
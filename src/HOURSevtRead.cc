@@ -7,26 +7,33 @@ using CLHEP::ns;
 using CLHEP::cm;
 using CLHEP::m;
 
-HOURSevtRead::HOURSevtRead(std::string infilechar) {
-  infile.open(infilechar, std::ifstream::in);
+HOURSevtRead::HOURSevtRead(std::string infilechar,
+                           std::streamoff FirstEventOffset,
+                           int NumberOfEvents) {
+  infile.open(infilechar);
   evt = new seaweed::event();
   // read header
   int ierr = evt->read(infile);
-  // count events
-  nevents = 0;
+  // look at the first events
+  int nread = 0;
   isneutrinoevent = true;
   hasbundleinfo = true;
-  while (evt->read(infile) == 0) {
-    nevents++;
-    if (nevents < 10 && evt->ndat("neutrino") == 0) isneutrinoevent = false;
-    if (nevents < 10 && evt->ndat("track_bundle") == 0) hasbundleinfo = false;
+  while ((nread < 9) && (evt->read(infile) == 0)) {
+    nread++;
+    if (evt->ndat("neutrino") == 0) isneutrinoevent = false;
+    if (evt->ndat("track_bundle") == 0) hasbundleinfo = false;
   }
+  nevents = NumberOfEvents;
   // position to the beggining of the file
   infile.clear();
   infile.seekg(0, std::ios::beg);
 
   // read header again
   ierr = evt->read(infile);
+  if (FirstEventOffset > 0) {
+    infile.clear();
+    infile.seekg(FirstEventOffset);
+  }
 
   InitPDGTables();
 }
@@ -18,11 +18,15 @@
 #include <CLHEP/Units/SystemOfUnits.h>
 #include <CLHEP/Units/PhysicalConstants.h>
 #include "seaweed.h"
+#include "KM3CompressedStream.h"
 
 class HOURSevtRead {
  public:
   //HOURSevtRead(char *infile);
-  HOURSevtRead(std::string infile);
+  // the run starts at the event at FirstEventOffset (see KM3EvtIndex),
+  // the number of events is given rather than counted
+  HOURSevtRead(std::string infile, std::streamoff FirstEventOffset,
+               int NumberOfEvents);
   ~HOURSevtRead();
 
   int GetNumberOfEvents();
@@ -40,7 +44,7 @@ class HOURSevtRead {
  private:
   seaweed::event *evt;
   int nevents;
-  std::ifstream infile;
+  KM3InputStream infile;
   int ICONPDG[174];
   double PDGMASS[174];
   void InitPDGTables(void);
@@ -0,0 +1,149 @@
+#include "KM3Background.h"
+#include "KM3Cathods.h"
+#include "KM3Provenance.h"
+#include "G4ios.hh"
+#include "KM3Evaluator.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdint.h>
+
+using CLHEP::hertz;
+using CLHEP::kilohertz;
+using CLHEP::microsecond;
+using CLHEP::ns;
+
+KM3Background::KM3Background() {
+  RunSeed = 0;
+  FirstEvent = 0;
+  SinglesRate = 7.0 * kilohertz;
+  MultipleRates[2] = 500.0 * hertz;
+  MultipleRates[3] = 50.0 * hertz;
+  MultipleRates[4] = 5.0 * hertz;
+  TimeSpread = 2.0 * ns;
+  WindowBefore = 1.0 * microsecond;
+  WindowAfter = 9.0 * microsecond;
+}
+
+void KM3Background::ReadModel(const std::string &aFile) {
+  std::ifstream infile(aFile.c_str());
+  if (!infile.good())
+    G4Exception("Error opening the background model file", "", FatalException,
+                "");
+
+  KM3Evaluator fCalc(aFile);
+  G4int nline = 0;
+  G4bool MultiplesRead = false;
+  std::string line;
+  while (std::getline(infile, line)) {
+    nline++;
+    std::istringstream iss(line);
+    std::string name, first, second;
+    if (!(iss >> name) || (name[0] == '#')) continue;
+    if (!(iss >> first))
+      G4Exception("Incomplete line in the background model file", "",
+                  FatalException, "");
+    if (name == "MULTIPLE") {
+      if (!(iss >> second))
+        G4Exception("Incomplete line in the background model file", "",
+                    FatalException, "");
+      if (!MultiplesRead) MultipleRates.clear();
+      MultiplesRead = true;
+      G4int m = (G4int)fCalc.Evaluate(first, nline);
+      if (m < 2)
+        G4Exception("Background coincidences need at least 2 PMTs", "",
+                    FatalException, "");
+      MultipleRates[m] = fCalc.Evaluate(second, nline);
+      continue;
+    }
+    G4double x = fCalc.Evaluate(first, nline);
+    if (name == "SINGLES")
+      SinglesRate = x;
+    else if (name == "TIME_SPREAD")
+      TimeSpread = x;
+    else if (name == "WINDOW_BEFORE")
+      WindowBefore = x;
+    else if (name == "WINDOW_AFTER")
+      WindowAfter = x;
+    else
+      G4Exception("Unknown parameter in the background model file", "",
+                  FatalException, "");
+  }
+  G4cout << "Background: " << SinglesRate / kilohertz << " kHz per PMT, "
+         << MultipleRates.size() << " coincidence levels" << G4endl;
+}
+
+void KM3Background::AddHit(KM3HitsCollection *aCollection, G4int id,
+                           G4double time) {
+  KM3Hit *newHit = new KM3Hit();
+  newHit->SetCathodId(id);
+  newHit->SetTime(time);
+  newHit->SetoriginalInfo(KM3Provenance::Pack(0, KM3Provenance::kOther,
+                                              KM3Provenance::kBackground));
+  newHit->SetMany(1);
+  aCollection->insert(newHit);
+}
+
+void KM3Background::AddHits(KM3HitsCollection *aCollection,
+                            KM3Cathods *aCathods, G4int EventID,
+                            G4int realisation) {
+  // a seed below the limit of HepJamesRandom
+  uint64_t seed = (uint64_t)RunSeed * 2654435761u +
+                  (uint64_t)(FirstEvent + EventID) * 40503u +
+                  (uint64_t)realisation * 977u;
+  Engine.setSeed((long)(seed % 900000000u), 0);
+
+  G4double tfirst = 0.0;
+  if (aCollection->entries() > 0) {
+    tfirst = (*aCollection)[0]->GetTime();
+    for (G4int i = 1; i < (G4int)aCollection->entries(); i++)
+      if ((*aCollection)[i]->GetTime() < tfirst)
+        tfirst = (*aCollection)[i]->GetTime();
+  }
+  G4double start = tfirst - WindowBefore;
+  G4double length = WindowBefore + WindowAfter;
+
+  // singles
+  G4int NumberOfCathods = aCathods->GetNumberOfCathods();
+  G4int n = CLHEP::RandPoissonQ::shoot(
+      &Engine, SinglesRate * length * NumberOfCathods);
+  if (n > 0) {
+    Randoms.resize(2 * n);
+    Ids.resize(n);
+    Times.resize(n);
+    Engine.flatArray(2 * n, &Randoms[0]);
+    for (G4int i = 0; i < n; i++) {
+      G4int id = G4int(Randoms[i] * NumberOfCathods);
+      Ids[i] = (id < NumberOfCathods) ? id : NumberOfCathods - 1;
+      Times[i] = start + Randoms[n + i] * length;
+    }
+    for (G4int i = 0; i < n; i++) AddHit(aCollection, Ids[i], Times[i]);
+  }
+
+  // coincidences within one DOM
+  G4int NumberOfOMs = aCathods->GetNumberOfOMs();
+  for (std::map<G4int, G4double>::const_iterator it = MultipleRates.begin();
+       it != MultipleRates.end(); it++) {
+    G4int m = it->first;
+    n = CLHEP::RandPoissonQ::shoot(&Engine, it->second * length * NumberOfOMs);
+    for (G4int ic = 0; ic < n; ic++) {
+      G4int iom = G4int(Engine.flat() * NumberOfOMs);
+      if (iom >= NumberOfOMs) iom = NumberOfOMs - 1;
+      const OpticalModule &anOM = aCathods->GetOM(iom);
+      G4int size = anOM.CathodIds.size();
+      if (size < m) continue;
+      // m different PMTs by a partial shuffle
+      Chosen.assign(anOM.CathodIds.begin(), anOM.CathodIds.end());
+      for (G4int k = 0; k < m; k++) {
+        G4int j = k + G4int(Engine.flat() * (size - k));
+        if (j >= size) j = size - 1;
+        std::swap(Chosen[k], Chosen[j]);
+      }
+      G4double time = start + Engine.flat() * length;
+      for (G4int k = 0; k < m; k++)
+        AddHit(aCollection, Chosen[k],
+               time + CLHEP::RandGauss::shoot(&Engine, 0.0, TimeSpread));
+    }
+  }
+}
@@ -0,0 +1,66 @@
+#ifndef KM3Background_h
+#define KM3Background_h 1
+
+#include <string>
+#include <vector>
+#include <map>
+#include "globals.hh"
+#include "Randomize.hh"
+#include "KM3Hit.h"
+
+class KM3Cathods;
+
+// The optical background of the PMTs (K40 decays and dark counts), added
+// to the hits of an event as OmSim did afterwards. It covers the time
+// window from WindowBefore before the first hit of the event to
+// WindowAfter after it.
+//
+// The single hits have the same rate on every PMT, so they are drawn
+// all at once: a Poisson number for the whole detector, then a PMT and a
+// time for each from one array of random numbers. The coincidences of m
+// PMTs of one DOM (K40 decays seen by several PMTs) come the same way
+// per DOM, with m different PMTs of the DOM and a gaussian TimeSpread
+// around a common time.
+//
+// The background has its own engine, seeded from the run seed, the event
+// number and the realisation, so it is the same for an event whatever
+// the rest of the simulation does.
+class KM3Background {
+ public:
+  KM3Background();
+  ~KM3Background() {};
+
+  // overrides the rates from a file of lines
+  //   SINGLES <rate per PMT>
+  //   MULTIPLE <m> <rate per DOM>
+  //   TIME_SPREAD, WINDOW_BEFORE or WINDOW_AFTER <time>
+  // Values are expressions with Geant4 units (e.g. 7*kilohertz), lines
+  // starting with # are comments. The first MULTIPLE line replaces all
+  // the default coincidences
+  void ReadModel(const std::string &aFile);
+
+  // adds the background hits of this event and realisation
+  void AddHits(KM3HitsCollection *aCollection, KM3Cathods *aCathods,
+               G4int EventID, G4int realisation);
+
+  G4long RunSeed;
+  // of the run in the input file, so that a split run gets the same hits
+  G4int FirstEvent;
+  G4double SinglesRate;
+  // rate per DOM of coincidences of m PMTs
+  std::map<G4int, G4double> MultipleRates;
+  G4double TimeSpread;
+  G4double WindowBefore;
+  G4double WindowAfter;
+
+ private:
+  void AddHit(KM3HitsCollection *aCollection, G4int id, G4double time);
+
+  CLHEP::HepJamesRandom Engine;
+  std::vector<G4double> Randoms;
+  std::vector<G4int> Ids;
+  std::vector<G4double> Times;
+  std::vector<G4int> Chosen;
+};
+
+#endif
@@ -0,0 +1,270 @@
+#include "KM3BoundingVolume.h"
+
+#include <algorithm>
+#include <cmath>
+
+using CLHEP::m;
+
+KM3BoundingVolume::KM3BoundingVolume() {
+  theShape = kCylinder;
+  zMin = zMax = 0.0;
+  xMin = xMax = yMin = yMax = 0.0;
+}
+
+KM3BoundingVolume::Shape KM3BoundingVolume::ShapeFromName(
+    const G4String &name) {
+  if (name == "cylinder") return kCylinder;
+  if (name == "hull") return kHull;
+  if (name == "blocks") return kBlocks;
+  G4Exception("Unknown can shape (cylinder, hull or blocks)", "",
+              FatalException, "");
+  return kCylinder;
+}
+
+void KM3BoundingVolume::Build(Shape aShape,
+                              const std::vector<G4ThreeVector> &strings,
+                              const G4ThreeVector &center, G4double maxRho,
+                              G4double reach, G4double zLow, G4double zHigh,
+                              G4double blockGap) {
+  theShape = aShape;
+  zMin = zLow;
+  zMax = zHigh;
+  theCylinders.clear();
+  thePlanes.clear();
+
+  // a hull needs at least a triangle
+  if ((theShape == kHull) && (strings.size() < 3)) theShape = kBlocks;
+
+  if (theShape == kHull) {
+    BuildHull(strings, reach);
+  } else if (theShape == kBlocks) {
+    BuildBlocks(strings, reach, blockGap);
+  }
+  if ((theShape == kCylinder) || (theCylinders.empty() && thePlanes.empty())) {
+    theShape = kCylinder;
+    Cylinder can = {center[0], center[1], maxRho * maxRho};
+    theCylinders.push_back(can);
+  }
+
+  if (theShape != kHull) {
+    xMin = yMin = 1.0e21;
+    xMax = yMax = -1.0e21;
+    for (size_t i = 0; i < theCylinders.size(); i++) {
+      G4double r = sqrt(theCylinders[i].rho2);
+      xMin = std::min(xMin, theCylinders[i].x - r);
+      xMax = std::max(xMax, theCylinders[i].x + r);
+      yMin = std::min(yMin, theCylinders[i].y - r);
+      yMax = std::max(yMax, theCylinders[i].y + r);
+    }
+  }
+}
+
+static G4double Cross2D(const G4ThreeVector &o, const G4ThreeVector &a,
+                        const G4ThreeVector &b) {
+  return (a[0] - o[0]) * (b[1] - o[1]) - (a[1] - o[1]) * (b[0] - o[0]);
+}
+
+static G4bool LessXY(const G4ThreeVector &a, const G4ThreeVector &b) {
+  return (a[0] < b[0]) || ((a[0] == b[0]) && (a[1] < b[1]));
+}
+
+void KM3BoundingVolume::BuildHull(const std::vector<G4ThreeVector> &strings,
+                                  G4double reach) {
+  // monotone chain, counter clockwise
+  std::vector<G4ThreeVector> pts(strings);
+  std::sort(pts.begin(), pts.end(), LessXY);
+  std::vector<G4ThreeVector> hull(2 * pts.size());
+  size_t k = 0;
+  for (size_t i = 0; i < pts.size(); i++) {
+    while (k >= 2 && Cross2D(hull[k - 2], hull[k - 1], pts[i]) <= 0) k--;
+    hull[k++] = pts[i];
+  }
+  for (size_t i = pts.size() - 1, t = k + 1; i > 0; i--) {
+    while (k >= t && Cross2D(hull[k - 2], hull[k - 1], pts[i - 1]) <= 0) k--;
+    hull[k++] = pts[i - 1];
+  }
+  hull.resize(k - 1);
+  if (hull.size() < 3) return;
+
+  // every edge is pushed out by the reach. The corners of the
+  // offset polygon are cut by one more plane through each vertex,
+  // so the volume stays a tight superset of the rounded hull
+  size_t n = hull.size();
+  std::vector<HalfPlane> edges(n);
+  for (size_t i = 0; i < n; i++) {
+    const G4ThreeVector &a = hull[i];
+    const G4ThreeVector &b = hull[(i + 1) % n];
+    G4double dx = b[0] - a[0];
+    G4double dy = b[1] - a[1];
+    G4double len = sqrt(dx * dx + dy * dy);
+    edges[i].nx = dy / len;
+    edges[i].ny = -dx / len;
+    edges[i].d = edges[i].nx * a[0] + edges[i].ny * a[1] + reach;
+  }
+  for (size_t i = 0; i < n; i++) {
+    thePlanes.push_back(edges[i]);
+    const HalfPlane &next = edges[(i + 1) % n];
+    G4double nx = edges[i].nx + next.nx;
+    G4double ny = edges[i].ny + next.ny;
+    G4double len = sqrt(nx * nx + ny * ny);
+    if (len < 1.0e-9) continue;
+    const G4ThreeVector &v = hull[(i + 1) % n];
+    HalfPlane corner = {nx / len, ny / len,
+                        (nx * v[0] + ny * v[1]) / len + reach};
+    thePlanes.push_back(corner);
+  }
+
+  // the corner cuts reach at most sqrt(2) * reach away from a vertex
+  G4double margin = sqrt(2.0) * reach;
+  xMin = yMin = 1.0e21;
+  xMax = yMax = -1.0e21;
+  for (size_t i = 0; i < n; i++) {
+    xMin = std::min(xMin, hull[i][0] - margin);
+    xMax = std::max(xMax, hull[i][0] + margin);
+    yMin = std::min(yMin, hull[i][1] - margin);
+    yMax = std::max(yMax, hull[i][1] + margin);
+  }
+}
+
+void KM3BoundingVolume::BuildBlocks(const std::vector<G4ThreeVector> &strings,
+                                    G4double reach, G4double blockGap) {
+  // strings closer than blockGap to each other end up in the same block
+  size_t n = strings.size();
+  std::vector<size_t> block(n);
+  for (size_t i = 0; i < n; i++) block[i] = i;
+  G4double gap2 = blockGap * blockGap;
+  for (size_t i = 0; i < n; i++) {
+    for (size_t j = i + 1; j < n; j++) {
+      G4double dx = strings[i][0] - strings[j][0];
+      G4double dy = strings[i][1] - strings[j][1];
+      if (dx * dx + dy * dy > gap2) continue;
+      size_t bi = block[i], bj = block[j];
+      if (bi == bj) continue;
+      for (size_t k = 0; k < n; k++)
+        if (block[k] == bj) block[k] = bi;
+    }
+  }
+
+  for (size_t b = 0; b < n; b++) {
+    G4double sx = 0.0, sy = 0.0;
+    G4int ns = 0;
+    for (size_t i = 0; i < n; i++) {
+      if (block[i] != b) continue;
+      sx += strings[i][0];
+      sy += strings[i][1];
+      ns++;
+    }
+    if (ns == 0) continue;
+    Cylinder cyl = {sx / ns, sy / ns, 0.0};
+    G4double rmax = 0.0;
+    for (size_t i = 0; i < n; i++) {
+      if (block[i] != b) continue;
+      G4double dx = strings[i][0] - cyl.x;
+      G4double dy = strings[i][1] - cyl.y;
+      rmax = std::max(rmax, sqrt(dx * dx + dy * dy));
+    }
+    cyl.rho2 = (rmax + reach) * (rmax + reach);
+    theCylinders.push_back(cyl);
+  }
+}
+
+G4bool KM3BoundingVolume::IntersectCylinder(const Cylinder &cyl,
+                                            const G4ThreeVector &x0,
+                                            const G4ThreeVector &p0,
+                                            G4double &tIn,
+                                            G4double &tOut) const {
+  G4double x = x0[0] - cyl.x;
+  G4double y = x0[1] - cyl.y;
+  G4double a = p0[0] * p0[0] + p0[1] * p0[1];
+  G4double b = x * p0[0] + y * p0[1];
+  G4double c = x * x + y * y - cyl.rho2;
+  if (a > 0.0) {
+    G4double dia = b * b - a * c;
+    if (dia < 0.0) return false;
+    dia = sqrt(dia);
+    tIn = std::max(tIn, (-b - dia) / a);
+    tOut = std::min(tOut, (-b + dia) / a);
+  } else if (c > 0.0) {
+    return false;
+  }
+  return tIn < tOut;
+}
+
+G4bool KM3BoundingVolume::IntersectHull(const G4ThreeVector &x0,
+                                        const G4ThreeVector &p0,
+                                        G4double &tIn, G4double &tOut) const {
+  for (size_t i = 0; i < thePlanes.size(); i++) {
+    G4double along = thePlanes[i].nx * p0[0] + thePlanes[i].ny * p0[1];
+    G4double room =
+        thePlanes[i].d - thePlanes[i].nx * x0[0] - thePlanes[i].ny * x0[1];
+    if (along == 0.0) {
+      if (room < 0.0) return false;
+    } else if (along > 0.0) {
+      tOut = std::min(tOut, room / along);
+    } else {
+      tIn = std::max(tIn, room / along);
+    }
+    if (tIn >= tOut) return false;
+  }
+  return true;
+}
+
+G4bool KM3BoundingVolume::Intersect(const G4ThreeVector &x0,
+                                    const G4ThreeVector &p0, G4double &tIn,
+                                    G4double &tOut) const {
+  G4double zIn = -1.0e21;
+  G4double zOut = 1.0e21;
+  if (p0[2] != 0.0) {
+    G4double tLow = (zMin - x0[2]) / p0[2];
+    G4double tHigh = (zMax - x0[2]) / p0[2];
+    zIn = std::min(tLow, tHigh);
+    zOut = std::max(tLow, tHigh);
+  } else if ((x0[2] < zMin) || (x0[2] > zMax)) {
+    return false;
+  }
+
+  if (theShape == kHull) {
+    tIn = zIn;
+    tOut = zOut;
+    return IntersectHull(x0, p0, tIn, tOut);
+  }
+
+  // union of cylinders: from the first entry to the last exit
+  G4bool hit = false;
+  tIn = 1.0e21;
+  tOut = -1.0e21;
+  for (size_t i = 0; i < theCylinders.size(); i++) {
+    G4double t1 = zIn, t2 = zOut;
+    if (!IntersectCylinder(theCylinders[i], x0, p0, t1, t2)) continue;
+    hit = true;
+    tIn = std::min(tIn, t1);
+    tOut = std::max(tOut, t2);
+  }
+  return hit;
+}
+
+G4bool KM3BoundingVolume::SegmentInside(const G4ThreeVector &x0,
+                                        const G4ThreeVector &x1) const {
+  if (IsInside(x0) || IsInside(x1)) return true;
+  G4ThreeVector step = x1 - x0;
+  G4double length = step.mag();
+  if (length == 0.0) return false;
+  G4double tIn, tOut;
+  if (!Intersect(x0, step / length, tIn, tOut)) return false;
+  return (tIn < length) && (tOut > 0.0);
+}
+
+void KM3BoundingVolume::Print() const {
+  if (theShape == kHull) {
+    G4cout << "Can is a convex hull with " << thePlanes.size()
+           << " sides, z from " << zMin / m << " to " << zMax / m << " (m)"
+           << G4endl;
+  } else {
+    G4cout << "Can is " << theCylinders.size() << " cylinder(s):" << G4endl;
+    for (size_t i = 0; i < theCylinders.size(); i++)
+      G4cout << "  center " << theCylinders[i].x / m << " "
+             << theCylinders[i].y / m << " radius "
+             << sqrt(theCylinders[i].rho2) / m << " z from " << zMin / m
+             << " to " << zMax / m << " (m)" << G4endl;
+  }
+}
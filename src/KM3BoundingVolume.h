@@ -0,0 +1,92 @@
+#ifndef KM3BoundingVolume_h
+#define KM3BoundingVolume_h 1
+
+#include <vector>
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+
+// The instrumented volume used to cull secondaries and Cherenkov
+// emission. It is built from the horizontal string positions extended
+// by the absorption reach, between a lower and an upper z plane.
+//  cylinder : one vertical cylinder (the classic KM3Sim can)
+//  hull     : the convex hull of the strings
+//  blocks   : a union of cylinders, one per group of neighbouring strings
+class KM3BoundingVolume {
+ public:
+  enum Shape { kCylinder, kHull, kBlocks };
+
+  KM3BoundingVolume();
+  ~KM3BoundingVolume() {}
+
+  // shape name as given on the command line
+  static Shape ShapeFromName(const G4String &);
+
+  // strings holds the (x, y) of every string, blockGap is the largest
+  // distance between strings of the same block
+  void Build(Shape, const std::vector<G4ThreeVector> &strings,
+             const G4ThreeVector &center, G4double maxRho, G4double reach,
+             G4double zLow, G4double zHigh, G4double blockGap);
+
+  G4bool IsInside(const G4ThreeVector &) const;
+
+  // path lengths along x0 + t * p0 where the line first enters and last
+  // leaves the volume. Returns false if the line misses it
+  G4bool Intersect(const G4ThreeVector &x0, const G4ThreeVector &p0,
+                   G4double &tIn, G4double &tOut) const;
+
+  // true if any part of the segment x0 -> x1 is inside the volume
+  G4bool SegmentInside(const G4ThreeVector &x0, const G4ThreeVector &x1) const;
+
+  Shape GetShape() const { return theShape; }
+  void Print() const;
+
+ private:
+  struct Cylinder {
+    G4double x;
+    G4double y;
+    G4double rho2;
+  };
+
+  // hull is kept as half planes nx * x + ny * y <= d
+  struct HalfPlane {
+    G4double nx;
+    G4double ny;
+    G4double d;
+  };
+
+  G4bool IntersectCylinder(const Cylinder &, const G4ThreeVector &,
+                           const G4ThreeVector &, G4double &,
+                           G4double &) const;
+  G4bool IntersectHull(const G4ThreeVector &, const G4ThreeVector &,
+                       G4double &, G4double &) const;
+  void BuildHull(const std::vector<G4ThreeVector> &, G4double);
+  void BuildBlocks(const std::vector<G4ThreeVector> &, G4double, G4double);
+
+  Shape theShape;
+  G4double zMin;
+  G4double zMax;
+  // bounding box in x, y used as a first quick rejection
+  G4double xMin, xMax, yMin, yMax;
+  std::vector<Cylinder> theCylinders;
+  std::vector<HalfPlane> thePlanes;
+};
+
+inline G4bool KM3BoundingVolume::IsInside(const G4ThreeVector &x) const {
+  if ((x[2] < zMin) || (x[2] > zMax) || (x[0] < xMin) || (x[0] > xMax) ||
+      (x[1] < yMin) || (x[1] > yMax))
+    return false;
+  if (theShape == kHull) {
+    for (size_t i = 0; i < thePlanes.size(); i++)
+      if (thePlanes[i].nx * x[0] + thePlanes[i].ny * x[1] > thePlanes[i].d)
+        return false;
+    return true;
+  }
+  for (size_t i = 0; i < theCylinders.size(); i++) {
+    G4double dx = x[0] - theCylinders[i].x;
+    G4double dy = x[1] - theCylinders[i].y;
+    if (dx * dx + dy * dy <= theCylinders[i].rho2) return true;
+  }
+  return false;
+}
+
+#endif
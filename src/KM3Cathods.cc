@@ -24,7 +24,7 @@ KM3Cathods::~KM3Cathods() {
 
 void KM3Cathods::addCathod(const G4Transform3D &trans, const G4ThreeVector &Pos,
                            const G4ThreeVector &Dir, const G4double Radius,
-                           const G4double Height) {
+                           const G4double Height, const G4int PMTId) {
   // Cathod *aCathod = (Cathod *)malloc(sizeof(Cathod));
   Cathod *aCathod = new Cathod;
   aCathod->trans = trans;
@@ -32,6 +32,7 @@ void KM3Cathods::addCathod(const G4Transform3D &trans, const G4ThreeVector &Pos,
   aCathod->Direction = Dir;
   aCathod->Radius = Radius;
   aCathod->Height = Height;
+  aCathod->PMTId = PMTId;
   //aCathod->Depth = Dep;
   //std::vector<G4int> *aTree = new std::vector<G4int>;
   //aTree->reserve(Dep);
@@ -40,6 +41,15 @@ void KM3Cathods::addCathod(const G4Transform3D &trans, const G4ThreeVector &Pos,
   NumOfCathods++;
 }
 
+void KM3Cathods::addOM(const G4ThreeVector &Pos, const G4double Radius,
+                       const std::vector<G4int> &CathodIds) {
+  OpticalModule anOM;
+  anOM.Position = Pos;
+  anOM.Radius = Radius;
+  anOM.CathodIds = CathodIds;
+  theOMs.push_back(anOM);
+}
+
 //void KM3Cathods::addToTree(const G4int hist) {
 //  theCathods[NumOfCathods - 1]->Tree->push_back(hist);
 //  if ((G4int)(theCathods[NumOfCathods - 1]->Tree->size()) >
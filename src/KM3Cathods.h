@@ -16,9 +16,18 @@ struct Cathod {
   G4Transform3D trans;
   //G4int Depth;
   G4int cathID;
+  // the pmt id of the detector file, -1 if it has none
+  G4int PMTId;
   //std::vector<G4int> *Tree;
 };
 
+// the cathods of one optical module (DOM)
+struct OpticalModule {
+  G4ThreeVector Position;
+  G4double Radius;
+  std::vector<G4int> CathodIds;
+};
+
 class KM3Cathods {
  public:
   KM3Cathods();
@@ -26,7 +35,10 @@ class KM3Cathods {
 
  public:
   void addCathod(const G4Transform3D &, const G4ThreeVector &,
-                 const G4ThreeVector &, const G4double, const G4double);
+                 const G4ThreeVector &, const G4double, const G4double,
+                 const G4int PMTId = -1);
+  // groups the cathods that were added last into one OM
+  void addOM(const G4ThreeVector &, const G4double, const std::vector<G4int> &);
   //void addToTree(const G4int);
 
   //G4int GetCathodId(const G4int, const G4int[]);
@@ -40,10 +52,14 @@ class KM3Cathods {
   inline G4double GetCathodRadius(G4int it);
   inline G4double GetCathodHeight();
   inline G4double GetCathodHeight(G4int it);
+  inline G4int GetPMTId(G4int it);
   inline G4int GetNumberOfCathods();
+  inline G4int GetNumberOfOMs();
+  inline const OpticalModule &GetOM(G4int iom);
 
  private:
   std::vector<Cathod *> theCathods;
+  std::vector<OpticalModule> theOMs;
   G4int NumOfCathods;
   G4int iterator;
 };
@@ -75,6 +91,9 @@ inline G4double KM3Cathods::GetCathodHeight() {
 inline G4double KM3Cathods::GetCathodHeight(G4int it) {
   return theCathods[it]->Height;
 }
+inline G4int KM3Cathods::GetPMTId(G4int it) { return theCathods[it]->PMTId; }
 inline G4int KM3Cathods::GetNumberOfCathods() { return NumOfCathods; }
+inline G4int KM3Cathods::GetNumberOfOMs() { return (G4int)theOMs.size(); }
+inline const OpticalModule &KM3Cathods::GetOM(G4int iom) { return theOMs[iom]; }
 
 #endif
@@ -0,0 +1,73 @@
+#include "KM3Checkpoint.h"
+#include "KM3EvtIO.h"
+#include "G4ios.hh"
+
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <unistd.h>
+
+KM3Checkpoint::KM3Checkpoint(const std::string &aFile) {
+  CheckpointFile = aFile;
+  TheEVTtoWrite = NULL;
+  FirstEvent = 0;
+  Interval = 600.0;
+  NextEvent = 0;
+  InputOffset = -1;
+  OutputOffset = -1;
+  LastSave = time(NULL);
+}
+
+G4bool KM3Checkpoint::Read() {
+  std::ifstream infile(CheckpointFile.c_str());
+  if (!infile.good()) return false;
+  G4bool HasEvent = false, HasInput = false, HasOutput = false;
+  std::string line;
+  while (std::getline(infile, line)) {
+    std::istringstream iss(line);
+    std::string name;
+    if (!(iss >> name) || (name[0] == '#')) continue;
+    if (name == "NEXT_EVENT")
+      HasEvent = static_cast<bool>(iss >> NextEvent);
+    else if (name == "INPUT_OFFSET")
+      HasInput = static_cast<bool>(iss >> InputOffset);
+    else if (name == "OUTPUT_OFFSET")
+      HasOutput = static_cast<bool>(iss >> OutputOffset);
+    else
+      G4Exception("Unknown line in the checkpoint file", "", FatalException,
+                  "");
+  }
+  if (!HasEvent || !HasInput || !HasOutput || (OutputOffset < 0))
+    G4Exception("Incomplete checkpoint file", "", FatalException, "");
+  G4cout << "Resuming at event " << NextEvent << " of the input file"
+         << G4endl;
+  return true;
+}
+
+void KM3Checkpoint::EndOfEvent(G4int EventID) {
+  NextEvent = FirstEvent + EventID + 1;
+  if (difftime(time(NULL), LastSave) >= Interval) Save();
+}
+
+// through a temporary file, so that a job killed while saving leaves
+// the previous checkpoint
+void KM3Checkpoint::Save() {
+  OutputOffset = TheEVTtoWrite->Sync();
+  if (OutputOffset < 0)
+    G4Exception("Error writing the evt file", "", FatalException, "");
+  InputOffset = TheEVTtoWrite->GetInputOffset();
+  std::ostringstream tmpname;
+  tmpname << CheckpointFile << ".tmp" << getpid();
+  std::ofstream outfile(tmpname.str().c_str());
+  outfile << "# km3sim checkpoint" << std::endl;
+  outfile << "NEXT_EVENT " << NextEvent << std::endl;
+  outfile << "INPUT_OFFSET " << InputOffset << std::endl;
+  outfile << "OUTPUT_OFFSET " << OutputOffset << std::endl;
+  outfile.close();
+  if (outfile.fail() ||
+      (rename(tmpname.str().c_str(), CheckpointFile.c_str()) != 0)) {
+    remove(tmpname.str().c_str());
+    G4cout << "Could not write the checkpoint " << CheckpointFile << G4endl;
+  }
+  LastSave = time(NULL);
+}
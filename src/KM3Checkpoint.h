@@ -0,0 +1,49 @@
+#ifndef KM3Checkpoint_h
+#define KM3Checkpoint_h 1
+
+#include <string>
+#include <ios>
+#include <time.h>
+#include "globals.hh"
+
+class KM3EvtIO;
+
+// Records how far a run got, so that a job killed on the way goes on
+// with --resume instead of starting over. Every Interval seconds, after
+// an event, the complete events of the evt output are written out and
+// the checkpoint file is replaced by the lines
+//   NEXT_EVENT <number in the input file of the next event>
+//   INPUT_OFFSET <offset of that event in the input file>
+//   OUTPUT_OFFSET <size of the output up to there>
+// The resumed run truncates the output to OUTPUT_OFFSET, drops what was
+// written of the events after it, and goes on from NEXT_EVENT with the
+// seeds every event gets from its number (see
+// KM3PrimaryGeneratorAction::EventSeeds). A gzip output gets a new gzip
+// member at every checkpoint, which zlib reads as one stream.
+class KM3Checkpoint {
+ public:
+  KM3Checkpoint(const std::string &aFile);
+  ~KM3Checkpoint() {};
+
+  // false if there is no checkpoint yet
+  G4bool Read();
+  // after the event EventID of the run, saves if Interval is over
+  void EndOfEvent(G4int EventID);
+  void Save();
+
+  KM3EvtIO *TheEVTtoWrite;
+  // of the run in the input file
+  G4int FirstEvent;
+  // in seconds
+  G4double Interval;
+
+  G4int NextEvent;
+  std::streamoff InputOffset;
+  std::streamoff OutputOffset;
+
+ private:
+  std::string CheckpointFile;
+  time_t LastSave;
+};
+
+#endif
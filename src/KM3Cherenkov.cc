@@ -7,6 +7,11 @@
 #include "G4MaterialCutsCouple.hh"
 #include "G4ParticleDefinition.hh"
 #include "KM3Cherenkov.h"
+#include "KM3MuonLight.h"
+#include "KM3EmitterFile.h"
+#include "KM3TrackInformation.h"
+#include "KM3TrackingAction.h"
+#include "G4RunManager.hh"
 
 KM3Cherenkov::KM3Cherenkov(const G4String &processName, G4ProcessType type)
     : G4VProcess(processName, type) {
@@ -25,6 +30,7 @@ KM3Cherenkov::KM3Cherenkov(const G4String &processName, G4ProcessType type)
 
   M_PI2 = 2 * M_PI;
   MinMeanNumberOfPhotonsForParam = 20.0;
+  myTracking = NULL;
 
 #ifdef G4JUST_COUNT_PHOTONS
   Count_Photons = 0.0;
@@ -77,22 +83,16 @@ G4VParticleChange *KM3Cherenkov::PostStepDoIt(const G4Track &aTrack,
   // G4cout << " delta position magnitude " <<
   // aStep.GetDeltaPosition().mag()<<G4endl;
 
-  /// at first initialize the pointers to Q_E, glass and gell transparencies////
-  static G4MaterialPropertyVector *QECathod = NULL;
-  if (QECathod == NULL) {
-    const G4MaterialTable *theMaterialTable = G4Material::GetMaterialTable();
-    for (size_t J = 0; J < theMaterialTable->size(); J++) {
-      if ((*theMaterialTable)[J]->GetName() == G4String("Cathod")) {
-        G4MaterialPropertiesTable *aMaterialPropertiesTable =
-            (*theMaterialTable)[J]->GetMaterialPropertiesTable();
-        QECathod = aMaterialPropertiesTable->GetProperty("Q_EFF");
-      }
-    }
-  }
-
   // Should we ensure that the material is dispersive?
   aParticleChange.Initialize(aTrack);
 
+  // the light of these muons is sampled from the tables by KM3MuonLight
+  if ((MyStDetector->MuonLight != NULL) &&
+      MyStDetector->MuonLight->IsParametrized(&aTrack)) {
+    aParticleChange.SetNumberOfSecondaries(0);
+    return pParticleChange;
+  }
+
   const G4DynamicParticle *aParticle = aTrack.GetDynamicParticle();
   const G4Material *aMaterial = aTrack.GetMaterial();
 
@@ -106,18 +106,12 @@ G4VParticleChange *KM3Cherenkov::PostStepDoIt(const G4Track &aTrack,
 
   if (!Rindex) return pParticleChange;
 
-  // check that the particle is inside the active volume of the detector
-  static G4double detectorMaxRho2 =
-      MyStDetector->detectorMaxRho * MyStDetector->detectorMaxRho;
+  // check that the step touches the active volume of the detector
   G4StepPoint *pPreStepPoint = aStep.GetPreStepPoint();
   G4ThreeVector x0 = pPreStepPoint->GetPosition();
   //  G4cout <<"prepoint "<< x0[0] <<" "<< x0[1] <<" "<< x0[2] <<G4endl;
-  G4ThreeVector distanceV = x0 - MyStDetector->detectorCenter;
-  G4double distanceRho2 =
-      distanceV[0] * distanceV[0] + distanceV[1] * distanceV[1];
-  if ((distanceRho2 > detectorMaxRho2) ||
-      (x0[2] < MyStDetector->bottomPosition) ||
-      (x0[2] > MyStDetector->detectorMaxz)) {
+  if (!MyStDetector->BoundingVolume->SegmentInside(
+          x0, aStep.GetPostStepPoint()->GetPosition())) {
     // return unchanged particle and no secondaries
     aParticleChange.SetNumberOfSecondaries(0);
     return pParticleChange;
@@ -136,10 +130,6 @@ G4VParticleChange *KM3Cherenkov::PostStepDoIt(const G4Track &aTrack,
   G4double MeanNumPhotons =
       GetAverageNumberOfPhotons(charge, beta, aMaterial, Rindex);
   MeanNumPhotons *= step_length * MyStDetector->Quantum_Efficiency;
-  G4double BetaInverse = 1.0 / beta;
-  G4ThreeVector p0 = aStep.GetDeltaPosition().unit();
-
-  G4bool EmittedAsScattered = false;  // newmie
 
   if (MeanNumPhotons <= 0.0) {
     // return unchanged particle and no secondaries
@@ -147,7 +137,39 @@ G4VParticleChange *KM3Cherenkov::PostStepDoIt(const G4Track &aTrack,
     return pParticleChange;
   }
 
-  G4int NumPhotons = (G4int)CLHEP::RandPoisson::shoot(MeanNumPhotons);
+  KM3EmitterSegment aSegment;
+  aSegment.Start = x0;
+  aSegment.End = pPostStepPoint->GetPosition();
+  aSegment.Length = step_length;
+  aSegment.StartTime = pPreStepPoint->GetGlobalTime();
+  aSegment.Velocity =
+      (pPreStepPoint->GetVelocity() + pPostStepPoint->GetVelocity()) / 2.;
+  aSegment.BetaStart = pPreStepPoint->GetBeta();
+  aSegment.BetaEnd = pPostStepPoint->GetBeta();
+  aSegment.Charge = charge;
+  aSegment.TrackID = aTrack.GetTrackID();
+
+  // first stage of a split run: the segment is kept for the light stage
+  // instead of its photons
+  if (MyStDetector->EmitterWriter != NULL) {
+    if (myTracking == NULL)
+      myTracking = (const KM3TrackingAction *)G4RunManager::GetRunManager()
+                       ->GetUserTrackingAction();
+    MyStDetector->EmitterWriter->AddSegment(
+        aSegment, myTracking->GetProvenance(aTrack.GetTrackID()));
+    aParticleChange.SetNumberOfSecondaries(0);
+    return pParticleChange;
+  }
+
+  // every optical realisation of the event gets its own photons from the
+  // same step, see KM3Detector::Realisations
+  G4int NumberOfRealisations = MyStDetector->Realisations;
+  RealisationPhotons.resize(NumberOfRealisations);
+  G4int NumPhotons = 0;
+  for (G4int ir = 0; ir < NumberOfRealisations; ir++) {
+    RealisationPhotons[ir] = (G4int)CLHEP::RandPoisson::shoot(MeanNumPhotons);
+    NumPhotons += RealisationPhotons[ir];
+  }
   if (NumPhotons <= 0) {
     // return unchanged particle and no secondaries
     aParticleChange.SetNumberOfSecondaries(0);
@@ -169,9 +191,6 @@ G4VParticleChange *KM3Cherenkov::PostStepDoIt(const G4Track &aTrack,
   return pParticleChange;
 #endif
 
-  G4double nMax = Rindex->GetMaxValue();
-  G4double maxCos = BetaInverse / nMax;
-
   aParticleChange.SetNumberOfSecondaries(NumPhotons);
 
   if (fTrackSecondariesFirst) {
@@ -179,17 +198,89 @@ G4VParticleChange *KM3Cherenkov::PostStepDoIt(const G4Track &aTrack,
       aParticleChange.ProposeTrackStatus(fSuspend);
   }
 
+  G4int provenance = 0;
+  if (NumberOfRealisations > 1) {
+    if (myTracking == NULL)
+      myTracking = (const KM3TrackingAction *)G4RunManager::GetRunManager()
+                       ->GetUserTrackingAction();
+    provenance = myTracking->GetProvenance(aTrack.GetTrackID());
+  }
+  for (G4int ir = 0; ir < NumberOfRealisations; ir++) {
+    thePhotons.clear();
+    EmitPhotons(aSegment, aMaterial, Rindex, RealisationPhotons[ir],
+                thePhotons);
+    for (size_t ip = 0; ip < thePhotons.size(); ip++) {
+      G4Track *aSecondaryTrack = thePhotons[ip];
+      aSecondaryTrack->SetTouchableHandle(
+          aStep.GetPreStepPoint()->GetTouchableHandle());
+      aSecondaryTrack->SetParentID(aTrack.GetTrackID());
+      // the first realisation is the plain simulation, the hits of the
+      // others are told apart by the photons
+      if (ir > 0)
+        aSecondaryTrack->SetUserInformation(
+            new KM3TrackInformation(provenance, 0.0, ir));
+      aParticleChange.AddSecondary(aSecondaryTrack);
+    }
+  }
+
+  if (verboseLevel > 0) {
+    G4cout << "\n Exiting from KM3Cherenkov::DoIt -- NumberOfSecondaries = "
+           << aParticleChange.GetNumberOfSecondaries() << G4endl;
+  }
+
+  return pParticleChange;
+}
+
+G4double KM3Cherenkov::GetMeanNumberOfPhotons(
+    const KM3EmitterSegment &aSegment, const G4Material *aMaterial,
+    G4MaterialPropertyVector *Rindex) const {
+  G4double beta = (aSegment.BetaStart + aSegment.BetaEnd) / 2.;
+  return GetAverageNumberOfPhotons(aSegment.Charge, beta, aMaterial, Rindex) *
+         aSegment.Length * MyStDetector->Quantum_Efficiency;
+}
+
+// The photons of one emitting segment, appended to photons. Each one
+// passes the quantum efficiency of the cathods, so NumPhotons is the
+// Poisson number of photons already scaled by it.
+void KM3Cherenkov::EmitPhotons(const KM3EmitterSegment &aSegment,
+                               const G4Material *aMaterial,
+                               G4MaterialPropertyVector *Rindex,
+                               G4int NumPhotons,
+                               std::vector<G4Track *> &photons) {
+  /// at first initialize the pointers to Q_E, glass and gell transparencies////
+  static G4MaterialPropertyVector *QECathod = NULL;
+  static G4double MaxQECathod = 0.0;
+  if (QECathod == NULL) {
+    const G4MaterialTable *theMaterialTable = G4Material::GetMaterialTable();
+    for (size_t J = 0; J < theMaterialTable->size(); J++) {
+      if ((*theMaterialTable)[J]->GetName() == G4String("Cathod")) {
+        G4MaterialPropertiesTable *aMaterialPropertiesTable =
+            (*theMaterialTable)[J]->GetMaterialPropertiesTable();
+        QECathod = aMaterialPropertiesTable->GetProperty("Q_EFF");
+      }
+    }
+    MaxQECathod = QECathod->GetMaxValue();
+  }
+
+  G4ThreeVector x0 = aSegment.Start;
+  G4ThreeVector DeltaPosition = aSegment.End - aSegment.Start;
+  G4double step_length = aSegment.Length;
+  G4ThreeVector p0 = DeltaPosition.unit();
+  const G4double charge = aSegment.Charge;
+  const G4double beta1 = aSegment.BetaStart;
+  const G4double beta2 = aSegment.BetaEnd;
+  G4double BetaInverse = 2.0 / (beta1 + beta2);
+  G4double nMax = Rindex->GetMaxValue();
+  G4double maxCos = BetaInverse / nMax;
   G4double Pmin = Rindex->GetMinLowEdgeEnergy();
   G4double Pmax = Rindex->GetMaxLowEdgeEnergy();
   G4double dp = Pmax - Pmin;
   G4double maxSin2 = (1.0 - maxCos) * (1.0 + maxCos);
-  const G4double beta1 = pPreStepPoint->GetBeta();
-  const G4double beta2 = pPostStepPoint->GetBeta();
   G4double MeanNumberOfPhotons1 =
       GetAverageNumberOfPhotons(charge, beta1, aMaterial, Rindex);
   G4double MeanNumberOfPhotons2 =
       GetAverageNumberOfPhotons(charge, beta2, aMaterial, Rindex);
-  G4double t0 = pPreStepPoint->GetGlobalTime();
+  G4double t0 = aSegment.StartTime;
   //  NumPhotons=0; //lookout
   for (G4int i = 0; i < NumPhotons; i++) {
     G4double rand;
@@ -216,7 +307,8 @@ G4VParticleChange *KM3Cherenkov::PostStepDoIt(const G4Track &aTrack,
 
     } while (rand * maxSin2 > sin2Theta);
 
-    G4double qeProb = QECathod->Value(sampledEnergy);
+    G4double qeProb = MyStDetector->MaxQE ? MaxQECathod
+                                          : QECathod->Value(sampledEnergy);
 
     if (G4UniformRand() < qeProb) {
       // calculate x,y, and z components of photon momentum
@@ -259,11 +351,9 @@ G4VParticleChange *KM3Cherenkov::PostStepDoIt(const G4Track &aTrack,
             std::max(MeanNumberOfPhotons1, MeanNumberOfPhotons2);
       } while (N > NumberOfPhotons);
 
-      G4double deltaTime =
-          delta /
-          ((pPreStepPoint->GetVelocity() + pPostStepPoint->GetVelocity()) / 2.);
+      G4double deltaTime = delta / aSegment.Velocity;
 
-      G4ThreeVector aSecondaryPosition = x0 + rand * aStep.GetDeltaPosition();
+      G4ThreeVector aSecondaryPosition = x0 + rand * DeltaPosition;
 
       G4double aSecondaryTime = t0 + deltaTime;
 
@@ -279,20 +369,9 @@ G4VParticleChange *KM3Cherenkov::PostStepDoIt(const G4Track &aTrack,
       G4Track *aSecondaryTrack =
           new G4Track(aCerenkovPhoton, aSecondaryTime, aSecondaryPosition);
 
-      aSecondaryTrack->SetTouchableHandle(
-          aStep.GetPreStepPoint()->GetTouchableHandle());
-      aSecondaryTrack->SetParentID(aTrack.GetTrackID());
-
-      aParticleChange.AddSecondary(aSecondaryTrack);
+      photons.push_back(aSecondaryTrack);
     }  // if (G4UniformRand()<qeProb)
   }    // for each photon
-
-  if (verboseLevel > 0) {
-    G4cout << "\n Exiting from KM3Cherenkov::DoIt -- NumberOfSecondaries = "
-           << aParticleChange.GetNumberOfSecondaries() << G4endl;
-  }
-
-  return pParticleChange;
 }
 
 void KM3Cherenkov::BuildThePhysicsTable() {
@@ -2,6 +2,7 @@
 #define KM3Cherenkov_H 1
 
 #include <CLHEP/Units/SystemOfUnits.h>
+#include <vector>
 
 #include "globals.hh"
 #include "templates.hh"
@@ -19,6 +20,9 @@
 #include "G4PhysicsOrderedFreeVector.hh"
 
 #include "KM3Detector.h"
+#include "KM3EmitterSegment.h"
+
+class KM3TrackingAction;
 
 class KM3Cherenkov : public G4VProcess {
  public:
@@ -57,6 +61,20 @@ class KM3Cherenkov : public G4VProcess {
   //
   G4VParticleChange *PostStepDoIt(const G4Track &aTrack, const G4Step &aStep);
 
+  // The mean number of photons of aSegment in aMaterial that pass the
+  // quantum efficiency, as PostStepDoIt computes it for a step.
+  G4double GetMeanNumberOfPhotons(const KM3EmitterSegment &aSegment,
+                                  const G4Material *aMaterial,
+                                  G4MaterialPropertyVector *Rindex) const;
+
+  // Generates NumPhotons photons of aSegment in aMaterial, in the same way
+  // as PostStepDoIt does for a step. The new tracks are appended to
+  // photons, without touchable or parent.
+  void EmitPhotons(const KM3EmitterSegment &aSegment,
+                   const G4Material *aMaterial,
+                   G4MaterialPropertyVector *Rindex, G4int NumPhotons,
+                   std::vector<G4Track *> &photons);
+
   //  no operation in  AtRestDoIt and  AlongStepDoIt
   virtual G4double AlongStepGetPhysicalInteractionLength(const G4Track &,
                                                          G4double, G4double,
@@ -128,6 +146,10 @@ class KM3Cherenkov : public G4VProcess {
   G4double MaxAbsDist;
   G4double M_PI2;
   G4double MinMeanNumberOfPhotonsForParam;
+  const KM3TrackingAction *myTracking;
+  // reused from step to step
+  std::vector<G4int> RealisationPhotons;
+  std::vector<G4Track *> thePhotons;
 };
 
 inline G4bool KM3Cherenkov::IsApplicable(
@@ -0,0 +1,213 @@
+#include "KM3CompressedStream.h"
+#include "globals.hh"
+
+#include <unistd.h>
+
+namespace {
+// of zlib and of the buffers of the streams
+const size_t InBufferSize = 1 << 18;
+const size_t OutBufferSize = 1 << 22;
+
+bool IsGzipName(const std::string &aFile) {
+  return (aFile.size() > 3) &&
+         (aFile.compare(aFile.size() - 3, 3, ".gz") == 0);
+}
+}
+
+KM3GzipInBuf::KM3GzipInBuf() { File = NULL; }
+
+bool KM3GzipInBuf::open(const std::string &aFile) {
+  close();
+  File = gzopen(aFile.c_str(), "rb");
+  if (File == NULL) return false;
+  gzbuffer(File, InBufferSize);
+  Buffer.resize(InBufferSize);
+  setg(&Buffer[0], &Buffer[0], &Buffer[0]);
+  return true;
+}
+
+void KM3GzipInBuf::close() {
+  if (File != NULL) gzclose(File);
+  File = NULL;
+  setg(NULL, NULL, NULL);
+}
+
+KM3GzipInBuf::int_type KM3GzipInBuf::underflow() {
+  if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+  if (File == NULL) return traits_type::eof();
+  int n = gzread(File, &Buffer[0], Buffer.size());
+  if (n <= 0) {
+    // a truncated (Z_BUF_ERROR) or corrupt gzip file is not the end of
+    // the events
+    int errnum;
+    const char *message = gzerror(File, &errnum);
+    if ((n < 0) || ((errnum != Z_OK) && (errnum != Z_STREAM_END)))
+      G4Exception((std::string("Error reading a gzip evt file: ") + message)
+                      .c_str(),
+                  "", FatalException, "");
+    return traits_type::eof();
+  }
+  setg(&Buffer[0], &Buffer[0], &Buffer[0] + n);
+  return traits_type::to_int_type(*gptr());
+}
+
+KM3GzipInBuf::pos_type KM3GzipInBuf::seekoff(off_type off,
+                                             std::ios_base::seekdir dir,
+                                             std::ios_base::openmode which) {
+  if (File == NULL) return pos_type(off_type(-1));
+  if (dir == std::ios_base::beg) return seekpos(off, which);
+  if ((dir == std::ios_base::cur) && (off == 0))
+    return pos_type(gztell(File) - (egptr() - gptr()));
+  return pos_type(off_type(-1));
+}
+
+KM3GzipInBuf::pos_type KM3GzipInBuf::seekpos(pos_type pos,
+                                             std::ios_base::openmode) {
+  if ((File == NULL) || (gzseek(File, off_type(pos), SEEK_SET) < 0))
+    return pos_type(off_type(-1));
+  setg(&Buffer[0], &Buffer[0], &Buffer[0]);
+  return pos;
+}
+
+KM3GzipOutBuf::KM3GzipOutBuf() {
+  File = NULL;
+  PendingSize = 0;
+  HasPending = false;
+  Stop = false;
+  Error = false;
+}
+
+bool KM3GzipOutBuf::open(const std::string &aFile, bool append) {
+  close();
+  File = gzopen(aFile.c_str(), append ? "ab6" : "wb6");
+  if (File == NULL) return false;
+  gzbuffer(File, InBufferSize);
+  Filling.resize(OutBufferSize);
+  Pending.resize(OutBufferSize);
+  setp(&Filling[0], &Filling[0] + Filling.size());
+  HasPending = false;
+  Stop = false;
+  Error = false;
+  Worker = std::thread(&KM3GzipOutBuf::Compress, this);
+  return true;
+}
+
+bool KM3GzipOutBuf::close() {
+  if (File == NULL) return true;
+  HandOver();
+  {
+    std::unique_lock<std::mutex> guard(Lock);
+    Stop = true;
+  }
+  Changed.notify_all();
+  Worker.join();
+  if (gzclose(File) != Z_OK) Error = true;
+  File = NULL;
+  setp(NULL, NULL);
+  return !Error;
+}
+
+std::streamoff KM3GzipOutBuf::Finish() {
+  if (File == NULL) return -1;
+  HandOver();
+  // the thread only uses the file for a pending buffer
+  std::unique_lock<std::mutex> guard(Lock);
+  while (HasPending) Changed.wait(guard);
+  if (Error || (gzflush(File, Z_FINISH) != Z_OK)) return -1;
+  return gzoffset(File);
+}
+
+// the filled part of the buffer goes to the thread, once it is done with
+// the previous one
+void KM3GzipOutBuf::HandOver() {
+  std::unique_lock<std::mutex> guard(Lock);
+  while (HasPending) Changed.wait(guard);
+  PendingSize = pptr() - pbase();
+  if (PendingSize == 0) return;
+  Filling.swap(Pending);
+  HasPending = true;
+  Changed.notify_all();
+  guard.unlock();
+  setp(&Filling[0], &Filling[0] + Filling.size());
+}
+
+void KM3GzipOutBuf::Compress() {
+  std::unique_lock<std::mutex> guard(Lock);
+  while (true) {
+    while (!HasPending && !Stop) Changed.wait(guard);
+    if (!HasPending) return;
+    guard.unlock();
+    bool written =
+        (gzwrite(File, &Pending[0], PendingSize) == (int)PendingSize);
+    guard.lock();
+    if (!written) Error = true;
+    HasPending = false;
+    Changed.notify_all();
+  }
+}
+
+KM3GzipOutBuf::int_type KM3GzipOutBuf::overflow(int_type c) {
+  if (File == NULL) return traits_type::eof();
+  HandOver();
+  if (!traits_type::eq_int_type(c, traits_type::eof())) {
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+  }
+  return traits_type::not_eof(c);
+}
+
+int KM3GzipOutBuf::sync() {
+  if (File == NULL) return -1;
+  HandOver();
+  std::unique_lock<std::mutex> guard(Lock);
+  return Error ? -1 : 0;
+}
+
+void KM3InputStream::open(const std::string &aFile) {
+  if (Buffer.open(aFile))
+    clear();
+  else
+    setstate(std::ios_base::failbit);
+}
+
+void KM3OutputStream::open(const std::string &aFile, bool append) {
+  close();
+  bool opened;
+  if (IsGzipName(aFile)) {
+    opened = Gzip.open(aFile, append);
+    rdbuf(&Gzip);
+  } else {
+    std::ios_base::openmode mode = std::ios_base::out;
+    if (append) mode |= std::ios_base::app;
+    opened = (File.open(aFile.c_str(), mode) != NULL);
+    rdbuf(&File);
+  }
+  if (!opened) setstate(std::ios_base::failbit);
+}
+
+void KM3OutputStream::resume(const std::string &aFile,
+                             std::streamoff offset) {
+  close();
+  if (truncate(aFile.c_str(), offset) != 0) {
+    setstate(std::ios_base::failbit);
+    return;
+  }
+  open(aFile, true);
+}
+
+std::streamoff KM3OutputStream::Sync() {
+  if ((rdbuf() == NULL) || !flush().good()) return -1;
+  if (rdbuf() == &Gzip) return Gzip.Finish();
+  return File.pubseekoff(0, std::ios_base::cur, std::ios_base::out);
+}
+
+void KM3OutputStream::close() {
+  if (rdbuf() == NULL) return;
+  flush();
+  bool closed = true;
+  if (rdbuf() == &Gzip)
+    closed = Gzip.close();
+  else if (File.is_open())
+    closed = (File.close() != NULL);
+  if (!closed) setstate(std::ios_base::badbit);
+}
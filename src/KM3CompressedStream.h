@@ -0,0 +1,110 @@
+#ifndef KM3CompressedStream_h
+#define KM3CompressedStream_h 1
+
+#include <istream>
+#include <ostream>
+#include <fstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <zlib.h>
+
+// Streams of the evt files that read gzip compressed files as well as
+// plain ones, and write gzip when the name ends in .gz, so that km3sim
+// works on the compressed files directly.
+
+// reads through zlib, which passes the plain files through. seekg is
+// only supported from the beginning, on a gzip file it decompresses up to
+// the position. A truncated or corrupt gzip file is a fatal error rather
+// than the end of the events
+class KM3GzipInBuf : public std::streambuf {
+ public:
+  KM3GzipInBuf();
+  ~KM3GzipInBuf() { close(); };
+
+  bool open(const std::string &aFile);
+  void close();
+
+ protected:
+  int_type underflow();
+  pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                   std::ios_base::openmode which);
+  pos_type seekpos(pos_type pos, std::ios_base::openmode which);
+
+ private:
+  gzFile File;
+  std::vector<char> Buffer;
+};
+
+// compresses on a thread of its own: the stream fills one buffer while
+// the previous one is compressed and written
+class KM3GzipOutBuf : public std::streambuf {
+ public:
+  KM3GzipOutBuf();
+  ~KM3GzipOutBuf() { close(); };
+
+  // a new gzip member after the end of the file if append
+  bool open(const std::string &aFile, bool append);
+  // false if anything could not be written
+  bool close();
+  // ends the gzip member, the size of the file or -1 on error
+  std::streamoff Finish();
+
+ protected:
+  int_type overflow(int_type c);
+  int sync();
+
+ private:
+  void HandOver();
+  void Compress();
+
+  gzFile File;
+  std::vector<char> Filling, Pending;
+  size_t PendingSize;
+  bool HasPending, Stop, Error;
+  std::thread Worker;
+  std::mutex Lock;
+  std::condition_variable Changed;
+};
+
+class KM3InputStream : public std::istream {
+ public:
+  KM3InputStream() : std::istream(&Buffer) {};
+  KM3InputStream(const std::string &aFile) : std::istream(&Buffer) {
+    open(aFile);
+  };
+
+  void open(const std::string &aFile);
+  void close() { Buffer.close(); };
+
+ private:
+  KM3GzipInBuf Buffer;
+};
+
+class KM3OutputStream : public std::ostream {
+ public:
+  KM3OutputStream() : std::ostream(NULL) {};
+  KM3OutputStream(const std::string &aFile) : std::ostream(NULL) {
+    open(aFile);
+  };
+  ~KM3OutputStream() { close(); };
+
+  // gzip if the name ends in .gz
+  void open(const std::string &aFile, bool append = false);
+  // appends to the file truncated to offset, a size given by Sync
+  void resume(const std::string &aFile, std::streamoff offset);
+  void close();
+  // writes out what was written so far, and returns the size of the
+  // file it makes or -1 on error. What comes next can be truncated back
+  // to it
+  std::streamoff Sync();
+
+ private:
+  std::filebuf File;
+  KM3GzipOutBuf Gzip;
+};
+
+#endif
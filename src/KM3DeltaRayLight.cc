@@ -0,0 +1,94 @@
+#include "KM3DeltaRayLight.h"
+#include "KM3Detector.h"
+#include "KM3SD.h"
+#include "G4Step.hh"
+#include "G4Track.hh"
+#include "G4VProcess.hh"
+#include "G4Electron.hh"
+#include "G4MuonMinus.hh"
+#include "G4MuonPlus.hh"
+#include "G4ProductionCutsTable.hh"
+
+using CLHEP::GeV;
+using CLHEP::keV;
+using CLHEP::MeV;
+using CLHEP::meter;
+using CLHEP::twopi;
+using CLHEP::classic_electr_radius;
+using CLHEP::electron_mass_c2;
+
+KM3DeltaRayLight::KM3DeltaRayLight(KM3Detector *aDetector, KM3SD *aSD)
+    : mySampler(aDetector, aSD) {
+  myStDetector = aDetector;
+  aMySD = aSD;
+  myFlux = NULL;
+  DeltaCut = 100.0 * MeV;
+  LowestEnergy = 240 * keV;
+  MaxSegment = 1.0 * meter;
+}
+
+KM3DeltaRayLight::~KM3DeltaRayLight() { delete myFlux; }
+
+void KM3DeltaRayLight::LoadTables(const G4String &aFile) {
+  delete myFlux;
+  myFlux = new KM3EMDeltaFlux((char *)aFile.c_str(), aMySD->GetMaxQE(),
+                              myStDetector->TotCathodArea);
+}
+
+G4bool KM3DeltaRayLight::IsSuppressed(const G4Track *aTrack) const {
+  if (aTrack->GetDefinition() != G4Electron::ElectronDefinition())
+    return false;
+  if (aTrack->GetKineticEnergy() >= DeltaCut) return false;
+  const G4VProcess *creator = aTrack->GetCreatorProcess();
+  return (creator != NULL) && (creator->GetProcessName() == "muIoni");
+}
+
+G4double KM3DeltaRayLight::DeltaLoss(G4double KineticEnergy, G4double Mass,
+                                     G4double ElectronDensity,
+                                     G4double Tlow, G4double Thigh) const {
+  G4double Energy = KineticEnergy + Mass;
+  G4double gamma = Energy / Mass;
+  G4double beta2 = 1.0 - 1.0 / (gamma * gamma);
+  G4double ratio = electron_mass_c2 / Mass;
+  G4double Tmax = 2.0 * electron_mass_c2 * (gamma * gamma - 1.0) /
+                  (1.0 + 2.0 * gamma * ratio + ratio * ratio);
+  if (Thigh > Tmax) Thigh = Tmax;
+  if (Thigh <= Tlow) return 0.0;
+  // integral of T dN/dT with dN/dT ~ (1 - beta2 T/Tmax + T^2/2E^2)/T^2
+  G4double integral = log(Thigh / Tlow) - beta2 * (Thigh - Tlow) / Tmax +
+                      (Thigh * Thigh - Tlow * Tlow) / (4.0 * Energy * Energy);
+  return twopi * classic_electr_radius * classic_electr_radius *
+         electron_mass_c2 * ElectronDensity * integral / beta2;
+}
+
+void KM3DeltaRayLight::AddStep(const G4Step *aStep) {
+  const G4Track *aTrack = aStep->GetTrack();
+  if ((aTrack->GetDefinition() != G4MuonPlus::MuonPlusDefinition()) &&
+      (aTrack->GetDefinition() != G4MuonMinus::MuonMinusDefinition()))
+    return;
+  G4double StepLength = aStep->GetStepLength();
+  if (StepLength <= 0.0) return;
+
+  const G4StepPoint *prePoint = aStep->GetPreStepPoint();
+  const G4StepPoint *postPoint = aStep->GetPostStepPoint();
+  G4ThreeVector x1 = prePoint->GetPosition();
+  G4ThreeVector x2 = postPoint->GetPosition();
+  if (!myStDetector->BoundingVolume->IsInside(0.5 * (x1 + x2))) return;
+
+  // the delta rays from the production cut up to DeltaCut are missing
+  const G4MaterialCutsCouple *couple = prePoint->GetMaterialCutsCouple();
+  const std::vector<G4double> *ElectronCuts =
+      G4ProductionCutsTable::GetProductionCutsTable()->GetEnergyCutsVector(
+          idxG4ElectronCut);
+  G4double Tlow = (*ElectronCuts)[couple->GetIndex()];
+  if (Tlow < LowestEnergy) Tlow = LowestEnergy;
+  G4double KineticEnergy =
+      0.5 * (prePoint->GetKineticEnergy() + postPoint->GetKineticEnergy());
+  G4double dEdx =
+      DeltaLoss(KineticEnergy, aTrack->GetDefinition()->GetPDGMass(),
+                prePoint->GetMaterial()->GetElectronDensity(), Tlow, DeltaCut);
+  if (dEdx <= 0.0) return;
+
+  // the tables are per GeV of delta rays
+  mySampler.EmitStep(myFlux, dEdx * StepLength / GeV, aStep, MaxSegment);
+}
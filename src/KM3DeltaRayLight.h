@@ -0,0 +1,53 @@
+#ifndef KM3DeltaRayLight_h
+#define KM3DeltaRayLight_h 1
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+#include "KM3EMDeltaFlux.h"
+#include "KM3OMSampler.h"
+#include <CLHEP/Units/SystemOfUnits.h>
+#include <CLHEP/Units/PhysicalConstants.h>
+
+class G4Step;
+class G4Track;
+class KM3Detector;
+class KM3SD;
+
+// Light of the muon delta rays that are not tracked. The muIoni electrons
+// below DeltaCut are killed by the stacking action and, for every step of
+// a muon inside the can, the energy they would have taken is computed
+// from the delta ray spectrum between the electron production cut and
+// DeltaCut. The photoelectrons of that energy are sampled for every OM
+// from the delta ray block of the muon tables (KM3EMDeltaFlux), which
+// gives the flux per GeV of delta rays, through KM3OMSampler.
+class KM3DeltaRayLight {
+ public:
+  KM3DeltaRayLight(KM3Detector *, KM3SD *);
+  ~KM3DeltaRayLight();
+
+  void LoadTables(const G4String &aFile);
+  // the delta rays the stacking action kills
+  G4bool IsSuppressed(const G4Track *aTrack) const;
+  // called for every step of every track
+  void AddStep(const G4Step *aStep);
+
+  G4double DeltaCut;
+  // below this the delta rays give no light and are killed anyway
+  G4double LowestEnergy;
+  // longer steps are split, so that each piece is a point source
+  G4double MaxSegment;
+
+ private:
+  // energy per length going to delta rays of kinetic energy between
+  // Tlow and Thigh (Bethe-Bloch spectrum of a spin 1/2 particle)
+  G4double DeltaLoss(G4double KineticEnergy, G4double Mass,
+                     G4double ElectronDensity, G4double Tlow,
+                     G4double Thigh) const;
+
+  KM3Detector *myStDetector;
+  KM3SD *aMySD;
+  KM3EMDeltaFlux *myFlux;
+  KM3OMSampler mySampler;
+};
+
+#endif
@@ -1,6 +1,15 @@
 #include "KM3Detector.h"
 #include "KM3SD.h"
 #include "KM3StackingAction.h"
+#include "KM3EMShowerModel.h"
+#include "KM3ShowerLibraryModel.h"
+#include "KM3HAShowerModel.h"
+#include "KM3TableBuilder.h"
+#include "KM3PMTResponse.h"
+#include "KM3Trigger.h"
+#include "KM3DeltaRayLight.h"
+#include "KM3MuonLight.h"
+#include "KM3EmitterReplayModel.h"
 
 #include "G4UnitsTable.hh"
 #include "G4VUserDetectorConstruction.hh"
@@ -43,10 +52,12 @@ using CLHEP::cm3;
 using CLHEP::cm;
 using CLHEP::deg;
 using CLHEP::g;
+using CLHEP::GeV;
 using CLHEP::h_Planck;
 using CLHEP::kelvin;
 using CLHEP::kg;
 using CLHEP::m;
+using CLHEP::MeV;
 using CLHEP::meter;
 using CLHEP::mm;
 using CLHEP::mole;
@@ -55,6 +66,31 @@ using CLHEP::s;
 
 KM3Detector::KM3Detector() {
   allCathods = new KM3Cathods();
+  BoundingVolume = new KM3BoundingVolume();
+  CanShape = "cylinder";
+  BlockGap = 200.0 * m;
+  EMShowerModel = NULL;
+  EMThreshold = 1.0 * GeV;
+  LibraryThreshold = 1.0 * GeV;
+  ShowerLibraryModel = NULL;
+  HAShowerModel = NULL;
+  HAThreshold = 10.0 * GeV;
+  DeltaCut = 100.0 * MeV;
+  DeltaRayLight = NULL;
+  MuonLight = NULL;
+  TableBuilder = NULL;
+  ShowerRecorder = NULL;
+  Realisations = 1;
+  ExtendedHits = false;
+  MaxQE = false;
+  EmitterWriter = NULL;
+  EmitterReader = NULL;
+  EmitterReplayModel = NULL;
+  PMTResponse = new KM3PMTResponse;
+  Digitizer = NULL;
+  Background = NULL;
+  Trigger = NULL;
+  CherenkovProcess = NULL;
   //allStoreys = new std::vector<StoreysPositions *>;
   //allOMs = new std::vector<OMPositions *>;
   //allTowers = new std::vector<TowersPositions *>;  // new towers
@@ -63,6 +99,12 @@ KM3Detector::KM3Detector() {
 KM3Detector::~KM3Detector() {
   // newgeant  sxp.Finalize();
   delete allCathods;
+  delete BoundingVolume;
+  delete EMShowerModel;
+  delete ShowerLibraryModel;
+  delete HAShowerModel;
+  delete EmitterReplayModel;
+  delete PMTResponse;
 
   //for (size_t i = 0; i < allOMs->size(); i++) {
   //  (*allOMs)[i]->CathodsIDs->clear();
@@ -134,11 +176,74 @@ void KM3Detector::FindDetectorRadius() {
   G4cout << "Detector radius (m) and bottom position (m) " << detectorRadius / m
     << " " << bottomPosition / m << G4endl;
 
+  std::vector<G4ThreeVector> strings;
+  for (std::map<int, G4ThreeVector>::const_iterator it = line_xy.begin();
+       it != line_xy.end(); ++it)
+    strings.push_back(it->second * (meter / line_npmts[it->first]));
+  BoundingVolume->Build(KM3BoundingVolume::ShapeFromName(CanShape), strings,
+                        detectorCenter, detectorMaxRho, MaxAbsDist,
+                        bottomPosition, detectorMaxz, BlockGap);
+  BoundingVolume->Print();
+
   // we don't actually need storeys/towers for this
   MyGenerator->PutFromDetector(detectorCenter, detectorMaxRho, detectorMaxz,
       bottomPosition);
 }
 
+G4bool KM3Detector::IntersectCylinder(const G4ThreeVector &x0,
+                                      const G4ThreeVector &p0, G4double rho,
+                                      G4double zLow, G4double zHigh,
+                                      G4double &tIn, G4double &tOut) const {
+  tIn = -1.0e21;
+  tOut = 1.0e21;
+
+  // top and bottom planes
+  if (p0[2] != 0.0) {
+    G4double tLow = (zLow - x0[2]) / p0[2];
+    G4double tHigh = (zHigh - x0[2]) / p0[2];
+    tIn = std::min(tLow, tHigh);
+    tOut = std::max(tLow, tHigh);
+  } else if ((x0[2] < zLow) || (x0[2] > zHigh)) {
+    return false;
+  }
+
+  // side surface
+  G4double x = x0[0] - detectorCenter[0];
+  G4double y = x0[1] - detectorCenter[1];
+  G4double a = p0[0] * p0[0] + p0[1] * p0[1];
+  G4double b = x * p0[0] + y * p0[1];
+  G4double c = x * x + y * y - rho * rho;
+  if (a > 0.0) {
+    G4double dia = b * b - a * c;
+    if (dia < 0.0) return false;
+    dia = sqrt(dia);
+    tIn = std::max(tIn, (-b - dia) / a);
+    tOut = std::min(tOut, (-b + dia) / a);
+  } else if (c > 0.0) {
+    return false;
+  }
+  return tIn < tOut;
+}
+
+G4bool KM3Detector::IntersectCan(const G4ThreeVector &x0,
+                                 const G4ThreeVector &p0, G4double &tIn,
+                                 G4double &tOut) const {
+  return IntersectCylinder(x0, p0, detectorMaxRho, bottomPosition,
+                           detectorMaxz, tIn, tOut);
+}
+
+void KM3Detector::GetOpticalCurves(std::vector<G4double> &Energy,
+                                   std::vector<G4double> &Absorption,
+                                   std::vector<G4double> &Scattering,
+                                   std::vector<G4double> &QE) {
+  SetUpVariables();
+  Energy.assign(PPCKOV, PPCKOV + NUMENTRIES);
+  Absorption.assign(ABSORPTION_WATER, ABSORPTION_WATER + NUMENTRIES);
+  Scattering.assign(SCATTER_WATER, SCATTER_WATER + NUMENTRIES);
+  QE.assign(Q_EFF, Q_EFF + NUMENTRIES);
+  for (G4int i = 0; i < NUMENTRIES; i++) QE[i] *= Quantum_Efficiency;
+}
+
 void KM3Detector::SetUpVariables() {
   std::FILE *infile;
   G4double MaxRelDist;
@@ -765,8 +870,9 @@ G4VPhysicalVolume *KM3Detector::Construct() {
 
   // find the total photocathod area on a OM
   G4cout << "Compute total photocathod area... " << G4endl;
-  //G4int CaPerOM = (*allOMs)[0]->CathodsIDs->size();
   G4int CaPerOM = 31;
+  if (allCathods->GetNumberOfOMs() > 0)
+    CaPerOM = allCathods->GetOM(0).CathodIds.size();
   TotCathodArea =
     CaPerOM * pi * allCathods->GetCathodRadius(0) *
     allCathods->GetCathodRadius(0);
@@ -774,6 +880,55 @@ G4VPhysicalVolume *KM3Detector::Construct() {
   // all cathods have the same radius. Easy to change to account for a
   // detector with varius cathod types
 
+  // EM and hadronic showers above the thresholds are replaced by the
+  // parametrizations
+  G4Region *worldRegion = G4RegionStore::GetInstance()->GetRegion(
+      "DefaultRegionForTheWorld", false);
+  if (!EMParamFile.empty()) {
+    G4cout << "Load EM shower parametrization... " << G4endl;
+    EMShowerModel =
+        new KM3EMShowerModel("KM3EMShowerModel", worldRegion, this, aMySD);
+    EMShowerModel->EnergyThreshold = EMThreshold;
+    EMShowerModel->LoadTables(EMParamFile);
+  }
+  if (!ShowerLibraryFile.empty()) {
+    G4cout << "Load EM shower library... " << G4endl;
+    ShowerLibraryModel = new KM3ShowerLibraryModel("KM3ShowerLibraryModel",
+                                                   worldRegion, this);
+    ShowerLibraryModel->EnergyThreshold = LibraryThreshold;
+    ShowerLibraryModel->LoadLibrary(ShowerLibraryFile);
+  }
+  if (!HAParamFile.empty()) {
+    G4cout << "Load HA shower parametrization... " << G4endl;
+    HAShowerModel =
+        new KM3HAShowerModel("KM3HAShowerModel", worldRegion, this, aMySD);
+    HAShowerModel->EnergyThreshold = HAThreshold;
+    HAShowerModel->LoadTables(HAParamFile);
+    if (!HAMuonsFile.empty())
+      HAShowerModel->LoadMuons(HAMuonsFile, HAMuonsIndexFile);
+  }
+  if (!DeltaParamFile.empty()) {
+    G4cout << "Load delta ray parametrization... " << G4endl;
+    DeltaRayLight = new KM3DeltaRayLight(this, aMySD);
+    DeltaRayLight->DeltaCut = DeltaCut;
+    DeltaRayLight->LoadTables(DeltaParamFile);
+  }
+  if (!MuonParamFile.empty()) {
+    G4cout << "Load muon light parametrization... " << G4endl;
+    MuonLight = new KM3MuonLight(this, aMySD);
+    MuonLight->LoadTables(MuonParamFile);
+  }
+  if (EmitterReader != NULL)
+    EmitterReplayModel =
+        new KM3EmitterReplayModel("KM3EmitterReplayModel", worldRegion, this);
+  PMTResponse->Initialize(allCathods);
+  if (!PMTEfficiencyFile.empty())
+    PMTResponse->ReadEfficiencies(PMTEfficiencyFile);
+  if (Trigger != NULL) Trigger->Initialize(allCathods);
+  if (TableBuilder != NULL)
+    TableBuilder->Initialize(allCathods, aMySD->GetMaxQE(),
+                             aMySD->GetSpeedAtMaxQE(), TotCathodArea);
+
   // return the physical World
   return fWorld;
 }
@@ -850,6 +1005,8 @@ G4VPhysicalVolume* KM3Detector::ConstructWorldVolume(const std::string &detxFile
     std::istringstream iss(line);
     int dom_id, line_id, floor_id, n_pmts;
     iss >> dom_id >> line_id >> floor_id >> n_pmts;
+    std::vector<G4int> dom_cathods;
+    G4ThreeVector dom_center;
 
     for (int pmt = 0; pmt < n_pmts; pmt++) {
       std::getline(infile, line);
@@ -861,6 +1018,8 @@ G4VPhysicalVolume* KM3Detector::ConstructWorldVolume(const std::string &detxFile
       // needed for can computation
       z_all.push_back(pos_z);
       r_all.push_back(std::sqrt(std::pow(pos_x, 2) + std::pow(pos_y, 2)));
+      line_xy[line_id] += G4ThreeVector(pos_x, pos_y, 0.0);
+      line_npmts[line_id]++;
 
       // the api is completely weird.
       // pass rotation as pointer, but vector by value
@@ -868,15 +1027,16 @@ G4VPhysicalVolume* KM3Detector::ConstructWorldVolume(const std::string &detxFile
       // http://proj-clhep.web.cern.ch/proj-clhep/manual/UserGuide/VectorDefs/node25.html
       G4RotationMatrix *rota = new G4RotationMatrix(
           G4ThreeVector(dir_x, dir_y, dir_z), 0);
-      int dumb_id = 100 * dom + pmt;
+      // the copy number is the index in allCathods, this is what
+      // KM3SD gets back from the touchable
       G4VPhysicalVolume *cathodPV = new G4PVPlacement(
           rota,
-          G4ThreeVector(pos_x, pos_y, pos_z),
+          G4ThreeVector(pos_x, pos_y, pos_z) * meter,
           cathodLog,
           "CathodVolume",
           worldLog,
           true,          // no boolean operation, whatever that means
-          dumb_id         // copy ID
+          numCathods      // copy ID
       );
       G4double CathodHeight = -1.0 * mm;
       G4double CathodRadius = 0.0;
@@ -896,9 +1056,22 @@ G4VPhysicalVolume* KM3Detector::ConstructWorldVolume(const std::string &detxFile
       // correct to full height
       CathodHeight *= 2.0;
       allCathods->addCathod(trans, Position, Direction, CathodRadius,
-          CathodHeight);
+          CathodHeight, pmt_id_global);
+      dom_cathods.push_back(numCathods);
+      dom_center += Position;
       numCathods++;
     }
+
+    // the OM is the sphere around the cathods of this DOM
+    if (n_pmts > 0) {
+      dom_center /= n_pmts;
+      G4double dom_radius = 0.0;
+      for (size_t ic = 0; ic < dom_cathods.size(); ic++)
+        dom_radius = std::max(
+            dom_radius,
+            (allCathods->GetPosition(dom_cathods[ic]) - dom_center).mag());
+      allCathods->addOM(dom_center, dom_radius, dom_cathods);
+    }
   }
   // derive OM/storey/tower positions from PMT positions
   // dont use them as Geant volumes (it's water after all)
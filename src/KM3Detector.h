@@ -3,6 +3,7 @@
 
 #include "KM3Definitions.h"
 #include "KM3Cathods.h"
+#include "KM3BoundingVolume.h"
 #include "G4Material.hh"
 #include "KM3PrimaryGeneratorAction.h"
 #include "KM3EvtIO.h"
@@ -12,6 +13,7 @@
 #include <cmath>
 #include <vector>
 #include <string>
+#include <map>
 
 #include "G4VUserDetectorConstruction.hh"
 #include <CLHEP/Units/SystemOfUnits.h>
@@ -20,6 +22,21 @@
 
 
 class G4VPhysicalVolume;
+class KM3EMShowerModel;
+class KM3HAShowerModel;
+class KM3ShowerLibraryModel;
+class KM3ShowerRecorder;
+class KM3TableBuilder;
+class KM3DeltaRayLight;
+class KM3MuonLight;
+class KM3Cherenkov;
+class KM3EmitterWriter;
+class KM3EmitterReader;
+class KM3EmitterReplayModel;
+class KM3PMTResponse;
+class KM3Digitizer;
+class KM3Background;
+class KM3Trigger;
 
 class KM3Detector : public G4VUserDetectorConstruction {
  public:
@@ -49,6 +66,22 @@ class KM3Detector : public G4VUserDetectorConstruction {
   // storeys plus a number of absorption lengths
   G4double detectorMaxRho;
 
+  // path lengths along x0 + t * p0 where the line enters and leaves a
+  // vertical cylinder around the detector center. Returns false if the
+  // line misses it
+  G4bool IntersectCylinder(const G4ThreeVector &x0, const G4ThreeVector &p0,
+                           G4double rho, G4double zLow, G4double zHigh,
+                           G4double &tIn, G4double &tOut) const;
+  // the same for the can
+  G4bool IntersectCan(const G4ThreeVector &x0, const G4ThreeVector &p0,
+                      G4double &tIn, G4double &tOut) const;
+
+  // the volume actually used to cull particles and light, built around
+  // the strings with the shape chosen on the command line
+  KM3BoundingVolume *BoundingVolume;
+  G4String CanShape;
+  G4double BlockGap;
+
   KM3Cathods *allCathods;
   G4double MaxAbsDist;
   G4bool vrmlhits;
@@ -58,8 +91,76 @@ class KM3Detector : public G4VUserDetectorConstruction {
   std::string Geometry_File;
   std::string Parameter_File;
   G4double TotCathodArea;
+
+  // tables of the EM shower parametrization, empty for full simulation
+  std::string EMParamFile;
+  G4double EMThreshold;
+  KM3EMShowerModel *EMShowerModel;
+  // the EM showers can instead be replayed from a library of recorded
+  // showers
+  std::string ShowerLibraryFile;
+  G4double LibraryThreshold;
+  KM3ShowerLibraryModel *ShowerLibraryModel;
+  // the same for hadronic showers, with the optional muon library
+  std::string HAParamFile;
+  std::string HAMuonsFile;
+  std::string HAMuonsIndexFile;
+  G4double HAThreshold;
+  KM3HAShowerModel *HAShowerModel;
+  // muon tables with the light of the delta rays below DeltaCut, which
+  // are then not tracked
+  std::string DeltaParamFile;
+  G4double DeltaCut;
+  KM3DeltaRayLight *DeltaRayLight;
+  // the same tables for the Cherenkov light of the primary muons, which
+  // then create no photons
+  std::string MuonParamFile;
+  KM3MuonLight *MuonLight;
+  // histograms the photons to build parametrization tables, NULL for
+  // a normal run
+  KM3TableBuilder *TableBuilder;
+  // records the photons of the showers for a library, NULL for a normal
+  // run
+  KM3ShowerRecorder *ShowerRecorder;
+  // number of times the photons of every event are generated and
+  // propagated over the same charged particles, 1 for a normal run
+  G4int Realisations;
+  // every detected photon is written with its wavelength, path and
+  // scatters, so the hits can be reweighted to other water and quantum
+  // efficiency (see KM3Reweighter)
+  G4bool ExtendedHits;
+  // the photons pass the highest quantum efficiency of the cathods at all
+  // wavelengths, to be downsampled to any lower curve afterwards
+  G4bool MaxQE;
+  // a run split in two stages through an emitter file: the first one
+  // writes the Cherenkov segments instead of the photons, the second one
+  // reads them back in place of the particles. NULL for a normal run
+  KM3EmitterWriter *EmitterWriter;
+  KM3EmitterReader *EmitterReader;
+  KM3EmitterReplayModel *EmitterReplayModel;
+  // angular acceptance, efficiencies and transit time spread of the
+  // PMTs, with the efficiencies read from PMTEfficiencyFile if given
+  KM3PMTResponse *PMTResponse;
+  std::string PMTEfficiencyFile;
+  // writes the time-over-threshold hits of the PMTs instead of the
+  // photoelectrons, NULL for a normal run
+  KM3Digitizer *Digitizer;
+  // adds the K40 and dark count hits, NULL for none
+  KM3Background *Background;
+  // decides what is written of every event, NULL to write all
+  KM3Trigger *Trigger;
+  // set by KM3Physics
+  KM3Cherenkov *CherenkovProcess;
   KM3PrimaryGeneratorAction *MyGenerator;
 
+  // reads Parameter_File without building anything and gives the
+  // absorption and scattering lengths of the water and the quantum
+  // efficiency (Quantum_Efficiency folded in) at the photon energies
+  void GetOpticalCurves(std::vector<G4double> &Energy,
+                        std::vector<G4double> &Absorption,
+                        std::vector<G4double> &Scattering,
+                        std::vector<G4double> &QE);
+
  private:
   void FindDetectorRadius(void);
   void ConstructMaterials(void);
@@ -107,5 +208,8 @@ class KM3Detector : public G4VUserDetectorConstruction {
 
   std::vector<double> z_all;
   std::vector<double> r_all;
+  // horizontal position of each string (mean over its PMTs)
+  std::map<int, G4ThreeVector> line_xy;
+  std::map<int, int> line_npmts;
 };
 #endif  // KM3Detector_h
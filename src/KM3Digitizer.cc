@@ -0,0 +1,97 @@
+#include "KM3Digitizer.h"
+#include "G4ios.hh"
+#include "Randomize.hh"
+#include "KM3Evaluator.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <math.h>
+
+using CLHEP::ns;
+
+KM3Digitizer::KM3Digitizer() {
+  Threshold = 0.3;
+  GainSpread = 0.4;
+  // a single photoelectron gives about 26 ns
+  ToTAtThreshold = 10.0 * ns;
+  ToTSlope = 13.3 * ns;
+  MaxToT = 255.0 * ns;
+}
+
+void KM3Digitizer::ReadPulseModel(const std::string &aFile) {
+  std::ifstream infile(aFile.c_str());
+  if (!infile.good())
+    G4Exception("Error opening the pulse model file", "", FatalException, "");
+
+  KM3Evaluator fCalc(aFile);
+  G4int nline = 0;
+  std::string line;
+  while (std::getline(infile, line)) {
+    nline++;
+    std::istringstream iss(line);
+    std::string name, value;
+    if (!(iss >> name) || (name[0] == '#')) continue;
+    if (!(iss >> value))
+      G4Exception("Incomplete line in the pulse model file", "",
+                  FatalException, "");
+    G4double x = fCalc.Evaluate(value, nline);
+    if (name == "THRESHOLD")
+      Threshold = x;
+    else if (name == "GAIN_SPREAD")
+      GainSpread = x;
+    else if (name == "TOT_THRESHOLD")
+      ToTAtThreshold = x;
+    else if (name == "TOT_SLOPE")
+      ToTSlope = x;
+    else if (name == "TOT_MAX")
+      MaxToT = x;
+    else
+      G4Exception("Unknown parameter in the pulse model file", "",
+                  FatalException, "");
+  }
+  if (Threshold <= 0.0)
+    G4Exception("The pulse threshold must be positive", "", FatalException,
+                "");
+  G4cout << "Pulse model: threshold " << Threshold << " pe, ToT "
+         << ToT(1.0) / ns << " ns at 1 pe" << G4endl;
+}
+
+G4double KM3Digitizer::ToT(G4double charge) const {
+  if (charge < Threshold) return 0.0;
+  G4double tot = ToTAtThreshold + ToTSlope * log(charge / Threshold);
+  return (tot < MaxToT) ? tot : MaxToT;
+}
+
+const std::vector<KM3RawHit> &KM3Digitizer::Digitize(
+    const std::vector<KM3Hit *> &hits) {
+  RawHits.clear();
+  size_t n = hits.size();
+  size_t i = 0;
+  while (i < n) {
+    if (hits[i]->GetMany() == 0) {
+      i++;
+      continue;
+    }
+    // a new pulse, which takes the photoelectrons until it ends
+    G4int id = hits[i]->GetCathodId();
+    G4double start = hits[i]->GetTime();
+    G4double charge = 0.0;
+    G4double end = start;
+    for (size_t first = i; (i < n) && (hits[i]->GetCathodId() == id); i++) {
+      G4int many = hits[i]->GetMany();
+      if (many == 0) continue;
+      if ((i > first) && (hits[i]->GetTime() > end)) break;
+      G4double q = G4RandGauss::shoot(many, GainSpread * sqrt(double(many)));
+      if (q > 0.0) charge += q;
+      end = std::max(end, start + ToT(charge));
+    }
+    if (charge < Threshold) continue;
+    KM3RawHit aHit;
+    aHit.CathodId = id;
+    aHit.Time = start;
+    aHit.ToT = floor((end - start) / ns + 0.5) * ns;
+    RawHits.push_back(aHit);
+  }
+  return RawHits;
+}
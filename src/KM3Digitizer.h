@@ -0,0 +1,52 @@
+#ifndef KM3Digitizer_h
+#define KM3Digitizer_h 1
+
+#include <string>
+#include <vector>
+#include "globals.hh"
+#include "KM3Hit.h"
+
+// an L0 hit: a pulse of one PMT above threshold
+struct KM3RawHit {
+  G4int CathodId;
+  G4double Time;  // threshold crossing
+  G4double ToT;   // time over threshold, whole ns
+};
+
+// Turns the photoelectrons of an event into the time-over-threshold hits
+// of the PMTs, as the separate OmSim pass did with the hit output, so that
+// only the hit_raw words are written.
+//
+// Every photoelectron gets a gaussian charge (mean 1 pe, sigma
+// GainSpread). The photoelectrons of one PMT that arrive while its pulse
+// is over threshold add their charge to it and stretch it, and a pulse of
+// charge Q stays over threshold for
+//   ToT(Q) = ToTAtThreshold + ToTSlope ln(Q / Threshold)
+// up to MaxToT. Pulses below Threshold give no hit.
+class KM3Digitizer {
+ public:
+  KM3Digitizer();
+  ~KM3Digitizer() {};
+
+  // overrides the pulse model from a file of "<name> <value>" lines,
+  // with names THRESHOLD (pe), GAIN_SPREAD (pe), TOT_THRESHOLD, TOT_SLOPE
+  // and TOT_MAX. Values are expressions with Geant4 units (e.g. 26*ns),
+  // lines starting with # are comments
+  void ReadPulseModel(const std::string &aFile);
+
+  // the hits must be sorted in cathod and time, with the merged ones
+  // (Many 0) skipped, as KM3SD leaves them
+  const std::vector<KM3RawHit> &Digitize(const std::vector<KM3Hit *> &hits);
+
+  G4double Threshold;
+  G4double GainSpread;
+  G4double ToTAtThreshold;
+  G4double ToTSlope;
+  G4double MaxToT;
+
+ private:
+  G4double ToT(G4double charge) const;
+  std::vector<KM3RawHit> RawHits;
+};
+
+#endif
@@ -3,7 +3,7 @@
 
 using CLHEP::meter;
 
-KM3EMAngularFlux::KM3EMAngularFlux(std::ifstream &infile, bool &ok,
+KM3EMAngularFlux::KM3EMAngularFlux(KM3TableCursor &infile, bool &ok,
                                    bool FineBin) {
   VertexSolidAngleBins = 51;
   if (FineBin) {
@@ -11,9 +11,7 @@ KM3EMAngularFlux::KM3EMAngularFlux(std::ifstream &infile, bool &ok,
   }
   keepAngles = new std::vector<KM3EMTimePointDis *>;
   keepAngles->reserve(VertexSolidAngleBins);
-  char valC[4];
-  infile.read(valC, 4);
-  Distance = double(*(float *)valC);
+  Distance = infile.Next();
   Distance *= meter;
   G4int count = 0;
   G4int countall = 0;
@@ -21,9 +19,10 @@ KM3EMAngularFlux::KM3EMAngularFlux(std::ifstream &infile, bool &ok,
     bool oka;
     KM3EMTimePointDis *aTimePointDis = new KM3EMTimePointDis(infile, oka);
     keepAngles->push_back(aTimePointDis);
-    if (oka)
+    if (oka) {
+      ValidAngles.Add(i, aTimePointDis->GiveAngle());
       count = 0;
-    else
+    } else
       count++;
     if (count > 1) countall++;
     if (!oka)
@@ -56,37 +55,7 @@ void KM3EMAngularFlux::FindBins(G4double anglein) {
   if (!IsThisValid)
     G4Exception("Error sampling angle for null distribution\n", "",
                 FatalException, "");
-  G4int i;
-  for (i = 0; i < VertexSolidAngleBins; i++) {
-    if ((*keepAngles)[i]->IsValid()) {
-      if (anglein < (*keepAngles)[i]->GiveAngle()) break;
-    }
-  }
-  ibin2 = i;
-  if (ibin2 == VertexSolidAngleBins) {
-    for (i = VertexSolidAngleBins - 1; i >= 0; i--) {
-      if ((*keepAngles)[i]->IsValid()) break;
-    }
-    ibin2 = i;
-  }
-  for (i = ibin2 - 1; i >= 0; i--) {
-    if ((*keepAngles)[i]->IsValid()) break;
-  }
-  ibin1 = i;
-  if (ibin1 == -1) {
-    ibin1 = ibin2;
-    for (i = ibin1 + 1; i < VertexSolidAngleBins; i++) {
-      if ((*keepAngles)[i]->IsValid()) break;
-    }
-    ibin2 = i;
-  }
-  if (ibin2 == 0) {
-    ibin1 = ibin2;
-    for (i = ibin1 + 1; i < VertexSolidAngleBins; i++) {
-      if ((*keepAngles)[i]->IsValid()) break;
-    }
-    ibin2 = i;
-  }
+  ValidAngles.Bracket(anglein, ibin1, ibin2);
   G4double Angle1 = (*keepAngles)[ibin1]->GiveAngle();
   G4double Angle2 = (*keepAngles)[ibin2]->GiveAngle();
   ratio = (anglein - Angle1) / (Angle2 - Angle1);
@@ -7,11 +7,12 @@
 #include <fstream>
 #include <iomanip>
 #include "KM3EMTimePointDis.h"
+#include "KM3Sampling.h"
 #include <CLHEP/Units/SystemOfUnits.h>
 
 class KM3EMAngularFlux {
  public:
-  KM3EMAngularFlux(std::ifstream &, bool &ok, bool FineBin);
+  KM3EMAngularFlux(KM3TableCursor &, bool &ok, bool FineBin);
   ~KM3EMAngularFlux();
 
  public:
@@ -27,6 +28,7 @@ class KM3EMAngularFlux {
   G4int VertexSolidAngleBins;
   G4double Distance;
   bool IsThisValid;
+  KM3ValidBins ValidAngles;
   G4int ibin1;
   G4int ibin2;
   G4double Flux;
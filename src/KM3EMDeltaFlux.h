@@ -7,6 +7,7 @@
 #include <fstream>
 #include <iomanip>
 #include "KM3EMAngularFlux.h"
+#include "KM3Sampling.h"
 #include <CLHEP/Units/SystemOfUnits.h>
 
 class KM3EMDeltaFlux {
@@ -21,6 +22,7 @@ class KM3EMDeltaFlux {
 
  private:
   std::vector<KM3EMAngularFlux *> *keepDistances;
+  KM3ValidBins ValidDistances;
   G4int ibin1;
   G4int ibin2;
   G4double Flux;
@@ -5,27 +5,32 @@ using CLHEP::meter;
 
 KM3EMDirectFlux::KM3EMDirectFlux(char *infileParam, G4double TotCathodArea) {
   VertexDistanceBins = 40;
-  std::ifstream infile(infileParam, std::ios::in | std::ios::binary);
-  // keep2013  infile.seekg(std::streampos(439203908));
-  infile.seekg(std::streampos(540323872));  // it is 67540484*8 where the first
-                                            // number is size/energy and the
-                                            // second the number of energies for
-                                            // e-/e+/gamma parametrization
+  // keep2013  offset 439203908
+  size_t offset = 540323872;  // it is 67540484*8 where the first number is
+                              // size/energy and the second the number of
+                              // energies for e-/e+/gamma parametrization
+  const KM3MappedFile *aMappedFile = KM3MappedFile::Open(infileParam);
+  if (aMappedFile->HasHeader()) {
+    G4int ib = aMappedFile->FindBlock(KM3MappedFile::kFineBlock);
+    if (ib < 0)
+      G4Exception("No direct light block in parametrization table", "",
+                  FatalException, "");
+    offset = aMappedFile->GetBlockOffset(ib);
+  }
+  KM3TableCursor infile(aMappedFile, offset);
   keepDistances = new std::vector<KM3EMAngularFlux *>;
   keepDistances->reserve(VertexDistanceBins);
-  char valC[4];
-  infile.read(valC, 4);
-  G4double Energy = double(*(float *)valC);
+  G4double Energy = infile.Next();
   for (G4int i = 0; i < VertexDistanceBins; i++) {
     bool oka;
     KM3EMAngularFlux *aAngularFlux =
         new KM3EMAngularFlux(infile, oka, true);  // true is for fine binning
     keepDistances->push_back(aAngularFlux);
+    if (oka) ValidDistances.Add(i, aAngularFlux->GiveDistance());
     if (!oka)
       G4cout << "Null for Energy " << Energy << " and distance "
              << aAngularFlux->GiveDistance() / meter << G4endl;
   }
-  infile.close();
   RatioThis = TotCathodArea;
 }
 KM3EMDirectFlux::~KM3EMDirectFlux() {
@@ -38,37 +43,7 @@ KM3EMDirectFlux::~KM3EMDirectFlux() {
 }
 void KM3EMDirectFlux::FindBins(G4double MeanNumPhotons, G4double distancein,
                                G4double anglein) {
-  G4int i;
-  for (i = 0; i < VertexDistanceBins; i++) {
-    if ((*keepDistances)[i]->IsValid()) {
-      if (distancein < (*keepDistances)[i]->GiveDistance()) break;
-    }
-  }
-  ibin2 = i;
-  if (ibin2 == VertexDistanceBins) {
-    for (i = VertexDistanceBins - 1; i >= 0; i--) {
-      if ((*keepDistances)[i]->IsValid()) break;
-    }
-    ibin2 = i;
-  }
-  for (i = ibin2 - 1; i >= 0; i--) {
-    if ((*keepDistances)[i]->IsValid()) break;
-  }
-  ibin1 = i;
-  if (ibin1 == -1) {
-    ibin1 = ibin2;
-    for (i = ibin1 + 1; i < VertexDistanceBins; i++) {
-      if ((*keepDistances)[i]->IsValid()) break;
-    }
-    ibin2 = i;
-  }
-  if (ibin2 == 0) {
-    ibin1 = ibin2;
-    for (i = ibin1 + 1; i < VertexDistanceBins; i++) {
-      if ((*keepDistances)[i]->IsValid()) break;
-    }
-    ibin2 = i;
-  }
+  ValidDistances.Bracket(distancein, ibin1, ibin2);
   (*keepDistances)[ibin1]->FindBins(anglein);
   (*keepDistances)[ibin2]->FindBins(anglein);
 
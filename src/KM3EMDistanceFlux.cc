@@ -4,18 +4,17 @@
 using CLHEP::GeV;
 using CLHEP::meter;
 
-KM3EMDistanceFlux::KM3EMDistanceFlux(std::ifstream &infile) {
+KM3EMDistanceFlux::KM3EMDistanceFlux(KM3TableCursor &infile) {
   VertexDistanceBins = 40;
   keepDistances = new std::vector<KM3EMAngularFlux *>;
   keepDistances->reserve(VertexDistanceBins);
-  char valC[4];
-  infile.read(valC, 4);
-  Energy = log10(GeV * double(*(float *)valC));
+  Energy = log10(GeV * infile.Next());
   for (G4int i = 0; i < VertexDistanceBins; i++) {
     bool oka;
     KM3EMAngularFlux *aAngularFlux =
         new KM3EMAngularFlux(infile, oka, false);  // false is for fine binning
     keepDistances->push_back(aAngularFlux);
+    if (oka) ValidDistances.Add(i, aAngularFlux->GiveDistance());
     if (!oka)
       G4cout << "Null for Energy " << Energy << " and distance "
              << aAngularFlux->GiveDistance() / meter << G4endl;
@@ -30,37 +29,7 @@ KM3EMDistanceFlux::~KM3EMDistanceFlux() {
   }
 }
 void KM3EMDistanceFlux::FindBins(G4double distancein, G4double anglein) {
-  G4int i;
-  for (i = 0; i < VertexDistanceBins; i++) {
-    if ((*keepDistances)[i]->IsValid()) {
-      if (distancein < (*keepDistances)[i]->GiveDistance()) break;
-    }
-  }
-  ibin2 = i;
-  if (ibin2 == VertexDistanceBins) {
-    for (i = VertexDistanceBins - 1; i >= 0; i--) {
-      if ((*keepDistances)[i]->IsValid()) break;
-    }
-    ibin2 = i;
-  }
-  for (i = ibin2 - 1; i >= 0; i--) {
-    if ((*keepDistances)[i]->IsValid()) break;
-  }
-  ibin1 = i;
-  if (ibin1 == -1) {
-    ibin1 = ibin2;
-    for (i = ibin1 + 1; i < VertexDistanceBins; i++) {
-      if ((*keepDistances)[i]->IsValid()) break;
-    }
-    ibin2 = i;
-  }
-  if (ibin2 == 0) {
-    ibin1 = ibin2;
-    for (i = ibin1 + 1; i < VertexDistanceBins; i++) {
-      if ((*keepDistances)[i]->IsValid()) break;
-    }
-    ibin2 = i;
-  }
+  ValidDistances.Bracket(distancein, ibin1, ibin2);
   (*keepDistances)[ibin1]->FindBins(anglein);
   (*keepDistances)[ibin2]->FindBins(anglein);
 
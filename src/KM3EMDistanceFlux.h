@@ -7,11 +7,12 @@
 #include <fstream>
 #include <iomanip>
 #include "KM3EMAngularFlux.h"
+#include "KM3Sampling.h"
 #include <CLHEP/Units/SystemOfUnits.h>
 
 class KM3EMDistanceFlux {
  public:
-  KM3EMDistanceFlux(std::ifstream &);
+  KM3EMDistanceFlux(KM3TableCursor &);
   ~KM3EMDistanceFlux();
 
  public:
@@ -24,6 +25,7 @@ class KM3EMDistanceFlux {
  private:
   std::vector<KM3EMAngularFlux *> *keepDistances;
   G4double Energy;
+  KM3ValidBins ValidDistances;
   G4int ibin1;
   G4int ibin2;
   G4double Flux;
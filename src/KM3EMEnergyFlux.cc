@@ -2,13 +2,14 @@
 #include "Randomize.hh"
 #include "CLHEP/Random/RandGamma.h"
 #include "CLHEP/Random/RandPoisson.h"
+#include <algorithm>
 
 KM3EMEnergyFlux::KM3EMEnergyFlux(char *infileParam, G4double QEmax,
                                  G4double TotCathodArea, G4int NEner,
                                  G4double MBstRat) {
   NEnergies = NEner;
   MaxBoostRatio = MBstRat;
-  std::ifstream infile(infileParam, std::ios::in | std::ios::binary);
+  KM3TableCursor infile(KM3MappedFile::Open(infileParam), 0);
   keepEnergies = new std::vector<KM3EMDistanceFlux *>;
   keepEnergies->reserve(NEnergies);
   EnergyMin = 1.0e20;
@@ -20,8 +21,8 @@ KM3EMEnergyFlux::KM3EMEnergyFlux(char *infileParam, G4double QEmax,
     if (EnergyMax < aDistanceFlux->GiveEnergy())
       EnergyMax = aDistanceFlux->GiveEnergy();
     keepEnergies->push_back(aDistanceFlux);
+    Energies.push_back(aDistanceFlux->GiveEnergy());
   }
-  infile.close();
   RatioThis = QEmax * TotCathodArea;
 }
 KM3EMEnergyFlux::~KM3EMEnergyFlux() {
@@ -48,13 +49,12 @@ G4bool KM3EMEnergyFlux::ModelTrigger(G4double TheE) {
 void KM3EMEnergyFlux::FindBins(G4double energyin, G4double distancein,
                                G4double anglein) {
   G4double TheE = log10(energyin);
-  G4int i;
   G4double BoostRatio;
   if (TheE < EnergyMax) {
-    for (i = 1; i < NEnergies; i++) {
-      if (TheE < (*keepEnergies)[i]->GiveEnergy()) break;
-    }
-    ibin2 = i;
+    // the energies of the table increase
+    ibin2 = std::upper_bound(Energies.begin() + 1, Energies.end(), TheE) -
+            Energies.begin();
+    if (ibin2 > NEnergies - 1) ibin2 = NEnergies - 1;
     BoostRatio = 1.0;
   } else {
     ibin2 = NEnergies - 1;
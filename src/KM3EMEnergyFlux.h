@@ -22,6 +22,7 @@ class KM3EMEnergyFlux {
  private:
   G4int NEnergies;
   std::vector<KM3EMDistanceFlux *> *keepEnergies;
+  std::vector<G4double> Energies;  // log10 of the energies of keepEnergies
   G4int ibin1;
   G4int ibin2;
   G4double Flux;
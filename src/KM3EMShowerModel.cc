@@ -0,0 +1,68 @@
+#include "KM3EMShowerModel.h"
+#include "KM3Detector.h"
+#include "KM3SD.h"
+#include "G4Electron.hh"
+#include "G4Positron.hh"
+#include "G4Gamma.hh"
+#include "KM3MappedFile.h"
+
+KM3EMShowerModel::KM3EMShowerModel(const G4String &name, G4Region *anEnvelope,
+                                   KM3Detector *aDetector, KM3SD *aSD)
+    : G4VFastSimulationModel(name, anEnvelope), mySampler(aDetector, aSD) {
+  myStDetector = aDetector;
+  aMySD = aSD;
+  myFlux = NULL;
+  EnergyThreshold = 1.0 * CLHEP::GeV;
+  MaxBoostRatio = 10.0;
+}
+
+KM3EMShowerModel::~KM3EMShowerModel() { delete myFlux; }
+
+void KM3EMShowerModel::LoadTables(const G4String &aFile) {
+  // the energies are the leading energy blocks, which start with their
+  // energy in increasing order
+  const KM3MappedFile *aMappedFile = KM3MappedFile::Open(aFile);
+  G4int NEnergies = aMappedFile->GetNumberOfEnergyBlocks();
+  if (NEnergies < 2)
+    G4Exception("EM parametrization file has less than two energies", "",
+                FatalException, "");
+  for (G4int i = 1; i < NEnergies; i++)
+    if (!(*aMappedFile->GetData(i * KM3MappedFile::EnergyBlockSize) >
+          *aMappedFile->GetData((i - 1) * KM3MappedFile::EnergyBlockSize)))
+      G4Exception("EM parametrization energies do not increase", "",
+                  FatalException, "");
+
+  delete myFlux;
+  myFlux = new KM3EMEnergyFlux((char *)aFile.c_str(), aMySD->GetMaxQE(),
+                               myStDetector->TotCathodArea, NEnergies,
+                               MaxBoostRatio);
+}
+
+G4bool KM3EMShowerModel::IsApplicable(const G4ParticleDefinition &particle) {
+  return (&particle == G4Electron::ElectronDefinition()) ||
+         (&particle == G4Positron::PositronDefinition()) ||
+         (&particle == G4Gamma::GammaDefinition());
+}
+
+G4bool KM3EMShowerModel::ModelTrigger(const G4FastTrack &fastTrack) {
+  const G4Track *track = fastTrack.GetPrimaryTrack();
+  G4double energy = track->GetKineticEnergy();
+  if ((energy < EnergyThreshold) || !myFlux->ModelTrigger(energy))
+    return false;
+  return myStDetector->BoundingVolume->IsInside(track->GetPosition());
+}
+
+void KM3EMShowerModel::DoIt(const G4FastTrack &fastTrack,
+                            G4FastStep &fastStep) {
+  const G4Track *track = fastTrack.GetPrimaryTrack();
+  G4double energy = track->GetKineticEnergy();
+  G4ThreeVector x0 = track->GetPosition();
+  G4ThreeVector p0 = track->GetMomentumDirection();
+  G4double t0 = track->GetGlobalTime();
+
+  fastStep.KillPrimaryTrack();
+  fastStep.ProposePrimaryTrackPathLength(0.0);
+  fastStep.ProposeTotalEnergyDeposited(energy);
+
+  mySampler.Emit(myFlux, energy, x0, p0, t0, mySampler.GetProvenance(track));
+}
@@ -0,0 +1,41 @@
+#ifndef KM3EMShowerModel_h
+#define KM3EMShowerModel_h 1
+
+#include "G4VFastSimulationModel.hh"
+#include "G4Region.hh"
+#include "globals.hh"
+#include "KM3EMEnergyFlux.h"
+#include "KM3OMSampler.h"
+#include <CLHEP/Units/SystemOfUnits.h>
+
+class KM3Detector;
+class KM3SD;
+
+// Fast simulation of electromagnetic showers. An e-, e+ or gamma above
+// EnergyThreshold is killed and the photoelectrons it would give are
+// sampled for every OM directly from the parametrization tables
+// (KM3EMEnergyFlux). They become ordinary hits through
+// KM3SD::InsertExternalHit.
+class KM3EMShowerModel : public G4VFastSimulationModel {
+ public:
+  KM3EMShowerModel(const G4String &, G4Region *, KM3Detector *, KM3SD *);
+  ~KM3EMShowerModel();
+
+  void LoadTables(const G4String &aFile);
+
+  G4bool IsApplicable(const G4ParticleDefinition &);
+  G4bool ModelTrigger(const G4FastTrack &);
+  void DoIt(const G4FastTrack &, G4FastStep &);
+
+  G4double EnergyThreshold;
+  // the tables are extrapolated up to this times their highest energy
+  G4double MaxBoostRatio;
+
+ private:
+  KM3Detector *myStDetector;
+  KM3SD *aMySD;
+  KM3EMEnergyFlux *myFlux;
+  KM3OMSampler mySampler;
+};
+
+#endif
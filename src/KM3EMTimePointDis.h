@@ -7,6 +7,8 @@
 #include <fstream>
 #include <iomanip>
 #include "G4ExceptionHandler.hh"
+#include "KM3MappedFile.h"
+#include "KM3Sampling.h"
 #include <CLHEP/Units/SystemOfUnits.h>
 #include <CLHEP/Units/PhysicalConstants.h>
 
@@ -18,7 +20,7 @@ struct onePE {
 
 class KM3EMTimePointDis {
  public:
-  KM3EMTimePointDis(std::ifstream &, bool &ok);
+  KM3EMTimePointDis(KM3TableCursor &, bool &ok);
   ~KM3EMTimePointDis();
 
  public:
@@ -28,22 +30,36 @@ class KM3EMTimePointDis {
   G4double GiveFluxRMS() { return FluxRMS; };
   bool IsValid() { return IsThisValid; };
 
+  // the binning of the tables, shared with KM3TableBuilder. Angles are in
+  // degrees in the frame of GetSamplePoint, with phi folded to [0,180],
+  // times in ns from the direct light
+  static const G4int NumberOfDirectionBins = 834;
+  static const G4int NumberOfTimeSolidAngleBins = 52;
+  static const G4int NumberOfTimeBins = 111;
+  static G4int FindDirectionBin(G4double theta, G4double phi);
+  static void GetDirectionBinLimits(G4int ibin, G4double &thetaLow,
+                                    G4double &thetaHigh, G4double &phiLow,
+                                    G4double &phiHigh);
+  static G4int FindTimeSolidAngleBin(G4double theta, G4double phi);
+  static G4int FindTimeBin(G4double time);
+
  private:
-  std::vector<G4float> *keepDis;
-  std::vector<G4float> *keepTh2Th3Num;
-  std::vector<G4float> *keepExpoTh2;
-  std::vector<G4float> *keepExpoTh3;
-  bool time_ok[52];
+  // these point into the mapped table file. keepDirection has the
+  // cumulative, the th2 and the th3 slope of every direction bin in turn
+  const G4float *keepDis;
+  const G4float *keepDirection;
+  KM3AliasTable DirectionAlias;
+  bool time_ok[NumberOfTimeSolidAngleBins];
   G4double pi2;
   G4double angle;
   G4double Flux;
   G4double FluxRMS;
   bool IsThisValid;
-  // definition of bins limits for direction sampling
-  G4double theta_Low[834];  // this should be OMSolidAngleBins below
-  G4double theta_High[834];
-  G4double phi_Low[834];
-  G4double phi_High[834];
+  // definition of bins limits for direction sampling, the same for all
+  const G4double *theta_Low;
+  const G4double *theta_High;
+  const G4double *phi_Low;
+  const G4double *phi_High;
   G4int TimeSolidAngleBins;
   G4int TimeBins;
   G4int OMSolidAngleBins;
@@ -0,0 +1,168 @@
+#include "KM3EmitterFile.h"
+#include "G4ios.hh"
+
+#include <string.h>
+
+using CLHEP::meter;
+using CLHEP::ns;
+using CLHEP::eplus;
+
+namespace {
+const char Magic[8] = {'K', 'M', '3', 'E', 'M', 'I', 'T', 'S'};
+const uint32_t Version = 2;
+
+struct EmitterFileHeader {
+  char Magic[8];
+  uint32_t Version;
+  uint32_t RecordSize;
+};
+}
+
+KM3EmitterWriter::KM3EmitterWriter(const std::string &aFile) {
+  outfile.open(aFile.c_str(), std::ios::out | std::ios::binary);
+  if (!outfile.good())
+    G4Exception("Error opening emitter file", "", FatalException, "");
+  EmitterFileHeader header;
+  memcpy(header.Magic, Magic, 8);
+  header.Version = Version;
+  header.RecordSize = sizeof(KM3EmitterRecord);
+  outfile.write((const char *)&header, sizeof(header));
+  Block.reserve(BlockSize);
+}
+
+KM3EmitterWriter::~KM3EmitterWriter() { outfile.close(); }
+
+void KM3EmitterWriter::AddSegment(const KM3EmitterSegment &aSegment,
+                                  G4int provenance) {
+  KM3EmitterRecord aRecord;
+  aRecord.StartTime = aSegment.StartTime / ns;
+  G4ThreeVector direction = (aSegment.End - aSegment.Start).unit();
+  for (G4int i = 0; i < 3; i++) {
+    aRecord.Start[i] = aSegment.Start[i] / meter;
+    aRecord.Direction[i] = direction[i];
+  }
+  aRecord.Length = aSegment.Length / meter;
+  aRecord.Velocity = aSegment.Velocity / (meter / ns);
+  aRecord.BetaStart = aSegment.BetaStart;
+  aRecord.BetaEnd = aSegment.BetaEnd;
+  aRecord.Charge = aSegment.Charge / eplus;
+  aRecord.Provenance = provenance;
+  Block.push_back(aRecord);
+  if (Block.size() == BlockSize) WriteBlock();
+}
+
+void KM3EmitterWriter::WriteBlock() {
+  uint32_t size = Block.size();
+  outfile.write((const char *)&size, sizeof(size));
+  if (size > 0)
+    outfile.write((const char *)&Block[0], size * sizeof(KM3EmitterRecord));
+  Block.clear();
+}
+
+void KM3EmitterWriter::EndOfEvent(G4int EventNumber) {
+  if (!Block.empty()) WriteBlock();
+  // the empty block closing the event, then its number, which makes it
+  // complete
+  WriteBlock();
+  int64_t number = EventNumber;
+  outfile.write((const char *)&number, sizeof(number));
+  outfile.flush();
+  if (!outfile.good())
+    G4Exception("Error writing emitter file", "", FatalException, "");
+}
+
+KM3EmitterReader::KM3EmitterReader(const std::string &aFile) {
+  infile.open(aFile.c_str(), std::ios::in | std::ios::binary);
+  EmitterFileHeader header;
+  infile.read((char *)&header, sizeof(header));
+  if (!infile.good() || (memcmp(header.Magic, Magic, 8) != 0))
+    G4Exception("Not an emitter file", "", FatalException, "");
+  if ((header.Version != Version) ||
+      (header.RecordSize != sizeof(KM3EmitterRecord)))
+    G4Exception("Emitter file of another version", "", FatalException, "");
+
+  // find where every complete event starts, skipping over the records
+  std::streamoff offset = infile.tellg();
+  infile.seekg(0, std::ios::end);
+  std::streamoff FileSize = infile.tellg();
+  infile.seekg(offset);
+  while (true) {
+    uint32_t size;
+    infile.read((char *)&size, sizeof(size));
+    if (!infile.good()) break;
+    if (size > 0) {
+      infile.seekg(size * sizeof(KM3EmitterRecord), std::ios::cur);
+      continue;
+    }
+    int64_t number;
+    infile.read((char *)&number, sizeof(number));
+    if (!infile.good()) break;
+    EventOffsets.push_back(offset);
+    EventNumbers.push_back(number);
+    offset = infile.tellg();
+  }
+  // the failed read at the end leaves the stream unusable for tellg, the
+  // last complete event has to end the file
+  infile.clear();
+  if (offset != FileSize)
+    G4cout << "Emitter file " << aFile << " ends with an incomplete event"
+           << G4endl;
+  G4cout << "Emitter file " << aFile << ": " << EventOffsets.size()
+         << " events" << G4endl;
+
+  CurrentEvent = -1;
+  NextRecord = 0;
+  EventDone = true;
+}
+
+G4bool KM3EmitterReader::NextEvent() {
+  CurrentEvent++;
+  Block.clear();
+  NextRecord = 0;
+  if (CurrentEvent >= GetNumberOfEvents()) {
+    EventDone = true;
+    return false;
+  }
+  infile.seekg(EventOffsets[CurrentEvent]);
+  EventDone = false;
+  return true;
+}
+
+G4bool KM3EmitterReader::ReadBlock() {
+  uint32_t size;
+  infile.read((char *)&size, sizeof(size));
+  if (!infile.good())
+    G4Exception("Error reading emitter file", "", FatalException, "");
+  Block.resize(size);
+  NextRecord = 0;
+  if (size == 0) return false;
+  infile.read((char *)&Block[0], size * sizeof(KM3EmitterRecord));
+  if (!infile.good())
+    G4Exception("Error reading emitter file", "", FatalException, "");
+  return true;
+}
+
+G4bool KM3EmitterReader::NextSegment(KM3EmitterSegment &aSegment,
+                                     G4int &provenance) {
+  if (EventDone) return false;
+  if ((NextRecord == Block.size()) && !ReadBlock()) {
+    EventDone = true;
+    return false;
+  }
+  const KM3EmitterRecord &aRecord = Block[NextRecord++];
+  aSegment.StartTime = aRecord.StartTime * ns;
+  aSegment.Length = aRecord.Length * meter;
+  aSegment.Start = G4ThreeVector(aRecord.Start[0], aRecord.Start[1],
+                                 aRecord.Start[2]) * meter;
+  aSegment.End = aSegment.Start + G4ThreeVector(aRecord.Direction[0],
+                                                aRecord.Direction[1],
+                                                aRecord.Direction[2]) *
+                                      aSegment.Length;
+  aSegment.Velocity = aRecord.Velocity * (meter / ns);
+  aSegment.BetaStart = aRecord.BetaStart;
+  aSegment.BetaEnd = aRecord.BetaEnd;
+  aSegment.Charge = aRecord.Charge * eplus;
+  aSegment.TrackID = 0;
+  provenance = aRecord.Provenance;
+  return true;
+}
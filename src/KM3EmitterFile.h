@@ -0,0 +1,84 @@
+#ifndef KM3EmitterFile_h
+#define KM3EmitterFile_h 1
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdint.h>
+#include "globals.hh"
+#include "KM3EmitterSegment.h"
+
+// Files of the Cherenkov emitting segments of the events, which split a
+// run in two stages: the transport of the charged particles writes them
+// (--write-emitters), the generation, propagation and detection of the
+// photons reads them back (--read-emitters), with another detector and
+// water. After a header, every event is its segments in blocks of at
+// most BlockSize records, each block preceded by its size, then an empty
+// block and the event number. The file is written one block at a time
+// and flushed after every event, so a stopped job leaves all the events
+// it finished readable, and the reader stops before an incomplete one.
+//
+// Only the segments inside the can of the first stage are written, and
+// only of the tracks its stacking policy kept, so the detector of the
+// second stage has to lie within that can: the light of anything outside
+// it is missing from the file.
+//
+// The start is kept in double, a float only resolves some tens of microns
+// at a few hundred metres, and the end follows from the direction and
+// length.
+struct KM3EmitterRecord {
+  G4double StartTime;    // ns
+  G4double Start[3];     // m
+  G4float Direction[3];  // unit vector
+  G4float Length;        // m
+  G4float Velocity;      // m/ns
+  G4float BetaStart;
+  G4float BetaEnd;
+  G4float Charge;        // e
+  int32_t Provenance;    // packed, see KM3Provenance
+};
+
+class KM3EmitterWriter {
+ public:
+  KM3EmitterWriter(const std::string &aFile);
+  ~KM3EmitterWriter();
+
+  void AddSegment(const KM3EmitterSegment &aSegment, G4int provenance);
+  void EndOfEvent(G4int EventNumber);
+
+  static const uint32_t BlockSize = 4096;
+
+ private:
+  void WriteBlock();
+
+  std::ofstream outfile;
+  std::vector<KM3EmitterRecord> Block;
+};
+
+class KM3EmitterReader {
+ public:
+  KM3EmitterReader(const std::string &aFile);
+  ~KM3EmitterReader() {};
+
+  // the events written completely
+  G4int GetNumberOfEvents() const { return EventOffsets.size(); };
+  // moves to the next event, false after the last one
+  G4bool NextEvent();
+  // as given to KM3EmitterWriter::EndOfEvent
+  G4int GetEventNumber() const { return EventNumbers[CurrentEvent]; };
+  // the next segment of the current event, false after the last one
+  G4bool NextSegment(KM3EmitterSegment &aSegment, G4int &provenance);
+
+ private:
+  G4bool ReadBlock();
+
+  std::ifstream infile;
+  std::vector<std::streamoff> EventOffsets;
+  std::vector<G4int> EventNumbers;
+  G4int CurrentEvent;
+  std::vector<KM3EmitterRecord> Block;
+  size_t NextRecord;
+  G4bool EventDone;
+};
+
+#endif
@@ -0,0 +1,77 @@
+#include "KM3EmitterReplayModel.h"
+#include "KM3Detector.h"
+#include "KM3Cherenkov.h"
+#include "KM3EmitterFile.h"
+#include "KM3TrackInformation.h"
+#include "G4Geantino.hh"
+#include "G4Material.hh"
+#include "Randomize.hh"
+
+KM3EmitterReplayModel::KM3EmitterReplayModel(const G4String &name,
+                                             G4Region *anEnvelope,
+                                             KM3Detector *aDetector)
+    : G4VFastSimulationModel(name, anEnvelope) {
+  myStDetector = aDetector;
+  PhotonsPerCall = 100000;
+}
+
+G4bool KM3EmitterReplayModel::IsApplicable(
+    const G4ParticleDefinition &particle) {
+  return &particle == G4Geantino::GeantinoDefinition();
+}
+
+G4bool KM3EmitterReplayModel::ModelTrigger(const G4FastTrack &fastTrack) {
+  return fastTrack.GetPrimaryTrack()->GetParentID() == 0;
+}
+
+void KM3EmitterReplayModel::DoIt(const G4FastTrack &fastTrack,
+                                 G4FastStep &fastStep) {
+  const G4Track *track = fastTrack.GetPrimaryTrack();
+  fastStep.ProposePrimaryTrackPathLength(0.0);
+
+  // the segments were written in water, the photons are generated in the
+  // water of this run
+  const G4Material *aMaterial = G4Material::GetMaterial("Water");
+  G4MaterialPropertyVector *Rindex =
+      aMaterial->GetMaterialPropertiesTable()->GetProperty("RINDEX");
+  KM3Cherenkov *cherenkov = myStDetector->CherenkovProcess;
+  KM3EmitterReader *reader = myStDetector->EmitterReader;
+  G4int NumberOfRealisations = myStDetector->Realisations;
+
+  thePhotons.clear();
+  G4bool EventDone = false;
+  KM3EmitterSegment aSegment;
+  G4int provenance;
+  while (thePhotons.size() < PhotonsPerCall) {
+    if (!reader->NextSegment(aSegment, provenance)) {
+      EventDone = true;
+      break;
+    }
+    G4double MeanNumPhotons =
+        cherenkov->GetMeanNumberOfPhotons(aSegment, aMaterial, Rindex);
+    if (MeanNumPhotons <= 0.0) continue;
+    for (G4int ir = 0; ir < NumberOfRealisations; ir++) {
+      size_t first = thePhotons.size();
+      cherenkov->EmitPhotons(
+          aSegment, aMaterial, Rindex,
+          (G4int)CLHEP::RandPoisson::shoot(MeanNumPhotons), thePhotons);
+      // the provenance of the stage that wrote the segment
+      for (size_t ip = first; ip < thePhotons.size(); ip++)
+        thePhotons[ip]->SetUserInformation(
+            new KM3TrackInformation(provenance, 0.0, ir));
+    }
+  }
+
+  fastStep.SetNumberOfSecondaryTracks(thePhotons.size());
+  for (size_t ip = 0; ip < thePhotons.size(); ip++) {
+    thePhotons[ip]->SetTouchableHandle(track->GetTouchableHandle());
+    fastStep.AddSecondary(thePhotons[ip]);
+  }
+  thePhotons.clear();
+
+  // back to the stack for the next segments
+  if (EventDone)
+    fastStep.KillPrimaryTrack();
+  else
+    fastStep.ProposeTrackStatus(fSuspend);
+}
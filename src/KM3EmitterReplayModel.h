@@ -0,0 +1,43 @@
+#ifndef KM3EmitterReplayModel_h
+#define KM3EmitterReplayModel_h 1
+
+#include <vector>
+#include "G4VFastSimulationModel.hh"
+#include "G4Region.hh"
+#include "globals.hh"
+#include "KM3EmitterSegment.h"
+
+class G4Track;
+class KM3Detector;
+
+// Second stage of a split run (see KM3EmitterFile). The primary generator
+// puts one geantino in every event, and this model replaces it by the
+// Cherenkov photons of the segments of the event in the emitter file,
+// generated by KM3Cherenkov::EmitPhotons in the water of this detector
+// and with its quantum efficiency. The photons are then propagated and
+// detected as in a full simulation, once per optical realisation.
+//
+// The segments are streamed: every call reads segments until it has
+// PhotonsPerCall photons, hands them over and suspends the geantino,
+// which comes back from the stack for the next ones. The photons wait in
+// the photon stage of KM3StackingAction, which tracks them once they
+// reach its high-water mark, so that a bright event never holds more
+// than that and one chunk.
+class KM3EmitterReplayModel : public G4VFastSimulationModel {
+ public:
+  KM3EmitterReplayModel(const G4String &, G4Region *, KM3Detector *);
+  ~KM3EmitterReplayModel() {};
+
+  G4bool IsApplicable(const G4ParticleDefinition &);
+  G4bool ModelTrigger(const G4FastTrack &);
+  void DoIt(const G4FastTrack &, G4FastStep &);
+
+  size_t PhotonsPerCall;
+
+ private:
+  KM3Detector *myStDetector;
+  // reused from call to call
+  std::vector<G4Track *> thePhotons;
+};
+
+#endif
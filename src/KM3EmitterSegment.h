@@ -0,0 +1,22 @@
+#ifndef KM3EmitterSegment_h
+#define KM3EmitterSegment_h 1
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+
+// A step of a charged particle that emits Cherenkov light: all that
+// KM3Cherenkov needs to generate the photons of the step again, once the
+// step itself is gone.
+struct KM3EmitterSegment {
+  G4ThreeVector Start;
+  G4ThreeVector End;
+  G4double Length;    // along the track, not less than End - Start
+  G4double StartTime;
+  G4double Velocity;  // mean of the two step points
+  G4double BetaStart;
+  G4double BetaEnd;
+  G4double Charge;
+  G4int TrackID;
+};
+
+#endif
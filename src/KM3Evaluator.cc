@@ -0,0 +1,20 @@
+#include "KM3Evaluator.h"
+
+#include <sstream>
+
+KM3Evaluator::KM3Evaluator(const std::string &aFile) {
+  FileName = aFile;
+  fCalc.setSystemOfUnits(1.e+3, 1. / 1.60217733e-25, 1.e+9,
+                         1. / 1.60217733e-10, 1.0, 1.0, 1.0);
+}
+
+G4double KM3Evaluator::Evaluate(const std::string &expression, G4int nline) {
+  G4double value = fCalc.evaluate(expression.c_str());
+  if (fCalc.status() != HepTool::Evaluator::OK) {
+    std::ostringstream message;
+    message << "Invalid expression \"" << expression << "\" at line " << nline
+            << " of " << FileName;
+    G4Exception(message.str().c_str(), "", FatalException, "");
+  }
+  return value;
+}
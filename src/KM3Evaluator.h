@@ -0,0 +1,24 @@
+#ifndef KM3Evaluator_h
+#define KM3Evaluator_h 1
+
+#include <string>
+#include "globals.hh"
+#include "CLHEP/Evaluator/Evaluator.h"
+
+// The expressions with Geant4 units (e.g. 240*keV) of the parameter
+// files. An expression that does not evaluate is a fatal error naming
+// the line of the file, rather than a silent 0.
+class KM3Evaluator {
+ public:
+  KM3Evaluator(const std::string &aFile);
+  ~KM3Evaluator() {};
+
+  // of an expression read from line nline of the file
+  G4double Evaluate(const std::string &expression, G4int nline);
+
+ private:
+  HepTool::Evaluator fCalc;
+  std::string FileName;
+};
+
+#endif
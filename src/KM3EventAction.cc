@@ -1,4 +1,8 @@
 #include "KM3EventAction.h"
+#include "KM3TableBuilder.h"
+#include "KM3ShowerLibrary.h"
+#include "KM3EmitterFile.h"
+#include "KM3Checkpoint.h"
 #include "G4Event.hh"
 #include "G4EventManager.hh"
 #include "G4ParticleTable.hh"
@@ -70,7 +74,7 @@ void KM3EventAction::BeginOfEventAction(const G4Event *) {
   TheEVTtoWrite->ReadEvent();
 }
 
-void KM3EventAction::EndOfEventAction(const G4Event *) {
+void KM3EventAction::EndOfEventAction(const G4Event *anEvent) {
   // write the momentums, positions and times to out file
   G4ThreeVector Momentum;
   G4ThreeVector vzero(0.0, 0.0, 0.0);
@@ -129,4 +133,9 @@ void KM3EventAction::EndOfEventAction(const G4Event *) {
   TheEVTtoWrite->AddMuonEnergyInfo(EnergyAtPosition);
   // write to output file
   TheEVTtoWrite->WriteEvent();
+  if (TableBuilder != NULL) TableBuilder->EndOfEvent();
+  if (ShowerRecorder != NULL) ShowerRecorder->EndOfEvent();
+  if (EmitterWriter != NULL) EmitterWriter->EndOfEvent(anEvent->GetEventID());
+  if (Checkpoint != NULL) Checkpoint->EndOfEvent(anEvent->GetEventID());
+  TrackPool.EndOfEvent();
 }
@@ -9,9 +9,14 @@
 #include <CLHEP/Units/PhysicalConstants.h>
 
 #include "KM3EvtIO.h"
+#include "KM3TrackPool.h"
 
 class G4EventManager;
 class G4Event;
+class KM3TableBuilder;
+class KM3ShowerRecorder;
+class KM3EmitterWriter;
+class KM3Checkpoint;
 
 // class description:
 //
@@ -28,7 +33,12 @@ class G4Event;
 
 class KM3EventAction : public G4UserEventAction {
  public:
-  KM3EventAction() { ; }
+  KM3EventAction() {
+    TableBuilder = NULL;
+    ShowerRecorder = NULL;
+    EmitterWriter = NULL;
+    Checkpoint = NULL;
+  }
   ~KM3EventAction() { ; }
   inline void SetEventManager(G4EventManager *value) { fpEventManager = value; }
 
@@ -59,6 +69,15 @@ class KM3EventAction : public G4UserEventAction {
   std::vector<G4double> stopTime;
   std::vector<G4double> EnergyAtPosition;
   KM3EvtIO *TheEVTtoWrite;
+  KM3TrackPool TrackPool;
+  // closes the exposures of the event when building tables
+  KM3TableBuilder *TableBuilder;
+  // closes the shower of the event when recording a library
+  KM3ShowerRecorder *ShowerRecorder;
+  // closes the event in the emitter file of the first stage of a split run
+  KM3EmitterWriter *EmitterWriter;
+  // records the events done, for --resume
+  KM3Checkpoint *Checkpoint;
 
  public:
   inline void AddPrimaryNumber(G4int);
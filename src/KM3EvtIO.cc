@@ -1,4 +1,5 @@
 #include "KM3EvtIO.h"
+#include "KM3HitsFile.h"
 
 using CLHEP::TeV;
 using CLHEP::GeV;
@@ -7,8 +8,9 @@ using CLHEP::m;
 using CLHEP::cm;
 using CLHEP::ns;
 
-KM3EvtIO::KM3EvtIO(std::string infilechar, std::string outfilechar) {
-  infile.open(infilechar, std::ifstream::in);
+KM3EvtIO::KM3EvtIO(std::string infilechar, std::string outfilechar,
+                   std::streamoff ResumeOffset) {
+  infile.open(infilechar);
   evt = new seaweed::event();
 
   // the following is to find if it is neutrino events
@@ -32,12 +34,29 @@ KM3EvtIO::KM3EvtIO(std::string infilechar, std::string outfilechar) {
   infile.clear();
   infile.seekg(0, std::ios::beg);
 
-  outfile.open(outfilechar, std::ofstream::out);
   RunHeaderIsRead = false;
+  FirstEventOffset = 0;
   RunHeaderIsWrite = false;
+  if (ResumeOffset >= 0) {
+    outfile.resume(outfilechar, ResumeOffset);
+    RunHeaderIsWrite = true;
+  } else {
+    outfile.open(outfilechar);
+  }
+  if (!outfile.good())
+    G4Exception("Error opening the output evt file", "", FatalException, "");
+  NumberOfParticles = 0;
+  LastParticleId = 0;
+  LastParticleHEP = 0;
+  Writer = new KM3EvtWriter(outfile);
+  SetNumberOfRealisations(1);
+  CurrentRealisation = 0;
+  ReplaceInputHits = false;
+  HitsWriter = NULL;
 }
 
 KM3EvtIO::~KM3EvtIO() {
+  delete Writer;
   delete evt;
   infile.close();
   outfile.close();
@@ -46,12 +65,20 @@ KM3EvtIO::~KM3EvtIO() {
 int KM3EvtIO::GetNumberOfEvents() { return nevents; }
 
 void KM3EvtIO::ReadRunHeader() {
-  if (!RunHeaderIsRead) evt->read(infile);
+  if (RunHeaderIsRead) return;
+  evt->read(infile);
   RunHeaderIsRead = true;
+  if (FirstEventOffset > 0) {
+    infile.clear();
+    infile.seekg(FirstEventOffset);
+  }
 }
 
 void KM3EvtIO::WriteRunHeader() {
-  if (!RunHeaderIsWrite) evt->write(outfile);
+  if (!RunHeaderIsWrite) {
+    Blocks.clear();
+    Writer->Write(*evt, Blocks);
+  }
   RunHeaderIsWrite = true;
 }
 
@@ -116,11 +143,11 @@ void KM3EvtIO::ReadEvent(void) {
     int idneu, idtarget;
     double xneu, yneu, zneu, pxneu, pyneu, pzneu, t0;
     GetNeutrinoInfo(idneu, idtarget, xneu, yneu, zneu, pxneu, pyneu, pzneu, t0);
-    int NumberOfParticles = GetNumberOfParticles();
-    if (NumberOfParticles > 1) {
+    int NumberOfPart = GetNumberOfParticles();
+    if (NumberOfPart > 1) {
       int idbeam;
       double xx0, yy0, zz0, pxx0, pyy0, pzz0, t0;
-      for (int ipart = 0; ipart < NumberOfParticles; ipart++) {
+      for (int ipart = 0; ipart < NumberOfPart; ipart++) {
         GetParticleInfo(idbeam, xx0, yy0, zz0, pxx0, pyy0, pzz0, t0);
         if (xx0 != xneu || yy0 != yneu || zz0 != zneu) {
           UseEarthLepton = true;
@@ -129,6 +156,7 @@ void KM3EvtIO::ReadEvent(void) {
       }
     }
   }
+  FillPrimaryTable();
 }
 
 // TODO: duplication?
@@ -158,14 +186,85 @@ void KM3EvtIO::ReadEvent(void) {
 //}
 
 
-void KM3EvtIO::WriteEvent() { evt->write(outfile); }
+void KM3EvtIO::WriteEvent() {
+  char buffer[256];
+  for (int ir = 0; ir < NumberOfRealisations; ir++) {
+    if (NumberOfRealisations > 1) {
+      evt->tagd("hit");
+      evt->tagd("hit_photon");
+      evt->tagd("total_hits");
+      evt->tagd("hit_raw");
+      evt->tagd("total_hits_raw");
+      evt->tagd("trigger");
+      evt->tagd("realisation");
+      sprintf(buffer, "%4d %4d", ir, NumberOfRealisations);
+      evt->taga("realisation", buffer);
+    }
+    if (RealisationKept[ir]) {
+      if (HitsWriter != NULL) HitsWriter->WriteEntry(evt->id(), ir);
+      WriteRealisation(ir);
+    }
+    RealisationHits[ir].clear();
+    RealisationPhotons[ir].clear();
+    RealisationTotals[ir].clear();
+    RealisationRawHits[ir].clear();
+    RealisationRawTotals[ir].clear();
+    RealisationTriggers[ir].clear();
+    RealisationKept[ir] = true;
+  }
+  MuonPoints.clear();
+  MuonDecays.clear();
+  MuonEnergies.clear();
+  if (HitsWriter != NULL) HitsWriter->EndOfEvent();
+}
+
+std::streamoff KM3EvtIO::Sync() {
+  Writer->Flush();
+  return outfile.Sync();
+}
+
+void KM3EvtIO::WriteRealisation(int ir) {
+  HitLines.clear();
+  Writer->FormatHits(RealisationHits[ir], HitLines);
+  Blocks.clear();
+  Blocks.push_back(KM3EvtWriter::Block("hit", &HitLines));
+  Blocks.push_back(KM3EvtWriter::Block("hit_photon", &RealisationPhotons[ir]));
+  Blocks.push_back(KM3EvtWriter::Block("hit_raw", &RealisationRawHits[ir]));
+  Blocks.push_back(KM3EvtWriter::Block("muon_decay", &MuonDecays));
+  Blocks.push_back(KM3EvtWriter::Block("muonaddi_info", &MuonPoints));
+  Blocks.push_back(KM3EvtWriter::Block("muonenergy_info", &MuonEnergies));
+  Blocks.push_back(KM3EvtWriter::Block("total_hits", &RealisationTotals[ir]));
+  Blocks.push_back(
+      KM3EvtWriter::Block("total_hits_raw", &RealisationRawTotals[ir]));
+  Blocks.push_back(KM3EvtWriter::Block("trigger", &RealisationTriggers[ir]));
+  Writer->Write(*evt, Blocks);
+}
+
+void KM3EvtIO::SetNumberOfRealisations(int n) {
+  NumberOfRealisations = n;
+  RealisationHits.resize(n);
+  RealisationPhotons.resize(n);
+  RealisationTotals.resize(n);
+  RealisationRawHits.resize(n);
+  RealisationRawTotals.resize(n);
+  RealisationTriggers.resize(n);
+  RealisationKept.assign(n, true);
+}
+
+std::string KM3EvtIO::HitWord(int id, int PMTid, double pe, double t, int Gid,
+                              int trackid, int npepure, double ttpure,
+                              int creatorProcess) {
+  KM3EvtHit aHit = {id, PMTid, pe, t, Gid, trackid, npepure, ttpure,
+                    creatorProcess};
+  std::string dw;
+  KM3EvtWriter::AppendHit(dw, aHit);
+  return dw;
+}
 
 void KM3EvtIO::AddHit(int id, int PMTid, double pe, double t, int trackid,
                       int npepure, double ttpure, int creatorProcess) {
-  std::string dt("hit");
-  char buffer[256];
   int Gid;
-  if (trackid <= NumberOfParticles) {
+  if ((trackid >= 1) && (trackid <= NumberOfParticles)) {
     Gid = ParticlesHEPNumber[trackid - 1];
     // convert from geant track id to input track id
     trackid = ParticlesIdNumber[trackid - 1];
@@ -174,119 +273,236 @@ void KM3EvtIO::AddHit(int id, int PMTid, double pe, double t, int trackid,
     trackid = 999999;
   }
   PMTid++;  // in the evt file the numbering of pmts starts from 1
-  sprintf(buffer, "%8d %6d %6.2f %10.2f %4d %4d %3d %10.2f %4d", id, PMTid, pe,
-          t, Gid, trackid, npepure, ttpure, creatorProcess);
-  std::string dw(buffer);
-  evt->taga(dt, dw);
+  if (HitsWriter != NULL) {
+    KM3HitRecord aHit;
+    aHit.PMT = PMTid;
+    aHit.Time = t;
+    aHit.NPE = npepure;
+    aHit.Particle = Gid;
+    aHit.Track = trackid;
+    aHit.Creator = creatorProcess;
+    HitsWriter->AddHit(CurrentRealisation, aHit);
+    return;
+  }
+  KM3EvtHit aHit = {id, PMTid, pe, t, Gid, trackid, npepure, ttpure,
+                    creatorProcess};
+  RealisationHits[CurrentRealisation].push_back(aHit);
 }
 
 void KM3EvtIO::AddNumberOfHits(int hitnumber) {
-  std::string dt("total_hits");
-  char buffer[256];
-  sprintf(buffer, "%8d", hitnumber);
-  std::string dw(buffer);
-  evt->taga(dt, dw);
+  if ((NumberOfRealisations <= 1) && ReplaceInputHits) {
+    evt->tagd("hit");
+    evt->tagd("hit_photon");
+    evt->tagd("total_hits");
+    evt->tagd("hit_raw");
+    evt->tagd("total_hits_raw");
+  }
+  if (HitsWriter != NULL) {
+    HitsWriter->SetTotalHits(CurrentRealisation, hitnumber);
+    return;
+  }
+  std::string &dw = RealisationTotals[CurrentRealisation];
+  dw = "total_hits: ";
+  KM3EvtWriter::AppendInt(dw, hitnumber, 8);
+  dw += '\n';
+}
+
+void KM3EvtIO::AddRawHit(int id, int PMTid, int tot, double t) {
+  PMTid++;  // in the evt file the numbering of pmts starts from 1
+  // "%8d %6d %4d %10.2f"
+  std::string &dw = RealisationRawHits[CurrentRealisation];
+  dw.append("hit_raw: ", 9);
+  KM3EvtWriter::AppendInt(dw, id, 8);
+  dw += ' ';
+  KM3EvtWriter::AppendInt(dw, PMTid, 6);
+  dw += ' ';
+  KM3EvtWriter::AppendInt(dw, tot, 4);
+  dw += ' ';
+  KM3EvtWriter::AppendFixed(dw, t, 10, 2);
+  dw += '\n';
+}
+
+void KM3EvtIO::AddNumberOfRawHits(int hitnumber) {
+  if ((NumberOfRealisations <= 1) && ReplaceInputHits) {
+    evt->tagd("hit");
+    evt->tagd("hit_photon");
+    evt->tagd("total_hits");
+    evt->tagd("hit_raw");
+    evt->tagd("total_hits_raw");
+  }
+  std::string &dw = RealisationRawTotals[CurrentRealisation];
+  dw = "total_hits_raw: ";
+  KM3EvtWriter::AppendInt(dw, hitnumber, 8);
+  dw += '\n';
+}
+
+void KM3EvtIO::AddTrigger(int numberL1, int numberDOMs, bool triggered,
+                          bool keep) {
+  if (NumberOfRealisations <= 1) evt->tagd("trigger");
+  // "%6d %6d %2d"
+  std::string &dw = RealisationTriggers[CurrentRealisation];
+  dw = "trigger: ";
+  KM3EvtWriter::AppendInt(dw, numberL1, 6);
+  dw += ' ';
+  KM3EvtWriter::AppendInt(dw, numberDOMs, 6);
+  dw += ' ';
+  KM3EvtWriter::AppendInt(dw, triggered ? 1 : 0, 2);
+  dw += '\n';
+  RealisationKept[CurrentRealisation] = keep;
+}
+
+void KM3EvtIO::AddHitPhoton(int id, double wavelength, double path,
+                            int scatters, double abslength, double scatlength,
+                            double qe) {
+  // "%8d %7.2f %9.3f %4d %8.3f %8.3f %7.5f"
+  std::string &dw = RealisationPhotons[CurrentRealisation];
+  dw.append("hit_photon: ", 12);
+  KM3EvtWriter::AppendInt(dw, id, 8);
+  dw += ' ';
+  KM3EvtWriter::AppendFixed(dw, wavelength, 7, 2);
+  dw += ' ';
+  KM3EvtWriter::AppendFixed(dw, path, 9, 3);
+  dw += ' ';
+  KM3EvtWriter::AppendInt(dw, scatters, 4);
+  dw += ' ';
+  KM3EvtWriter::AppendFixed(dw, abslength, 8, 3);
+  dw += ' ';
+  KM3EvtWriter::AppendFixed(dw, scatlength, 8, 3);
+  dw += ' ';
+  KM3EvtWriter::AppendFixed(dw, qe, 7, 5);
+  dw += '\n';
 }
 
 void KM3EvtIO::AddMuonPositionInfo(int tracknumber, int positionnumber,
                                    double posx, double posy, double posz,
                                    double momx, double momy, double momz,
                                    double mom, double time) {
-  std::string dt("muonaddi_info");
-  char buffer[256];
+  if ((tracknumber < 1) || (tracknumber > NumberOfParticles)) return;
   tracknumber =
       ParticlesIdNumber[tracknumber -
                         1];  // convert from geant track id to input track id
-  sprintf(buffer,
-          "%4d %2d %8.2f %8.2f %8.2f %10.6f %10.6f %10.6f %12.6e %10.2f",
-          tracknumber, positionnumber, posx, posy, posz, momx, momy, momz, mom,
-          time);
-  std::string dw(buffer);
-  evt->taga(dt, dw);
+  AddMuonPoint(tracknumber, positionnumber, true, posx, posy, posz, momx, momy,
+               momz, mom, time);
 }
 
 void KM3EvtIO::AddMuonPositionInfo(int tracknumber, int positionnumber,
                                    double posx, double posy, double posz,
                                    double time) {
-  std::string dt("muonaddi_info");
-  char buffer[256];
+  if ((tracknumber < 1) || (tracknumber > NumberOfParticles)) return;
   tracknumber =
       ParticlesIdNumber[tracknumber -
                         1];  // convert from geant track id to input track id
-  sprintf(buffer, "%4d %2d %8.2f %8.2f %8.2f %10.2f", tracknumber,
-          positionnumber, posx, posy, posz, time);
-  std::string dw(buffer);
-  evt->taga(dt, dw);
+  AddMuonPoint(tracknumber, positionnumber, false, posx, posy, posz, 0.0, 0.0,
+               0.0, 0.0, time);
+}
+
+std::string KM3EvtIO::MuonPositionWord(int tracknumber, int positionnumber,
+                                       bool withMomentum, double posx,
+                                       double posy, double posz, double momx,
+                                       double momy, double momz, double mom,
+                                       double time) {
+  // "%4d %2d %8.2f %8.2f %8.2f %10.6f %10.6f %10.6f %12.6e %10.2f", or
+  // without the direction and the momentum
+  std::string dw;
+  KM3EvtWriter::AppendInt(dw, tracknumber, 4);
+  dw += ' ';
+  KM3EvtWriter::AppendInt(dw, positionnumber, 2);
+  dw += ' ';
+  KM3EvtWriter::AppendFixed(dw, posx, 8, 2);
+  dw += ' ';
+  KM3EvtWriter::AppendFixed(dw, posy, 8, 2);
+  dw += ' ';
+  KM3EvtWriter::AppendFixed(dw, posz, 8, 2);
+  dw += ' ';
+  if (withMomentum) {
+    KM3EvtWriter::AppendFixed(dw, momx, 10, 6);
+    dw += ' ';
+    KM3EvtWriter::AppendFixed(dw, momy, 10, 6);
+    dw += ' ';
+    KM3EvtWriter::AppendFixed(dw, momz, 10, 6);
+    dw += ' ';
+    KM3EvtWriter::AppendExp(dw, mom, 12, 6);
+    dw += ' ';
+  }
+  KM3EvtWriter::AppendFixed(dw, time, 10, 2);
+  return dw;
+}
+
+void KM3EvtIO::AddMuonPoint(int tracknumber, int positionnumber,
+                            bool withMomentum, double posx, double posy,
+                            double posz, double momx, double momy, double momz,
+                            double mom, double time) {
+  if (HitsWriter != NULL) {
+    KM3MuonPointRecord aPoint;
+    aPoint.Track = tracknumber;
+    aPoint.Point = positionnumber;
+    aPoint.WithMomentum = withMomentum;
+    aPoint.Position[0] = posx;
+    aPoint.Position[1] = posy;
+    aPoint.Position[2] = posz;
+    aPoint.Direction[0] = momx;
+    aPoint.Direction[1] = momy;
+    aPoint.Direction[2] = momz;
+    aPoint.Momentum = mom;
+    aPoint.Time = time;
+    HitsWriter->AddMuonPoint(aPoint);
+    return;
+  }
+  MuonPoints.append("muonaddi_info: ", 15);
+  MuonPoints += MuonPositionWord(tracknumber, positionnumber, withMomentum,
+                                 posx, posy, posz, momx, momy, momz, mom, time);
+  MuonPoints += '\n';
 }
 
 void KM3EvtIO::AddMuonDecaySecondaries(int trackID, int parentID, double posx,
                                        double posy, double posz, double dx,
                                        double dy, double dz, double energy,
                                        double time, int idPDG) {
-  if (parentID > NumberOfParticles) return;
+  if ((parentID < 1) || (parentID > NumberOfParticles)) return;
   int Gid = ParticlesHEPNumber[parentID - 1];
   if ((Gid != 5) && (Gid != 6)) return;
   parentID =
       ParticlesIdNumber[parentID -
                         1];  // convert from geant track id to input track id
-  std::string dt("muon_decay");
-  char buffer[256];
-  sprintf(
-      buffer,
-      "%6d %6d %10.3f %10.3f %10.3f %12.8f %12.8f %12.8f %12.6f %10.2f %10d",
-      trackID, parentID, posx, posy, posz, dx, dy, dz, energy, time, idPDG);
-  std::string dw(buffer);
-  evt->taga(dt, dw);
+  // "%6d %6d %10.3f %10.3f %10.3f %12.8f %12.8f %12.8f %12.6f %10.2f %10d"
+  std::string &dw = MuonDecays;
+  dw.append("muon_decay: ", 12);
+  KM3EvtWriter::AppendInt(dw, trackID, 6);
+  dw += ' ';
+  KM3EvtWriter::AppendInt(dw, parentID, 6);
+  dw += ' ';
+  KM3EvtWriter::AppendFixed(dw, posx, 10, 3);
+  dw += ' ';
+  KM3EvtWriter::AppendFixed(dw, posy, 10, 3);
+  dw += ' ';
+  KM3EvtWriter::AppendFixed(dw, posz, 10, 3);
+  dw += ' ';
+  KM3EvtWriter::AppendFixed(dw, dx, 12, 8);
+  dw += ' ';
+  KM3EvtWriter::AppendFixed(dw, dy, 12, 8);
+  dw += ' ';
+  KM3EvtWriter::AppendFixed(dw, dz, 12, 8);
+  dw += ' ';
+  KM3EvtWriter::AppendFixed(dw, energy, 12, 6);
+  dw += ' ';
+  KM3EvtWriter::AppendFixed(dw, time, 10, 2);
+  dw += ' ';
+  KM3EvtWriter::AppendInt(dw, idPDG, 10);
+  dw += '\n';
 }
 
 void KM3EvtIO::AddMuonEnergyInfo(const std::vector<double> &info) {
-  if (info.size() == 0) return;
-  std::string dt("muonenergy_info");
-  char buffer[256];
-  int NumberOfTags = int((info.size() - 1) / 10.0) + 1;
-  for (int itag = 0; itag < NumberOfTags; itag++) {
-    int istart = 10 * itag;
-    int istop = istart + 10;
-    if (istop > info.size()) istop = info.size();
-    int nentries = istop - istart;
-    int i = istart;
-    if (nentries == 10)
-      sprintf(buffer,
-              "%4d %8.2e %8.2e %8.2e %8.2e %8.2e %8.2e %8.2e %8.2e %8.2e %8.2e",
-              itag, info[i], info[i + 1], info[i + 2], info[i + 3], info[i + 4],
-              info[i + 5], info[i + 6], info[i + 7], info[i + 8], info[i + 9]);
-    else if (nentries == 9)
-      sprintf(buffer,
-              "%4d %8.2e %8.2e %8.2e %8.2e %8.2e %8.2e %8.2e %8.2e %8.2e", itag,
-              info[i], info[i + 1], info[i + 2], info[i + 3], info[i + 4],
-              info[i + 5], info[i + 6], info[i + 7], info[i + 8]);
-    else if (nentries == 8)
-      sprintf(buffer, "%4d %8.2e %8.2e %8.2e %8.2e %8.2e %8.2e %8.2e %8.2e",
-              itag, info[i], info[i + 1], info[i + 2], info[i + 3], info[i + 4],
-              info[i + 5], info[i + 6], info[i + 7]);
-    else if (nentries == 7)
-      sprintf(buffer, "%4d %8.2e %8.2e %8.2e %8.2e %8.2e %8.2e %8.2e", itag,
-              info[i], info[i + 1], info[i + 2], info[i + 3], info[i + 4],
-              info[i + 5], info[i + 6]);
-    else if (nentries == 6)
-      sprintf(buffer, "%4d %8.2e %8.2e %8.2e %8.2e %8.2e %8.2e", itag, info[i],
-              info[i + 1], info[i + 2], info[i + 3], info[i + 4], info[i + 5]);
-    else if (nentries == 5)
-      sprintf(buffer, "%4d %8.2e %8.2e %8.2e %8.2e %8.2e", itag, info[i],
-              info[i + 1], info[i + 2], info[i + 3], info[i + 4]);
-    else if (nentries == 4)
-      sprintf(buffer, "%4d %8.2e %8.2e %8.2e %8.2e", itag, info[i], info[i + 1],
-              info[i + 2], info[i + 3]);
-    else if (nentries == 3)
-      sprintf(buffer, "%4d %8.2e %8.2e %8.2e", itag, info[i], info[i + 1],
-              info[i + 2]);
-    else if (nentries == 2)
-      sprintf(buffer, "%4d %8.2e %8.2e", itag, info[i], info[i + 1]);
-    else if (nentries == 1)
-      sprintf(buffer, "%4d %8.2e", itag, info[i]);
-    std::string dw(buffer);
-    evt->taga(dt, dw);
+  // lines of "%4d" and up to ten "%8.2e"
+  for (size_t i = 0; i < info.size(); i++) {
+    if (i % 10 == 0) {
+      if (i > 0) MuonEnergies += '\n';
+      MuonEnergies.append("muonenergy_info: ", 17);
+      KM3EvtWriter::AppendInt(MuonEnergies, i / 10, 4);
+    }
+    MuonEnergies += ' ';
+    KM3EvtWriter::AppendExp(MuonEnergies, info[i], 8, 2);
   }
+  if (!info.empty()) MuonEnergies += '\n';
 }
 
 void KM3EvtIO::InitPDGTables(void) {
@@ -515,6 +731,8 @@ void KM3EvtIO::GetParticleInfo(int &idbeam, double &xx0, double &yy0,
   double args[100];
   int argnumber;
   GetArgs(ParticleInfo, argnumber, args);
+  LastParticleId = (int)args[0];
+  LastParticleHEP = (int)args[9];
   if ((int)args[9] <= 0) {
     // in order to get rid off particles that are not standard (pythia
     // or genie internal code particles e.g. 93)
@@ -635,6 +853,51 @@ void KM3EvtIO::GetArgs(std::string &chd, int &argnumber, double *args) {
 
 bool KM3EvtIO::IsNeutrinoEvent(void) { return isneutrinoevent; }
 
+// particles that are not defined or have not decay modes in GEANT4
+static bool IsSkippedByGeant4(int idbeam) {
+  return abs(idbeam) == 411 || abs(idbeam) == 421 || abs(idbeam) == 431 ||
+         abs(idbeam) == 4122 || abs(idbeam) == 4212 || abs(idbeam) == 4222;
+}
+
+void KM3EvtIO::FillPrimaryTable(void) {
+  NumberOfParticles = 0;
+  int idbeam;
+  double xx0, yy0, zz0, pxx0, pyy0, pzz0, t0;
+  int NHEP = GetNumberOfParticles();
+  if (!isneutrinoevent) {
+    // every input track is injected
+    for (int IHEP = 0; IHEP < NHEP; IHEP++) {
+      GetParticleInfo(idbeam, xx0, yy0, zz0, pxx0, pyy0, pzz0, t0);
+      RegisterPrimary();
+    }
+  } else if (hasbundleinfo) {
+    // the neutrino vertex comes first, then the bundle muons
+    ReadNeutrinoVertexParticles = true;
+    for (int IHEP = 0; IHEP < NHEP; IHEP++) {
+      GetParticleInfo(idbeam, xx0, yy0, zz0, pxx0, pyy0, pzz0, t0);
+      if (idbeam != 0 && !IsSkippedByGeant4(idbeam)) RegisterPrimary();
+    }
+    NHEP = GetNumberOfParticles();
+    ReadNeutrinoVertexParticles = false;
+    for (int IHEP = 0; IHEP < NHEP; IHEP++) {
+      GetParticleInfo(idbeam, xx0, yy0, zz0, pxx0, pyy0, pzz0, t0);
+      if (idbeam != 0) RegisterPrimary();
+    }
+  } else {
+    for (int IHEP = 0; IHEP < NHEP; IHEP++) {
+      GetParticleInfo(idbeam, xx0, yy0, zz0, pxx0, pyy0, pzz0, t0);
+      if (idbeam != 0 && !IsSkippedByGeant4(idbeam)) RegisterPrimary();
+    }
+  }
+}
+
+void KM3EvtIO::RegisterPrimary(void) {
+  if (NumberOfParticles >= 210000) return;
+  ParticlesIdNumber[NumberOfParticles] = LastParticleId;
+  ParticlesHEPNumber[NumberOfParticles] = LastParticleHEP;
+  NumberOfParticles++;
+}
+
 void KM3EvtIO::GeneratePrimaryVertex(G4Event *anEvent) {
   if (isneutrinoevent && hasbundleinfo) {
     // first read the information of the neutrino vertex
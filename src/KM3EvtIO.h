@@ -2,6 +2,8 @@
 #define KM3EvtIO_h
 
 #include "seaweed.h"
+#include "KM3EvtWriter.h"
+#include "KM3CompressedStream.h"
 #include <stdlib.h>
 #include <math.h>
 
@@ -18,19 +20,64 @@
 #include <CLHEP/Units/SystemOfUnits.h>
 #include <CLHEP/Units/PhysicalConstants.h>
 
+class KM3HitsWriter;
+
 class KM3EvtIO {
  public:
-  KM3EvtIO(std::string infile, std::string outfile);
+  // a ResumeOffset from a checkpoint (see KM3Checkpoint) appends to the
+  // outfile truncated to it, without writing the run header again
+  KM3EvtIO(std::string infile, std::string outfile,
+           std::streamoff ResumeOffset = -1);
   ~KM3EvtIO();
 
   void ReadRunHeader();
+  // the events are read from this offset on, after the run header (see
+  // KM3EvtIndex)
+  void SetFirstEventOffset(std::streamoff offset) {
+    FirstEventOffset = offset;
+  };
   void WriteRunHeader();
   // taken from writer
   //void ReadEvent();
   void WriteEvent();
+  // the events written so far go to the file, returns its size
+  std::streamoff Sync();
+  // of the next event to read
+  std::streamoff GetInputOffset() { return infile.tellg(); };
   void AddHit(int id, int PMTid, double pe, double t, int trackid, int npepure,
               double ttpure, int creatorProcess);
   void AddNumberOfHits(int hitnumber);
+  // the hits of the input events are replaced rather than added to, for
+  // the second stage of a split run that reads the output of the first
+  void SetReplaceInputHits(bool replace) { ReplaceInputHits = replace; };
+  // the hits and the muon truth go to a columnar hits file instead (see
+  // KM3HitsWriter), the writer is not owned
+  void SetHitsWriter(KM3HitsWriter *aWriter) { HitsWriter = aWriter; };
+  // threads formatting the hits of the large events
+  void SetFormatThreads(int n) { Writer->Threads = n; };
+  // the hit and muonaddi_info words
+  static std::string HitWord(int id, int PMTid, double pe, double t, int Gid,
+                             int trackid, int npepure, double ttpure,
+                             int creatorProcess);
+  static std::string MuonPositionWord(int tracknumber, int positionnumber,
+                                      bool withMomentum, double posx,
+                                      double posy, double posz, double momx,
+                                      double momy, double momz, double mom,
+                                      double time);
+  // the digitized hits (see KM3Digitizer) in place of the hits
+  void AddRawHit(int id, int PMTid, int tot, double t);
+  void AddNumberOfRawHits(int hitnumber);
+  // the decision of the trigger emulation (see KM3Trigger). An event
+  // that is not kept is not written
+  void AddTrigger(int numberL1, int numberDOMs, bool triggered, bool keep);
+  // one of the photons merged into hit id, for the extended hit records
+  void AddHitPhoton(int id, double wavelength, double path, int scatters,
+                    double abslength, double scatlength, double qe);
+  // the photons of an event can be simulated several times over the
+  // same particles. The hits of every realisation are kept apart and the
+  // event is written once per realisation, with a realisation tag
+  void SetNumberOfRealisations(int n);
+  void SetRealisation(int k) { CurrentRealisation = k; };
   void AddMuonPositionInfo(int tracknumber, int positionnumber, double posx,
                            double posy, double posz, double momx, double momy,
                            double momz, double mom, double time);
@@ -59,9 +106,10 @@ class KM3EvtIO {
 
  private:
   seaweed::event *evt;
-  std::ifstream infile;
-  std::ofstream outfile;
+  KM3InputStream infile;
+  KM3OutputStream outfile;
   bool RunHeaderIsRead;
+  std::streamoff FirstEventOffset;
   bool RunHeaderIsWrite;
   int ParticlesHEPNumber[210000];
   int ParticlesIdNumber[210000];
@@ -69,6 +117,16 @@ class KM3EvtIO {
   bool hasbundleinfo;
   void GetArgs(std::string &chd, int &argnumber, double *args);
   int NumberOfParticles;
+  int LastParticleId;
+  int LastParticleHEP;
+  // map the geant track ids of the primaries back to the input tracks,
+  // following the order in which GeneratePrimaryVertex creates them
+  void FillPrimaryTable(void);
+  void RegisterPrimary(void);
+  // a muonaddi_info word, or its record in the hits file
+  void AddMuonPoint(int tracknumber, int positionnumber, bool withMomentum,
+                    double posx, double posy, double posz, double momx,
+                    double momy, double momz, double mom, double time);
 
   // taken from reader
   int nevents;
@@ -79,6 +137,28 @@ class KM3EvtIO {
   double GetParticleMass(int hepcode);
   bool UseEarthLepton;
   bool ReadNeutrinoVertexParticles;
+
+  int NumberOfRealisations;
+  int CurrentRealisation;
+  bool ReplaceInputHits;
+  KM3EvtWriter *Writer;
+  KM3HitsWriter *HitsWriter;
+  // the words added to the event, written by KM3EvtWriter. The hits are
+  // kept as numbers, the other tags as their formatted lines. The hit,
+  // hit_photon, total_hits and trigger words are per realisation
+  std::vector<std::vector<KM3EvtHit> > RealisationHits;
+  std::vector<std::string> RealisationPhotons;
+  std::vector<std::string> RealisationTotals;
+  std::vector<std::string> RealisationRawHits;
+  std::vector<std::string> RealisationRawTotals;
+  std::vector<std::string> RealisationTriggers;
+  std::vector<bool> RealisationKept;
+  std::string MuonPoints;
+  std::string MuonDecays;
+  std::string MuonEnergies;
+  std::string HitLines;
+  std::vector<KM3EvtWriter::Block> Blocks;
+  void WriteRealisation(int ir);
 };
 #endif   // KM3EvtIO_h
 
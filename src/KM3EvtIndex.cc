@@ -0,0 +1,83 @@
+#include "KM3EvtIndex.h"
+#include "KM3CompressedStream.h"
+#include "G4ios.hh"
+
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+const char IndexMagic[8] = {'K', 'M', '3', 'E', 'I', 'D', 'X', '1'};
+}
+
+KM3EvtIndex::KM3EvtIndex(const std::string &anEvtFile,
+                         const std::string &anIndexFile) {
+  struct stat info;
+  if (stat(anEvtFile.c_str(), &info) != 0)
+    G4Exception("Error opening the input evt file", "", FatalException, "");
+  FileSize = info.st_size;
+  FileTime = info.st_mtime;
+  if (Read(anIndexFile)) return;
+  G4cout << "Indexing the events of " << anEvtFile << "..." << G4endl;
+  Scan(anEvtFile);
+  Write(anIndexFile);
+}
+
+G4bool KM3EvtIndex::Read(const std::string &anIndexFile) {
+  std::ifstream infile(anIndexFile.c_str(), std::ios::in | std::ios::binary);
+  if (!infile.good()) return false;
+  char magic[8];
+  uint64_t size, n;
+  int64_t time;
+  infile.read(magic, sizeof(magic));
+  infile.read((char *)&size, sizeof(size));
+  infile.read((char *)&time, sizeof(time));
+  infile.read((char *)&n, sizeof(n));
+  if (!infile.good() || (memcmp(magic, IndexMagic, sizeof(magic)) != 0) ||
+      (size != FileSize) || (time != FileTime)) {
+    G4cout << "The event index " << anIndexFile << " is out of date" << G4endl;
+    return false;
+  }
+  Offsets.resize(n);
+  if (n > 0) infile.read((char *)&Offsets[0], n * sizeof(uint64_t));
+  if (!infile.good())
+    G4Exception("Error reading the event index", "", FatalException, "");
+  return true;
+}
+
+void KM3EvtIndex::Scan(const std::string &anEvtFile) {
+  KM3InputStream infile(anEvtFile);
+  if (!infile.good())
+    G4Exception("Error opening the input evt file", "", FatalException, "");
+  Offsets.clear();
+  uint64_t offset = 0;
+  std::string line;
+  while (std::getline(infile, line)) {
+    if (line.compare(0, 12, "start_event:") == 0) Offsets.push_back(offset);
+    offset += line.size() + 1;
+  }
+}
+
+// through a temporary file, as the jobs sharing the input may all be
+// writing it
+void KM3EvtIndex::Write(const std::string &anIndexFile) {
+  std::ostringstream tmpname;
+  tmpname << anIndexFile << ".tmp" << getpid();
+  std::ofstream outfile(tmpname.str().c_str(),
+                        std::ios::out | std::ios::binary);
+  uint64_t n = Offsets.size();
+  outfile.write(IndexMagic, sizeof(IndexMagic));
+  outfile.write((const char *)&FileSize, sizeof(FileSize));
+  outfile.write((const char *)&FileTime, sizeof(FileTime));
+  outfile.write((const char *)&n, sizeof(n));
+  if (n > 0) outfile.write((const char *)&Offsets[0], n * sizeof(uint64_t));
+  outfile.close();
+  if (outfile.fail() ||
+      (rename(tmpname.str().c_str(), anIndexFile.c_str()) != 0)) {
+    remove(tmpname.str().c_str());
+    G4cout << "Could not write the event index " << anIndexFile << G4endl;
+  }
+}
@@ -0,0 +1,38 @@
+#ifndef KM3EvtIndex_h
+#define KM3EvtIndex_h 1
+
+#include <string>
+#include <vector>
+#include <ios>
+#include <stdint.h>
+#include "globals.hh"
+
+// The offsets of the start_event lines of an evt file, to seek straight
+// to an event and to count the events without reading them. The offsets
+// are in the uncompressed file: the seek is a real one on a plain file
+// and decompresses up to the event on a gzip one.
+//
+// The index is read from a sidecar file if it is there and matches the
+// size and time of the evt file, otherwise the evt file is scanned and
+// the sidecar written for the next jobs. The sidecar is "KM3EIDX1", the
+// size and modification time of the evt file, the number of events and
+// their offsets, all 64 bit.
+class KM3EvtIndex {
+ public:
+  KM3EvtIndex(const std::string &anEvtFile, const std::string &anIndexFile);
+  ~KM3EvtIndex() {};
+
+  G4int GetNumberOfEvents() const { return Offsets.size(); };
+  std::streamoff GetOffset(G4int iev) const { return Offsets[iev]; };
+
+ private:
+  G4bool Read(const std::string &anIndexFile);
+  void Scan(const std::string &anEvtFile);
+  void Write(const std::string &anIndexFile);
+
+  uint64_t FileSize;
+  int64_t FileTime;
+  std::vector<uint64_t> Offsets;
+};
+
+#endif
@@ -0,0 +1,169 @@
+#include "KM3EvtWriter.h"
+#include "globals.hh"
+
+#include <algorithm>
+#include <thread>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+namespace {
+// the buffer is written out when it gets over this size
+const size_t FlushSize = 1 << 22;
+// fewer hits than this per thread are formatted in one go
+const size_t HitsPerThread = 100000;
+
+const double Powers[] = {1.0, 1.e1, 1.e2, 1.e3, 1.e4,
+                         1.e5, 1.e6, 1.e7, 1.e8, 1.e9};
+
+bool TagFirst(const KM3EvtWriter::Block &a, const KM3EvtWriter::Block &b) {
+  return strcmp(a.Tag, b.Tag) < 0;
+}
+
+void AppendHitLine(std::string &out, const KM3EvtHit &aHit) {
+  out.append("hit: ", 5);
+  KM3EvtWriter::AppendHit(out, aHit);
+  out += '\n';
+}
+}
+
+KM3EvtWriter::KM3EvtWriter(std::ostream &aStream) : Stream(aStream) {
+  Threads = 1;
+  Buffer.reserve(FlushSize + FlushSize / 4);
+}
+
+KM3EvtWriter::~KM3EvtWriter() { Flush(); }
+
+void KM3EvtWriter::Flush() {
+  if (Buffer.empty()) return;
+  Stream.write(Buffer.data(), Buffer.size());
+  Stream.flush();
+  if (Stream.bad())
+    G4Exception("Error writing the evt file", "", FatalException, "");
+  Buffer.clear();
+}
+
+void KM3EvtWriter::Write(seaweed::event &anEvent, std::vector<Block> &blocks) {
+  bool new_run, new_event;
+  unsigned nr, ne, type;
+  anEvent.info(new_run, new_event, nr, ne, type);
+  if (!new_event) return;
+  char header[64];
+  if (new_run)
+    sprintf(header, "start_run: %u\n", nr);
+  else
+    sprintf(header, "start_event: %u %u\n", ne, type);
+  Buffer += header;
+
+  // a block goes after the input words of its tag
+  std::sort(blocks.begin(), blocks.end(), TagFirst);
+  size_t ib = 0;
+  const seaweed::ev_multimap &words = anEvent.data();
+  for (seaweed::ev_multimap::const_iterator it = words.begin();
+       it != words.end(); ++it) {
+    while ((ib < blocks.size()) && (it->first.compare(blocks[ib].Tag) > 0))
+      Buffer += *blocks[ib++].Lines;
+    Buffer += it->first;
+    Buffer.append(": ", 2);
+    Buffer += it->second;
+    Buffer += '\n';
+  }
+  while (ib < blocks.size()) Buffer += *blocks[ib++].Lines;
+  Buffer += "end_event:\n";
+  if (Buffer.size() >= FlushSize) Flush();
+}
+
+void KM3EvtWriter::FormatHits(const std::vector<KM3EvtHit> &hits,
+                              std::string &out) const {
+  size_t n = hits.size();
+  size_t threads = std::min((size_t)std::max(Threads, 1), n / HitsPerThread);
+  if (threads <= 1) {
+    for (size_t i = 0; i < n; i++) AppendHitLine(out, hits[i]);
+    return;
+  }
+  // contiguous ranges, put together in order
+  std::vector<std::string> parts(threads);
+  std::vector<std::thread> workers;
+  for (size_t ith = 0; ith < threads; ith++)
+    workers.push_back(std::thread([&hits, &parts, ith, threads, n]() {
+      size_t first = n * ith / threads;
+      size_t last = n * (ith + 1) / threads;
+      parts[ith].reserve((last - first) * 80);
+      for (size_t i = first; i < last; i++) AppendHitLine(parts[ith], hits[i]);
+    }));
+  for (size_t ith = 0; ith < threads; ith++) workers[ith].join();
+  for (size_t ith = 0; ith < threads; ith++) out += parts[ith];
+}
+
+void KM3EvtWriter::AppendInt(std::string &out, long value, int width) {
+  char buffer[32];
+  char *end = buffer + sizeof(buffer);
+  char *p = end;
+  unsigned long u = (value < 0) ? 0ul - (unsigned long)value : value;
+  do {
+    *--p = '0' + u % 10;
+    u /= 10;
+  } while (u > 0);
+  if (value < 0) *--p = '-';
+  for (int i = end - p; i < width; i++) out += ' ';
+  out.append(p, end - p);
+}
+
+void KM3EvtWriter::AppendFixed(std::string &out, double value, int width,
+                               int precision) {
+  // below 1e9 the scaled value is off by less than 1e-7, so its rounding
+  // is the one of printf unless it is that close to a tie
+  double scaled = fabs(value) * Powers[precision];
+  double whole = floor(scaled);
+  if (!(scaled < 1.e9) || (fabs(scaled - whole - 0.5) < 1.e-6)) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%*.*f", width, precision, value);
+    out += buffer;
+    return;
+  }
+  uint64_t digits = (uint64_t)whole + ((scaled - whole > 0.5) ? 1 : 0);
+  char buffer[32];
+  char *end = buffer + sizeof(buffer);
+  char *p = end;
+  for (int i = 0; i < precision; i++) {
+    *--p = '0' + digits % 10;
+    digits /= 10;
+  }
+  if (precision > 0) *--p = '.';
+  do {
+    *--p = '0' + digits % 10;
+    digits /= 10;
+  } while (digits > 0);
+  if (signbit(value)) *--p = '-';
+  for (int i = end - p; i < width; i++) out += ' ';
+  out.append(p, end - p);
+}
+
+void KM3EvtWriter::AppendExp(std::string &out, double value, int width,
+                             int precision) {
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), "%*.*e", width, precision, value);
+  out += buffer;
+}
+
+void KM3EvtWriter::AppendHit(std::string &out, const KM3EvtHit &aHit) {
+  // "%8d %6d %6.2f %10.2f %4d %4d %3d %10.2f %4d"
+  AppendInt(out, aHit.Id, 8);
+  out += ' ';
+  AppendInt(out, aHit.PMTid, 6);
+  out += ' ';
+  AppendFixed(out, aHit.pe, 6, 2);
+  out += ' ';
+  AppendFixed(out, aHit.t, 10, 2);
+  out += ' ';
+  AppendInt(out, aHit.Gid, 4);
+  out += ' ';
+  AppendInt(out, aHit.trackid, 4);
+  out += ' ';
+  AppendInt(out, aHit.npepure, 3);
+  out += ' ';
+  AppendFixed(out, aHit.ttpure, 10, 2);
+  out += ' ';
+  AppendInt(out, aHit.creatorProcess, 4);
+}
@@ -0,0 +1,68 @@
+#ifndef KM3EvtWriter_h
+#define KM3EvtWriter_h 1
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "seaweed.h"
+
+// a hit word, kept as numbers until the event is written
+struct KM3EvtHit {
+  int Id;
+  int PMTid;  // from 1, as in the evt file
+  double pe;
+  double t;
+  int Gid;
+  int trackid;
+  int npepure;
+  double ttpure;
+  int creatorProcess;
+};
+
+// Writes the events of an evt file through one large buffer, written out
+// in big blocks, instead of seaweed::event::write with a flush on every
+// line. The words added by the simulation are formatted straight into
+// the buffer by tag and merged with the words of the input event in the
+// order seaweed would write them: by tag, the input words first.
+//
+// The numbers are formatted by hand with the same output as the printf
+// formats of the evt file, printf is only called for the exponents and
+// for the fixed point values too close to a rounding tie to be sure.
+class KM3EvtWriter {
+ public:
+  // the formatted lines ("tag: word\n") of one tag
+  struct Block {
+    Block(const char *aTag, const std::string *aLines)
+        : Tag(aTag), Lines(aLines) {};
+    const char *Tag;
+    const std::string *Lines;
+  };
+
+  KM3EvtWriter(std::ostream &aStream);
+  // writes what is left in the buffer
+  ~KM3EvtWriter();
+
+  // the event with the lines of the blocks added to its tags
+  void Write(seaweed::event &anEvent, std::vector<Block> &blocks);
+  void Flush();
+
+  // the hit lines, split over Threads for the large events
+  void FormatHits(const std::vector<KM3EvtHit> &hits, std::string &out) const;
+
+  // as printf %<width>d, %<width>.<precision>f and %<width>.<precision>e
+  static void AppendInt(std::string &out, long value, int width);
+  static void AppendFixed(std::string &out, double value, int width,
+                          int precision);
+  static void AppendExp(std::string &out, double value, int width,
+                        int precision);
+  // the word of a hit, without the tag
+  static void AppendHit(std::string &out, const KM3EvtHit &aHit);
+
+  int Threads;
+
+ private:
+  std::ostream &Stream;
+  std::string Buffer;
+};
+
+#endif
@@ -12,7 +12,7 @@ KM3HAEnergyFlux::KM3HAEnergyFlux(char *infileParam, G4double QEmax,
                                  G4double EneMax) {
   NPartsDists = 2;  // is the number of distributions kept (now it is 2, for 211
                     // (pi+) and 130 (KaonZeroLong))
-  std::ifstream infile(infileParam, std::ios::in | std::ios::binary);
+  KM3TableCursor infile(KM3MappedFile::Open(infileParam), 0);
   keepEnergies = new std::vector<KM3EMDistanceFlux *>;
   keepEnergies->reserve(NPartsDists);
   EnergyMin = log10(EneMin);  // the energy range the distributions apply
@@ -21,7 +21,6 @@ KM3HAEnergyFlux::KM3HAEnergyFlux(char *infileParam, G4double QEmax,
     KM3EMDistanceFlux *aDistanceFlux = new KM3EMDistanceFlux(infile);
     keepEnergies->push_back(aDistanceFlux);
   }
-  infile.close();
   RatioThis = QEmax * TotCathodArea;
   // next is photon output of HA particles with arbitrary scaling
   // they are for particles (-2212, -2112, 130, +-211, +-321, 2112, 2212) in
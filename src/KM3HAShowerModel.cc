@@ -0,0 +1,128 @@
+#include "KM3HAShowerModel.h"
+#include "KM3Detector.h"
+#include "KM3SD.h"
+#include "G4MuonMinus.hh"
+#include "G4MuonPlus.hh"
+#include "G4DynamicParticle.hh"
+#include "Randomize.hh"
+
+using CLHEP::GeV;
+using CLHEP::meter;
+using CLHEP::ns;
+
+namespace {
+// the flux of one species, with the bins the sampler asks for
+struct SpeciesFlux {
+  KM3HAEnergyFlux *aFlux;
+  G4int idbeam;
+  void FindBins(G4double energy, G4double distance, G4double angle) {
+    aFlux->FindBins(idbeam, energy, distance, angle);
+  }
+  G4int GetNumberOfSamples() { return aFlux->GetNumberOfSamples(); }
+  onePE GetSamplePoint() { return aFlux->GetSamplePoint(); }
+};
+}
+
+KM3HAShowerModel::KM3HAShowerModel(const G4String &name, G4Region *anEnvelope,
+                                   KM3Detector *aDetector, KM3SD *aSD)
+    : G4VFastSimulationModel(name, anEnvelope), mySampler(aDetector, aSD) {
+  myStDetector = aDetector;
+  aMySD = aSD;
+  myFlux = NULL;
+  myMuons = NULL;
+  EnergyThreshold = 10.0 * GeV;
+  EnergyMax = 100.0 * CLHEP::PeV;
+}
+
+KM3HAShowerModel::~KM3HAShowerModel() {
+  delete myFlux;
+  delete myMuons;
+}
+
+void KM3HAShowerModel::LoadTables(const G4String &aFile) {
+  delete myFlux;
+  myFlux = new KM3HAEnergyFlux((char *)aFile.c_str(), aMySD->GetMaxQE(),
+                               myStDetector->TotCathodArea, EnergyThreshold,
+                               EnergyMax);
+}
+
+void KM3HAShowerModel::LoadMuons(const G4String &aFile,
+                                 const G4String &anIndexFile) {
+  delete myMuons;
+  myMuons = new HAVertexMuons((char *)aFile.c_str(),
+                              (char *)anIndexFile.c_str());
+}
+
+// the species KM3HAEnergyFlux has a photon yield for
+G4bool KM3HAShowerModel::IsApplicable(const G4ParticleDefinition &particle) {
+  switch (particle.GetPDGEncoding()) {
+    case 211:
+    case -211:
+    case 321:
+    case -321:
+    case 130:
+    case 2212:
+    case -2212:
+    case 2112:
+    case -2112:
+      return true;
+    default:
+      return false;
+  }
+}
+
+G4bool KM3HAShowerModel::ModelTrigger(const G4FastTrack &fastTrack) {
+  const G4Track *track = fastTrack.GetPrimaryTrack();
+  G4double energy = track->GetKineticEnergy();
+  if ((energy < EnergyThreshold) || (energy > EnergyMax)) return false;
+  return myStDetector->BoundingVolume->IsInside(track->GetPosition());
+}
+
+void KM3HAShowerModel::DoIt(const G4FastTrack &fastTrack,
+                            G4FastStep &fastStep) {
+  const G4Track *track = fastTrack.GetPrimaryTrack();
+  G4int idbeam = track->GetDefinition()->GetPDGEncoding();
+  G4double energy = track->GetKineticEnergy();
+  G4ThreeVector x0 = track->GetPosition();
+  G4ThreeVector p0 = track->GetMomentumDirection();
+  G4double t0 = track->GetGlobalTime();
+
+  fastStep.KillPrimaryTrack();
+  fastStep.ProposePrimaryTrackPathLength(0.0);
+  fastStep.ProposeTotalEnergyDeposited(energy);
+
+  SpeciesFlux aFlux = {myFlux, idbeam};
+  mySampler.Emit(&aFlux, energy, x0, p0, t0, mySampler.GetProvenance(track));
+
+  if (myMuons != NULL) InjectMuons(track, fastStep);
+}
+
+// the library keeps the muons of showers along +z starting at the
+// origin, with positions in m, momenta in GeV and times in ns. It has no
+// charge, so the sign of each muon is drawn
+void KM3HAShowerModel::InjectMuons(const G4Track *track,
+                                   G4FastStep &fastStep) {
+  G4int NumberOfMuons =
+      myMuons->GetNumberOfMuons(track->GetKineticEnergy() / GeV);
+  if (NumberOfMuons <= 0) return;
+  G4ThreeVector x0 = track->GetPosition();
+  G4ThreeVector p0 = track->GetMomentumDirection();
+  G4double t0 = track->GetGlobalTime();
+
+  fastStep.SetNumberOfSecondaryTracks(NumberOfMuons);
+  for (G4int imu = 0; imu < NumberOfMuons; imu++) {
+    myMuons->ReadMuon();
+    G4ThreeVector position = myMuons->GetPosition() * meter;
+    G4ThreeVector momentum = myMuons->GetMomentum() * GeV;
+    position.rotateUz(p0);
+    momentum.rotateUz(p0);
+    G4ParticleDefinition *muon;
+    if (G4UniformRand() < 0.5)
+      muon = G4MuonMinus::MuonMinusDefinition();
+    else
+      muon = G4MuonPlus::MuonPlusDefinition();
+    G4DynamicParticle aMuon(muon, momentum);
+    fastStep.CreateSecondaryTrack(aMuon, x0 + position,
+                                  t0 + myMuons->GetTime() * ns, false);
+  }
+}
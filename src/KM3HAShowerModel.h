@@ -0,0 +1,45 @@
+#ifndef KM3HAShowerModel_h
+#define KM3HAShowerModel_h 1
+
+#include "G4VFastSimulationModel.hh"
+#include "G4Region.hh"
+#include "globals.hh"
+#include "KM3HAEnergyFlux.h"
+#include "HAVertexMuons.h"
+#include "KM3OMSampler.h"
+#include <CLHEP/Units/SystemOfUnits.h>
+
+class KM3Detector;
+class KM3SD;
+
+// Fast simulation of hadronic showers. A charged pion or kaon, K0L,
+// (anti)proton or (anti)neutron above EnergyThreshold is killed, its
+// light is sampled per OM from KM3HAEnergyFlux and, when a muon library
+// is loaded, the muons produced in the shower are taken from
+// HAVertexMuons and tracked by Geant4 as secondaries of the hadron.
+class KM3HAShowerModel : public G4VFastSimulationModel {
+ public:
+  KM3HAShowerModel(const G4String &, G4Region *, KM3Detector *, KM3SD *);
+  ~KM3HAShowerModel();
+
+  void LoadTables(const G4String &aFile);
+  void LoadMuons(const G4String &aFile, const G4String &anIndexFile);
+
+  G4bool IsApplicable(const G4ParticleDefinition &);
+  G4bool ModelTrigger(const G4FastTrack &);
+  void DoIt(const G4FastTrack &, G4FastStep &);
+
+  G4double EnergyThreshold;
+  G4double EnergyMax;
+
+ private:
+  void InjectMuons(const G4Track *, G4FastStep &);
+
+  KM3Detector *myStDetector;
+  KM3SD *aMySD;
+  KM3HAEnergyFlux *myFlux;
+  HAVertexMuons *myMuons;
+  KM3OMSampler mySampler;
+};
+
+#endif
@@ -9,15 +9,16 @@
 
 G4Allocator<KM3Hit> KM3HitAllocator;
 
-KM3Hit::KM3Hit() {}
+KM3Hit::KM3Hit() { Photon = NULL; }
 
-KM3Hit::~KM3Hit() {}
+KM3Hit::~KM3Hit() { delete Photon; }
 
 KM3Hit::KM3Hit(const KM3Hit &right) {
   CathodId = right.CathodId;
   time = right.time;
   originalInfo = right.originalInfo;
   IMany = right.IMany;
+  Photon = (right.Photon != NULL) ? new KM3HitPhoton(*right.Photon) : NULL;
   // short  angleIncident=right.angleIncident;
   // short  angleDirection=right.angleDirection;
 }
@@ -27,6 +28,10 @@ const KM3Hit &KM3Hit::operator=(const KM3Hit &right) {
   time = right.time;
   originalInfo = right.originalInfo;
   IMany = right.IMany;
+  if (this != &right) {
+    delete Photon;
+    Photon = (right.Photon != NULL) ? new KM3HitPhoton(*right.Photon) : NULL;
+  }
   // short  angleIncident=right.angleIncident;
   // short  angleDirection=right.angleDirection;
   return *this;
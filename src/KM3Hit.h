@@ -8,6 +8,17 @@
 #include "G4VPhysicalVolume.hh"
 #include "G4Transform3D.hh"
 
+// what KM3Reweighter needs of a detected photon, kept only for the
+// extended hit records
+struct KM3HitPhoton {
+  G4float Wavelength;        // nm
+  G4float PathLength;        // m, from emission to detection
+  G4int Scatters;
+  G4float AbsorptionLength;  // m, of the water at the wavelength
+  G4float ScatteringLength;  // m
+  G4float QE;                // probability of the photon to be kept
+};
+
 class KM3Hit : public G4VHit {
  public:
   KM3Hit();
@@ -24,6 +35,8 @@ class KM3Hit : public G4VHit {
   void SetTime(G4double tt) { time = tt; };
   void SetoriginalInfo(G4int inf) { originalInfo = inf; };
   void SetMany(G4int im) { IMany = im; };
+  // the hit takes ownership
+  void SetPhoton(KM3HitPhoton *ph) { Photon = ph; };
   // short  void SetangleDirection(G4int an) {angleDirection = an;};
   // short  void SetangleIncident(G4int an) {angleIncident = an;};
 
@@ -31,6 +44,7 @@ class KM3Hit : public G4VHit {
   G4int GetCathodId() { return CathodId; };
   G4int GetoriginalInfo() { return originalInfo; };
   G4int GetMany() { return IMany; };
+  const KM3HitPhoton *GetPhoton() { return Photon; };
   // short  G4int    GetangleDirection() {return angleDirection;};
   // short  G4int    GetangleIncident() {return angleIncident;};
 
@@ -39,6 +53,8 @@ class KM3Hit : public G4VHit {
   G4double time;
   G4int originalInfo;
   G4int IMany;
+  // NULL unless the hits are extended
+  KM3HitPhoton *Photon;
   // short  G4int      angleIncident;
   // short  G4int      angleDirection;
 };
@@ -0,0 +1,406 @@
+#include "KM3HitsFile.h"
+#include "KM3EvtIO.h"
+#include "seaweed.h"
+#include "KM3CompressedStream.h"
+#include "G4ios.hh"
+
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <zlib.h>
+
+namespace {
+const char FileMagic[8] = {'K', 'M', '3', 'H', 'I', 'T', 'S', '1'};
+const char IndexMagic[8] = {'K', 'M', '3', 'H', 'I', 'D', 'X', '1'};
+const char ChunkTag[4] = {'C', 'H', 'N', 'K'};
+
+// on disk before the data of every column
+struct ColumnHeader {
+  char Name[16];
+  uint32_t ElementSize;
+  uint32_t Padding;
+  uint64_t NumberOfElements;
+  uint64_t CompressedSize;
+};
+
+// entries and hits of a chunk, it is written when either is reached
+const size_t EntriesPerChunk = 256;
+const size_t HitsPerChunk = 1 << 20;
+
+const char *MuonValueNames[8] = {"mu_x",  "mu_y",  "mu_z", "mu_dx",
+                                 "mu_dy", "mu_dz", "mu_p", "mu_t"};
+}
+
+KM3HitsWriter::KM3HitsWriter(const std::string &aFile) {
+  outfile.open(aFile.c_str(), std::ios::out | std::ios::binary);
+  if (!outfile.good())
+    G4Exception("Error opening the hits file", "", FatalException, "");
+  // the precision of the times of the evt file
+  TimeUnit = 0.01;
+  outfile.write(FileMagic, sizeof(FileMagic));
+  outfile.write((const char *)&TimeUnit, sizeof(TimeUnit));
+}
+
+KM3HitsWriter::~KM3HitsWriter() {
+  WriteChunk();
+  uint64_t IndexOffset = outfile.tellp();
+  uint64_t NumberOfEntries = Index.size();
+  outfile.write((const char *)&NumberOfEntries, sizeof(NumberOfEntries));
+  if (!Index.empty())
+    outfile.write((const char *)&Index[0],
+                  Index.size() * sizeof(KM3HitsIndexEntry));
+  outfile.write((const char *)&IndexOffset, sizeof(IndexOffset));
+  outfile.write(IndexMagic, sizeof(IndexMagic));
+  outfile.close();
+}
+
+void KM3HitsWriter::AddHit(G4int realisation, const KM3HitRecord &aHit) {
+  if ((G4int)PendingHits.size() <= realisation)
+    PendingHits.resize(realisation + 1);
+  PendingHits[realisation].push_back(aHit);
+}
+
+void KM3HitsWriter::SetTotalHits(G4int realisation, G4int total) {
+  if ((G4int)PendingTotals.size() <= realisation)
+    PendingTotals.resize(realisation + 1, -1);
+  PendingTotals[realisation] = total;
+}
+
+void KM3HitsWriter::AddMuonPoint(const KM3MuonPointRecord &aPoint) {
+  PendingMuons.push_back(aPoint);
+}
+
+void KM3HitsWriter::WriteEntry(G4int EventNumber, G4int realisation) {
+  KM3HitsIndexEntry anEntry;
+  anEntry.Event = EventNumber;
+  anEntry.Realisation = realisation;
+  anEntry.Row = EntryEvent.size();
+  anEntry.ChunkOffset = 0;  // set when the chunk is written
+  Index.push_back(anEntry);
+
+  static const std::vector<KM3HitRecord> NoHits;
+  const std::vector<KM3HitRecord> &hits =
+      ((G4int)PendingHits.size() > realisation) ? PendingHits[realisation]
+                                                : NoHits;
+  EntryEvent.push_back(EventNumber);
+  EntryRealisation.push_back(realisation);
+  EntryTotal.push_back(((G4int)PendingTotals.size() > realisation)
+                           ? PendingTotals[realisation]
+                           : -1);
+  EntryHits.push_back(hits.size());
+  EntryMuons.push_back(PendingMuons.size());
+
+  int32_t prevPMT = 0;
+  int64_t prevTime = 0;
+  for (size_t ih = 0; ih < hits.size(); ih++) {
+    int64_t ticks = llround(hits[ih].Time / TimeUnit);
+    HitPMT.push_back(hits[ih].PMT - prevPMT);
+    HitTime.push_back((hits[ih].PMT == prevPMT) ? ticks - prevTime : ticks);
+    prevPMT = hits[ih].PMT;
+    prevTime = ticks;
+    HitNPE.push_back(hits[ih].NPE);
+    HitParticle.push_back(hits[ih].Particle);
+    HitTrack.push_back(hits[ih].Track);
+    HitCreator.push_back(hits[ih].Creator);
+  }
+  for (size_t im = 0; im < PendingMuons.size(); im++) {
+    const KM3MuonPointRecord &aPoint = PendingMuons[im];
+    MuonTrack.push_back(aPoint.Track);
+    MuonPoint.push_back(aPoint.Point);
+    MuonLong.push_back(aPoint.WithMomentum ? 1 : 0);
+    for (G4int k = 0; k < 3; k++) {
+      MuonValues[k].push_back(aPoint.Position[k]);
+      MuonValues[3 + k].push_back(aPoint.Direction[k]);
+    }
+    MuonValues[6].push_back(aPoint.Momentum);
+    MuonValues[7].push_back(aPoint.Time);
+  }
+}
+
+void KM3HitsWriter::EndOfEvent() {
+  for (size_t ir = 0; ir < PendingHits.size(); ir++) PendingHits[ir].clear();
+  PendingTotals.clear();
+  PendingMuons.clear();
+  if ((EntryEvent.size() >= EntriesPerChunk) ||
+      (HitPMT.size() >= HitsPerChunk))
+    WriteChunk();
+}
+
+void KM3HitsWriter::WriteColumn(const char *name, const void *data,
+                                uint32_t ElementSize,
+                                uint64_t NumberOfElements) {
+  ColumnHeader aHeader;
+  memset(&aHeader, 0, sizeof(aHeader));
+  strncpy(aHeader.Name, name, sizeof(aHeader.Name) - 1);
+  aHeader.ElementSize = ElementSize;
+  aHeader.NumberOfElements = NumberOfElements;
+  uLong size = ElementSize * NumberOfElements;
+  uLongf CompressedSize = 0;
+  if (size > 0) {
+    CompressedSize = compressBound(size);
+    Compressed.resize(CompressedSize);
+    if (compress2((Bytef *)&Compressed[0], &CompressedSize,
+                  (const Bytef *)data, size, Z_DEFAULT_COMPRESSION) != Z_OK)
+      G4Exception("Error compressing the hits file", "", FatalException, "");
+  }
+  aHeader.CompressedSize = CompressedSize;
+  outfile.write((const char *)&aHeader, sizeof(aHeader));
+  if (CompressedSize > 0) outfile.write(&Compressed[0], CompressedSize);
+}
+
+void KM3HitsWriter::WriteChunk() {
+  if (EntryEvent.empty()) return;
+  uint64_t ChunkOffset = outfile.tellp();
+  for (size_t ie = Index.size() - EntryEvent.size(); ie < Index.size(); ie++)
+    Index[ie].ChunkOffset = ChunkOffset;
+
+  uint32_t NumberOfColumns = 5 + 6 + 3 + 8;
+  outfile.write(ChunkTag, sizeof(ChunkTag));
+  outfile.write((const char *)&NumberOfColumns, sizeof(NumberOfColumns));
+  size_t ne = EntryEvent.size();
+  size_t nh = HitPMT.size();
+  size_t nm = MuonTrack.size();
+  WriteColumn("event", ne ? &EntryEvent[0] : NULL, sizeof(int64_t), ne);
+  WriteColumn("realisation", ne ? &EntryRealisation[0] : NULL,
+              sizeof(int32_t), ne);
+  WriteColumn("total_hits", ne ? &EntryTotal[0] : NULL, sizeof(int32_t), ne);
+  WriteColumn("n_hits", ne ? &EntryHits[0] : NULL, sizeof(int32_t), ne);
+  WriteColumn("n_muons", ne ? &EntryMuons[0] : NULL, sizeof(int32_t), ne);
+  WriteColumn("pmt", nh ? &HitPMT[0] : NULL, sizeof(int32_t), nh);
+  WriteColumn("time", nh ? &HitTime[0] : NULL, sizeof(int64_t), nh);
+  WriteColumn("npe", nh ? &HitNPE[0] : NULL, sizeof(int32_t), nh);
+  WriteColumn("particle", nh ? &HitParticle[0] : NULL, sizeof(int32_t), nh);
+  WriteColumn("track", nh ? &HitTrack[0] : NULL, sizeof(int32_t), nh);
+  WriteColumn("creator", nh ? &HitCreator[0] : NULL, sizeof(int32_t), nh);
+  WriteColumn("mu_track", nm ? &MuonTrack[0] : NULL, sizeof(int32_t), nm);
+  WriteColumn("mu_point", nm ? &MuonPoint[0] : NULL, sizeof(int32_t), nm);
+  WriteColumn("mu_long", nm ? &MuonLong[0] : NULL, sizeof(int32_t), nm);
+  for (G4int k = 0; k < 8; k++)
+    WriteColumn(MuonValueNames[k], nm ? &MuonValues[k][0] : NULL,
+                sizeof(G4double), nm);
+  if (!outfile.good())
+    G4Exception("Error writing the hits file", "", FatalException, "");
+
+  EntryEvent.clear();
+  EntryRealisation.clear();
+  EntryTotal.clear();
+  EntryHits.clear();
+  EntryMuons.clear();
+  HitPMT.clear();
+  HitTime.clear();
+  HitNPE.clear();
+  HitParticle.clear();
+  HitTrack.clear();
+  HitCreator.clear();
+  MuonTrack.clear();
+  MuonPoint.clear();
+  MuonLong.clear();
+  for (G4int k = 0; k < 8; k++) MuonValues[k].clear();
+}
+
+KM3HitsReader::KM3HitsReader(const std::string &aFile) {
+  infile.open(aFile.c_str(), std::ios::in | std::ios::binary);
+  char magic[8];
+  infile.read(magic, sizeof(magic));
+  infile.read((char *)&TimeUnit, sizeof(TimeUnit));
+  if (!infile.good() || memcmp(magic, FileMagic, sizeof(magic)))
+    G4Exception("Not a hits file", "", FatalException, "");
+
+  uint64_t IndexOffset;
+  infile.seekg(-(std::streamoff)(sizeof(IndexOffset) + sizeof(magic)),
+               std::ios::end);
+  infile.read((char *)&IndexOffset, sizeof(IndexOffset));
+  infile.read(magic, sizeof(magic));
+  if (!infile.good() || memcmp(magic, IndexMagic, sizeof(magic)))
+    G4Exception("The hits file has no index, it was not closed", "",
+                FatalException, "");
+  infile.seekg(IndexOffset);
+  uint64_t NumberOfEntries;
+  infile.read((char *)&NumberOfEntries, sizeof(NumberOfEntries));
+  std::vector<KM3HitsIndexEntry> entries(NumberOfEntries);
+  if (NumberOfEntries > 0)
+    infile.read((char *)&entries[0],
+                NumberOfEntries * sizeof(KM3HitsIndexEntry));
+  if (!infile.good())
+    G4Exception("Error reading the index of the hits file", "",
+                FatalException, "");
+  for (size_t ie = 0; ie < entries.size(); ie++)
+    Index[std::make_pair(entries[ie].Event, (G4int)entries[ie].Realisation)] =
+        entries[ie];
+  HasChunk = false;
+  LoadedChunk = 0;
+}
+
+template <class T>
+void KM3HitsReader::GetColumn(const char *name, std::vector<T> &values) {
+  std::map<std::string, std::vector<char> >::const_iterator it =
+      Columns.find(name);
+  if (it == Columns.end())
+    G4Exception("Missing column in the hits file", "", FatalException, "");
+  values.resize(it->second.size() / sizeof(T));
+  if (!values.empty())
+    memcpy(&values[0], &it->second[0], values.size() * sizeof(T));
+}
+
+void KM3HitsReader::LoadChunk(uint64_t offset) {
+  if (HasChunk && (LoadedChunk == offset)) return;
+  infile.seekg(offset);
+  char tag[4];
+  uint32_t NumberOfColumns;
+  infile.read(tag, sizeof(tag));
+  infile.read((char *)&NumberOfColumns, sizeof(NumberOfColumns));
+  if (!infile.good() || memcmp(tag, ChunkTag, sizeof(tag)))
+    G4Exception("Error reading a chunk of the hits file", "", FatalException,
+                "");
+  Columns.clear();
+  std::vector<char> buffer;
+  for (uint32_t ic = 0; ic < NumberOfColumns; ic++) {
+    ColumnHeader aHeader;
+    infile.read((char *)&aHeader, sizeof(aHeader));
+    buffer.resize(aHeader.CompressedSize);
+    if (aHeader.CompressedSize > 0)
+      infile.read(&buffer[0], aHeader.CompressedSize);
+    if (!infile.good())
+      G4Exception("Error reading a column of the hits file", "",
+                  FatalException, "");
+    aHeader.Name[sizeof(aHeader.Name) - 1] = '\0';
+    std::vector<char> &data = Columns[aHeader.Name];
+    uLongf size = aHeader.ElementSize * aHeader.NumberOfElements;
+    data.resize(size);
+    if ((size > 0) &&
+        ((uncompress((Bytef *)&data[0], &size, (const Bytef *)&buffer[0],
+                     aHeader.CompressedSize) != Z_OK) ||
+         (size != data.size())))
+      G4Exception("Error uncompressing the hits file", "", FatalException,
+                  "");
+  }
+
+  GetColumn("event", EntryEvent);
+  GetColumn("total_hits", EntryTotal);
+  GetColumn("n_hits", EntryHits);
+  GetColumn("n_muons", EntryMuons);
+  GetColumn("pmt", HitPMT);
+  GetColumn("time", HitTime);
+  GetColumn("npe", HitNPE);
+  GetColumn("particle", HitParticle);
+  GetColumn("track", HitTrack);
+  GetColumn("creator", HitCreator);
+  GetColumn("mu_track", MuonTrack);
+  GetColumn("mu_point", MuonPoint);
+  GetColumn("mu_long", MuonLong);
+  for (G4int k = 0; k < 8; k++) GetColumn(MuonValueNames[k], MuonValues[k]);
+  Columns.clear();
+
+  EntryFirstHit.resize(EntryEvent.size());
+  EntryFirstMuon.resize(EntryEvent.size());
+  uint64_t FirstHit = 0;
+  uint64_t FirstMuon = 0;
+  for (size_t ie = 0; ie < EntryEvent.size(); ie++) {
+    EntryFirstHit[ie] = FirstHit;
+    EntryFirstMuon[ie] = FirstMuon;
+    FirstHit += EntryHits[ie];
+    FirstMuon += EntryMuons[ie];
+  }
+  if ((FirstHit != HitPMT.size()) || (FirstMuon != MuonTrack.size()))
+    G4Exception("Inconsistent chunk in the hits file", "", FatalException,
+                "");
+  HasChunk = true;
+  LoadedChunk = offset;
+}
+
+G4bool KM3HitsReader::ReadEntry(G4int EventNumber, G4int realisation,
+                                G4int &TotalHits,
+                                std::vector<KM3HitRecord> &hits,
+                                std::vector<KM3MuonPointRecord> &muons) {
+  std::map<std::pair<int64_t, G4int>, KM3HitsIndexEntry>::const_iterator it =
+      Index.find(std::make_pair((int64_t)EventNumber, realisation));
+  if (it == Index.end()) return false;
+  LoadChunk(it->second.ChunkOffset);
+  size_t row = it->second.Row;
+  TotalHits = EntryTotal[row];
+
+  hits.resize(EntryHits[row]);
+  int32_t prevPMT = 0;
+  int64_t prevTime = 0;
+  for (size_t ih = 0; ih < hits.size(); ih++) {
+    size_t j = EntryFirstHit[row] + ih;
+    int32_t pmt = prevPMT + HitPMT[j];
+    int64_t ticks = (pmt == prevPMT) ? prevTime + HitTime[j] : HitTime[j];
+    hits[ih].PMT = pmt;
+    hits[ih].Time = ticks * TimeUnit;
+    hits[ih].NPE = HitNPE[j];
+    hits[ih].Particle = HitParticle[j];
+    hits[ih].Track = HitTrack[j];
+    hits[ih].Creator = HitCreator[j];
+    prevPMT = pmt;
+    prevTime = ticks;
+  }
+
+  muons.resize(EntryMuons[row]);
+  for (size_t im = 0; im < muons.size(); im++) {
+    size_t j = EntryFirstMuon[row] + im;
+    muons[im].Track = MuonTrack[j];
+    muons[im].Point = MuonPoint[j];
+    muons[im].WithMomentum = (MuonLong[j] != 0);
+    for (G4int k = 0; k < 3; k++) {
+      muons[im].Position[k] = MuonValues[k][j];
+      muons[im].Direction[k] = MuonValues[3 + k][j];
+    }
+    muons[im].Momentum = MuonValues[6][j];
+    muons[im].Time = MuonValues[7][j];
+  }
+  return true;
+}
+
+void KM3HitsReader::Convert(const std::string &EvtIn,
+                            const std::string &HitsIn,
+                            const std::string &EvtOut) {
+  KM3InputStream evtfile(EvtIn);
+  KM3OutputStream outfile(EvtOut);
+  if (!evtfile.good() || !outfile.good())
+    G4Exception("Error opening the evt files to convert", "", FatalException,
+                "");
+  KM3HitsReader aReader(HitsIn);
+
+  seaweed::event evt;
+  std::vector<KM3HitRecord> hits;
+  std::vector<KM3MuonPointRecord> muons;
+  char buffer[256];
+  G4int NumberOfEvents = 0;
+  while (evt.read(evtfile) == 0) {
+    G4int realisation = 0;
+    if (evt.ndat("realisation") > 0)
+      realisation = atoi(evt.next("realisation").c_str());
+    G4int TotalHits;
+    if (evt.run_header() ||
+        !aReader.ReadEntry(evt.id(), realisation, TotalHits, hits, muons)) {
+      evt.write(outfile);
+      continue;
+    }
+    NumberOfEvents++;
+    evt.tagd("hit");
+    evt.tagd("total_hits");
+    evt.tagd("muonaddi_info");
+    if (TotalHits >= 0) {
+      sprintf(buffer, "%8d", TotalHits);
+      evt.taga("total_hits", buffer);
+    }
+    for (size_t ih = 0; ih < hits.size(); ih++)
+      evt.taga("hit", KM3EvtIO::HitWord(ih + 1, hits[ih].PMT, hits[ih].NPE,
+                                        hits[ih].Time, hits[ih].Particle,
+                                        hits[ih].Track, hits[ih].NPE,
+                                        hits[ih].Time, hits[ih].Creator));
+    for (size_t im = 0; im < muons.size(); im++) {
+      const KM3MuonPointRecord &aPoint = muons[im];
+      evt.taga("muonaddi_info",
+               KM3EvtIO::MuonPositionWord(
+                   aPoint.Track, aPoint.Point, aPoint.WithMomentum,
+                   aPoint.Position[0], aPoint.Position[1], aPoint.Position[2],
+                   aPoint.Direction[0], aPoint.Direction[1],
+                   aPoint.Direction[2], aPoint.Momentum, aPoint.Time));
+    }
+    evt.write(outfile);
+  }
+  G4cout << "Hits of " << NumberOfEvents << " events put back into "
+         << EvtOut << G4endl;
+}
@@ -0,0 +1,139 @@
+#ifndef KM3HitsFile_h
+#define KM3HitsFile_h 1
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <utility>
+#include <stdint.h>
+#include "globals.hh"
+
+// A columnar file of the hits and the muon truth of a run, written in
+// place of the hit and muonaddi_info words of the evt file, which keeps
+// the rest of every event. KM3HitsReader::Convert puts them back into the
+// evt file for the tools that read it.
+//
+// The file starts with "KM3HITS1" and the time unit (ns, double), then
+// the chunks, each of a few hundred events: "CHNK", the number of
+// columns, and for every column its name (16 chars), element size,
+// number of elements, compressed size and the zlib compressed data. The
+// columns are
+//   entries: event, realisation, total_hits, n_hits, n_muons
+//   hits:    pmt, time, npe, particle, track, creator
+//   muons:   mu_track, mu_point, mu_long, mu_x, mu_y, mu_z, mu_dx, mu_dy,
+//            mu_dz, mu_p, mu_t
+// with the hits of an entry sorted by pmt and time. The pmt is stored as
+// the difference to the previous hit and the time, in whole time units,
+// as the difference to the previous hit of the same pmt, which leaves
+// mostly small numbers to compress. Unknown columns are skipped when
+// reading. The file ends with the index of the entries (event,
+// realisation, row in the chunk, offset of the chunk), its offset and
+// "KM3HIDX1".
+
+// a hit word of the evt file
+struct KM3HitRecord {
+  G4int PMT;  // from 1, as in the evt file
+  G4double Time;
+  G4int NPE;
+  G4int Particle;  // HEP code of the primary
+  G4int Track;     // input track number of the primary
+  G4int Creator;
+};
+
+// a muonaddi_info word, WithMomentum for the long form
+struct KM3MuonPointRecord {
+  G4int Track;
+  G4int Point;
+  G4bool WithMomentum;
+  G4double Position[3];
+  G4double Direction[3];
+  G4double Momentum;
+  G4double Time;
+};
+
+struct KM3HitsIndexEntry {
+  int64_t Event;
+  int32_t Realisation;
+  uint32_t Row;
+  uint64_t ChunkOffset;
+};
+
+class KM3HitsWriter {
+ public:
+  KM3HitsWriter(const std::string &aFile);
+  // writes the last chunk and the index
+  ~KM3HitsWriter();
+
+  void AddHit(G4int realisation, const KM3HitRecord &aHit);
+  void SetTotalHits(G4int realisation, G4int total);
+  // the muon truth is the same for all the realisations
+  void AddMuonPoint(const KM3MuonPointRecord &aPoint);
+  // the entry of one realisation of the current event
+  void WriteEntry(G4int EventNumber, G4int realisation);
+  void EndOfEvent();
+
+ private:
+  void WriteChunk();
+  void WriteColumn(const char *name, const void *data, uint32_t ElementSize,
+                   uint64_t NumberOfElements);
+
+  std::ofstream outfile;
+  G4double TimeUnit;
+
+  // the current event
+  std::vector<std::vector<KM3HitRecord> > PendingHits;
+  std::vector<G4int> PendingTotals;
+  std::vector<KM3MuonPointRecord> PendingMuons;
+
+  // the columns of the current chunk
+  std::vector<int64_t> EntryEvent;
+  std::vector<int32_t> EntryRealisation, EntryTotal, EntryHits, EntryMuons;
+  std::vector<int32_t> HitPMT;
+  std::vector<int64_t> HitTime;
+  std::vector<int32_t> HitNPE, HitParticle, HitTrack, HitCreator;
+  std::vector<int32_t> MuonTrack, MuonPoint, MuonLong;
+  std::vector<G4double> MuonValues[8];
+
+  std::vector<KM3HitsIndexEntry> Index;
+  std::vector<char> Compressed;
+};
+
+class KM3HitsReader {
+ public:
+  KM3HitsReader(const std::string &aFile);
+  ~KM3HitsReader() {};
+
+  // the hits and muon points of an event and realisation, false if the
+  // file has no such entry. TotalHits is -1 if none was written
+  G4bool ReadEntry(G4int EventNumber, G4int realisation, G4int &TotalHits,
+                   std::vector<KM3HitRecord> &hits,
+                   std::vector<KM3MuonPointRecord> &muons);
+
+  // EvtIn with the hits and muon truth of HitsIn put back
+  static void Convert(const std::string &EvtIn, const std::string &HitsIn,
+                      const std::string &EvtOut);
+
+ private:
+  void LoadChunk(uint64_t offset);
+  template <class T>
+  void GetColumn(const char *name, std::vector<T> &values);
+
+  std::ifstream infile;
+  G4double TimeUnit;
+  std::map<std::pair<int64_t, G4int>, KM3HitsIndexEntry> Index;
+
+  G4bool HasChunk;
+  uint64_t LoadedChunk;
+  std::map<std::string, std::vector<char> > Columns;
+  std::vector<int64_t> EntryEvent;
+  std::vector<int32_t> EntryTotal, EntryHits, EntryMuons;
+  std::vector<uint64_t> EntryFirstHit, EntryFirstMuon;
+  std::vector<int32_t> HitPMT;
+  std::vector<int64_t> HitTime;
+  std::vector<int32_t> HitNPE, HitParticle, HitTrack, HitCreator;
+  std::vector<int32_t> MuonTrack, MuonPoint, MuonLong;
+  std::vector<G4double> MuonValues[8];
+};
+
+#endif
@@ -0,0 +1,183 @@
+#include "KM3MappedFile.h"
+#include "G4AutoLock.hh"
+#include "G4ios.hh"
+
+#include <map>
+#include <vector>
+#include <fstream>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+const size_t KM3MappedFile::EnergyBlockSize;
+const size_t KM3MappedFile::FineBlockSize;
+const G4int KM3MappedFile::MuonEnergyBlocks;
+const uint32_t KM3MappedFile::Version;
+
+namespace {
+G4Mutex registryMutex = G4MUTEX_INITIALIZER;
+// the mappings live until the end of the program
+std::map<std::string, KM3MappedFile *> theRegistry;
+const size_t PageSize = 4096;
+}
+
+const KM3MappedFile *KM3MappedFile::Open(const std::string &aFile) {
+  G4AutoLock lock(&registryMutex);
+  std::map<std::string, KM3MappedFile *>::iterator it =
+      theRegistry.find(aFile);
+  if (it != theRegistry.end()) return it->second;
+  KM3MappedFile *aMappedFile = new KM3MappedFile(aFile);
+  theRegistry[aFile] = aMappedFile;
+  return aMappedFile;
+}
+
+KM3MappedFile::KM3MappedFile(const std::string &aFile) {
+  FileName = aFile;
+  Header = NULL;
+  int fd = open(aFile.c_str(), O_RDONLY);
+  if (fd < 0)
+    G4Exception("Error opening parametrization table file", "",
+                FatalException, "");
+  struct stat st;
+  fstat(fd, &st);
+  MappingSize = st.st_size;
+  Mapping = mmap(NULL, MappingSize, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (Mapping == MAP_FAILED)
+    G4Exception("Error mapping parametrization table file", "",
+                FatalException, "");
+
+  Data = (const char *)Mapping;
+  DataSize = MappingSize;
+  if ((MappingSize >= sizeof(KM3TableHeader)) &&
+      (strncmp(Data, "KM3TABLE", 8) == 0)) {
+    Header = (const KM3TableHeader *)Mapping;
+    if (Header->Version != Version)
+      G4Exception("Unknown version of parametrization table file", "",
+                  FatalException, "");
+    if ((Header->NBlocks > 64) ||
+        (Header->DataOffset + Header->DataSize > MappingSize))
+      G4Exception("Corrupted parametrization table file header", "",
+                  FatalException, "");
+    Data += Header->DataOffset;
+    DataSize = Header->DataSize;
+  }
+}
+
+KM3MappedFile::~KM3MappedFile() { munmap(Mapping, MappingSize); }
+
+G4int KM3MappedFile::GetNumberOfBlocks() const {
+  if (Header == NULL) return 0;
+  return Header->NBlocks;
+}
+
+G4int KM3MappedFile::GetBlockType(G4int ib) const {
+  return Header->BlockType[ib];
+}
+
+size_t KM3MappedFile::GetBlockOffset(G4int ib) const {
+  return Header->BlockOffset[ib];
+}
+
+G4int KM3MappedFile::FindBlock(G4int type, G4int from) const {
+  for (G4int ib = from; ib < GetNumberOfBlocks(); ib++)
+    if (GetBlockType(ib) == type) return ib;
+  return -1;
+}
+
+G4int KM3MappedFile::GetNumberOfEnergyBlocks() const {
+  G4int n = 0;
+  if (Header != NULL) {
+    while ((n < GetNumberOfBlocks()) && (GetBlockType(n) == kEnergyBlock))
+      n++;
+    return n;
+  }
+  if (DataSize == (MuonEnergyBlocks + 1) * EnergyBlockSize + FineBlockSize)
+    return MuonEnergyBlocks;
+  if (DataSize % EnergyBlockSize != 0)
+    G4Exception("Unknown layout of raw parametrization table file, convert "
+                "it with km3sim convert-table",
+                "", FatalException, "");
+  return DataSize / EnergyBlockSize;
+}
+
+void KM3MappedFile::Convert(const std::string &layout,
+                            const std::string &TableIn,
+                            const std::string &TableOut) {
+  std::ifstream infile(TableIn.c_str(), std::ios::in | std::ios::binary);
+  if (!infile.good())
+    G4Exception("Error opening input parametrization table", "",
+                FatalException, "");
+  infile.seekg(0, std::ios::end);
+  size_t size = infile.tellg();
+  infile.seekg(0, std::ios::beg);
+
+  std::vector<uint32_t> types;
+  if ((layout == "em") || (layout == "ha")) {
+    for (size_t i = 0; i < size / EnergyBlockSize; i++)
+      types.push_back(kEnergyBlock);
+  } else if (layout == "muon") {
+    for (G4int i = 0; i < MuonEnergyBlocks; i++) types.push_back(kEnergyBlock);
+    types.push_back(kFineBlock);
+    types.push_back(kEnergyBlock);
+  } else
+    G4Exception("Unknown parametrization table layout", "", FatalException,
+                "");
+  size_t offset = 0;
+  for (size_t ib = 0; ib < types.size(); ib++)
+    offset += (types[ib] == kFineBlock) ? FineBlockSize : EnergyBlockSize;
+  if (offset != size)
+    G4Exception("Parametrization table size does not match the layout", "",
+                FatalException, "");
+
+  std::ofstream outfile(TableOut.c_str(), std::ios::out | std::ios::binary);
+  WriteHeader(outfile, types);
+  std::vector<char> buffer(1 << 20, 0);
+  while (infile.good()) {
+    infile.read(&buffer[0], buffer.size());
+    outfile.write(&buffer[0], infile.gcount());
+  }
+  outfile.close();
+  if (!outfile.good())
+    G4Exception("Error writing parametrization table", "", FatalException,
+                "");
+  G4cout << "Converted " << TableIn << " (" << types.size() << " blocks) to "
+         << TableOut << G4endl;
+}
+
+void KM3MappedFile::WriteHeader(std::ofstream &outfile,
+                                const std::vector<uint32_t> &types) {
+  std::vector<uint64_t> sizes;
+  for (size_t ib = 0; ib < types.size(); ib++)
+    sizes.push_back((types[ib] == kFineBlock) ? FineBlockSize
+                                              : EnergyBlockSize);
+  WriteHeader(outfile, types, sizes);
+}
+
+void KM3MappedFile::WriteHeader(std::ofstream &outfile,
+                                const std::vector<uint32_t> &types,
+                                const std::vector<uint64_t> &sizes) {
+  if (types.size() > 64)
+    G4Exception("Too many blocks in parametrization table", "",
+                FatalException, "");
+
+  KM3TableHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.Magic, "KM3TABLE", 8);
+  header.Version = Version;
+  header.NBlocks = types.size();
+  header.DataOffset = PageSize;
+  size_t offset = 0;
+  for (size_t ib = 0; ib < types.size(); ib++) {
+    header.BlockOffset[ib] = offset;
+    header.BlockType[ib] = types[ib];
+    offset += sizes[ib];
+  }
+  header.DataSize = offset;
+
+  outfile.write((const char *)&header, sizeof(header));
+  std::vector<char> padding(PageSize - sizeof(header), 0);
+  outfile.write(&padding[0], padding.size());
+}
@@ -0,0 +1,111 @@
+#ifndef KM3MappedFile_h
+#define KM3MappedFile_h 1
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdint.h>
+#include "globals.hh"
+
+// Read-only memory mapping of a parametrization table file. A file is
+// mapped once per process (Open keeps a registry), so all the flux
+// objects and threads that use it share one copy, and the pages of the
+// same file are shared by all processes on a node through the page cache.
+//
+// Two formats are understood: the raw float stream written by the
+// parametrization jobs, and the converted format, which is the same
+// stream after a versioned header holding the offset and type of every
+// top level block. The data of a converted file starts page aligned, so
+// offsets inside the data are the same in both formats.
+struct KM3TableHeader {
+  char Magic[8];  // "KM3TABLE"
+  uint32_t Version;
+  uint32_t NBlocks;
+  uint64_t DataOffset;  // from the start of the file
+  uint64_t DataSize;
+  uint64_t BlockOffset[64];  // from the start of the data
+  uint32_t BlockType[64];
+};
+
+class KM3MappedFile {
+ public:
+  enum BlockType {
+    kEnergyBlock = 0,  // energy and 40 distances of 51 angles
+    kFineBlock = 1,    // energy and 40 distances of 71 angles
+    kShowerBlock = 2   // recorded showers, see KM3ShowerLibrary
+  };
+  static const size_t EnergyBlockSize = 67540484;
+  static const size_t FineBlockSize = 94026884;
+  // of the "muon" layout, before its fine block
+  static const G4int MuonEnergyBlocks = 8;
+  static const uint32_t Version = 1;
+
+  static const KM3MappedFile *Open(const std::string &aFile);
+  // writes TableOut with the header for the block layout: "em" or "ha"
+  // (energy blocks only) or "muon" (8 energy blocks, the fine block of
+  // the direct light and the energy block of the delta rays)
+  static void Convert(const std::string &layout, const std::string &TableIn,
+                      const std::string &TableOut);
+  // writes the header and the padding up to the data for the blocks of
+  // these types, which the caller writes next
+  static void WriteHeader(std::ofstream &outfile,
+                          const std::vector<uint32_t> &types);
+  // the same for blocks whose size is not fixed by their type
+  static void WriteHeader(std::ofstream &outfile,
+                          const std::vector<uint32_t> &types,
+                          const std::vector<uint64_t> &sizes);
+
+  G4bool HasHeader() const { return Header != NULL; };
+  G4int GetNumberOfBlocks() const;
+  G4int GetBlockType(G4int ib) const;
+  size_t GetBlockOffset(G4int ib) const;
+  // first block of this type at or after block from, -1 if none
+  G4int FindBlock(G4int type, G4int from = 0) const;
+  // the energy blocks at the start of the data. A raw file has no header
+  // saying where they end, so its size has to match one of the layouts
+  // of Convert
+  G4int GetNumberOfEnergyBlocks() const;
+
+  size_t GetDataSize() const { return DataSize; };
+  const G4float *GetData(size_t offset) const {
+    return (const G4float *)(Data + offset);
+  };
+  const G4float *GetDataEnd() const {
+    return (const G4float *)(Data + DataSize);
+  };
+
+ private:
+  KM3MappedFile(const std::string &aFile);
+  ~KM3MappedFile();
+
+  std::string FileName;
+  void *Mapping;
+  size_t MappingSize;
+  const KM3TableHeader *Header;
+  const char *Data;
+  size_t DataSize;
+};
+
+// sequential reading of the floats of a mapped table, in the order the
+// flux objects were written
+class KM3TableCursor {
+ public:
+  KM3TableCursor(const KM3MappedFile *aFile, size_t offset)
+      : Current(aFile->GetData(offset)), End(aFile->GetDataEnd()) {};
+
+  G4float Next() { return *Take(1); };
+  const G4float *Take(size_t n) {
+    if ((size_t)(End - Current) < n)
+      G4Exception("Parametrization table is truncated", "", FatalException,
+                  "");
+    const G4float *p = Current;
+    Current += n;
+    return p;
+  };
+
+ private:
+  const G4float *Current;
+  const G4float *End;
+};
+
+#endif
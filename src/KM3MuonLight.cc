@@ -0,0 +1,86 @@
+#include "KM3MuonLight.h"
+#include "KM3Detector.h"
+#include "KM3SD.h"
+#include "G4Step.hh"
+#include "G4Track.hh"
+#include "G4Material.hh"
+#include "G4MuonMinus.hh"
+#include "G4MuonPlus.hh"
+
+using CLHEP::cm;
+using CLHEP::eV;
+using CLHEP::meter;
+
+KM3MuonLight::KM3MuonLight(KM3Detector *aDetector, KM3SD *aSD)
+    : mySampler(aDetector, aSD) {
+  myStDetector = aDetector;
+  myFlux = NULL;
+  MaxSegment = 1.0 * meter;
+  YieldEnergyStep = 0.0;
+}
+
+KM3MuonLight::~KM3MuonLight() { delete myFlux; }
+
+void KM3MuonLight::LoadTables(const G4String &aFile) {
+  delete myFlux;
+  myFlux = new KM3EMDirectFlux((char *)aFile.c_str(),
+                               myStDetector->TotCathodArea);
+
+  // the photon energies of the refraction index, where KM3Cherenkov
+  // samples from
+  G4MaterialPropertyVector *Rindex = G4Material::GetMaterial("Water")
+                                         ->GetMaterialPropertiesTable()
+                                         ->GetProperty("RINDEX");
+  G4MaterialPropertyVector *QECathod = G4Material::GetMaterial("Cathod")
+                                           ->GetMaterialPropertiesTable()
+                                           ->GetProperty("Q_EFF");
+  G4double Pmin = Rindex->GetMinLowEdgeEnergy();
+  G4double Pmax = Rindex->GetMaxLowEdgeEnergy();
+  const G4int NumberOfEnergies = 200;
+  YieldEnergyStep = (Pmax - Pmin) / NumberOfEnergies;
+  YieldRindex.clear();
+  YieldQE.clear();
+  for (G4int i = 0; i < NumberOfEnergies; i++) {
+    G4double energy = Pmin + (i + 0.5) * YieldEnergyStep;
+    YieldRindex.push_back(Rindex->Value(energy));
+    YieldQE.push_back(QECathod->Value(energy));
+  }
+}
+
+G4bool KM3MuonLight::IsParametrized(const G4Track *aTrack) const {
+  if (aTrack->GetParentID() != 0) return false;
+  return (aTrack->GetDefinition() == G4MuonPlus::MuonPlusDefinition()) ||
+         (aTrack->GetDefinition() == G4MuonMinus::MuonMinusDefinition());
+}
+
+// Frank-Tamm, as in KM3Cherenkov::GetAverageNumberOfPhotons, weighted by
+// the quantum efficiency KM3Cherenkov applies to every photon
+G4double KM3MuonLight::PhotonYield(G4double beta) const {
+  const G4double Rfact = 369.81 / (eV * cm);
+  G4double BetaInverse2 = 1.0 / (beta * beta);
+  G4double sum = 0.0;
+  for (size_t i = 0; i < YieldRindex.size(); i++) {
+    G4double sin2 = 1.0 - BetaInverse2 / (YieldRindex[i] * YieldRindex[i]);
+    if (sin2 > 0.0) sum += sin2 * YieldQE[i];
+  }
+  return Rfact * sum * YieldEnergyStep * myStDetector->Quantum_Efficiency;
+}
+
+void KM3MuonLight::AddStep(const G4Step *aStep) {
+  const G4Track *aTrack = aStep->GetTrack();
+  if (!IsParametrized(aTrack)) return;
+  G4double StepLength = aStep->GetStepLength();
+  if (StepLength <= 0.0) return;
+
+  const G4StepPoint *prePoint = aStep->GetPreStepPoint();
+  const G4StepPoint *postPoint = aStep->GetPostStepPoint();
+  G4ThreeVector x1 = prePoint->GetPosition();
+  G4ThreeVector x2 = postPoint->GetPosition();
+  // the same culling as KM3Cherenkov
+  if (!myStDetector->BoundingVolume->SegmentInside(x1, x2)) return;
+  G4double beta = 0.5 * (prePoint->GetBeta() + postPoint->GetBeta());
+  G4double NumberOfPhotons = PhotonYield(beta) * StepLength;
+  if (NumberOfPhotons <= 0.0) return;
+
+  mySampler.EmitStep(myFlux, NumberOfPhotons, aStep, MaxSegment);
+}
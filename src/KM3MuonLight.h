@@ -0,0 +1,52 @@
+#ifndef KM3MuonLight_h
+#define KM3MuonLight_h 1
+
+#include <vector>
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+#include "KM3EMDirectFlux.h"
+#include "KM3OMSampler.h"
+#include <CLHEP/Units/SystemOfUnits.h>
+#include <CLHEP/Units/PhysicalConstants.h>
+
+class G4Step;
+class G4Track;
+class KM3Detector;
+class KM3SD;
+
+// Fast simulation of the Cherenkov light of the primary muons. KM3Cherenkov
+// creates no photons for them; instead every step is cut in pieces of at
+// most MaxSegment and, for every OM in range, the photoelectrons of each
+// piece are sampled through KM3OMSampler from the direct light block of
+// the muon tables (KM3EMDirectFlux), which gives the flux per Cherenkov
+// photon emitted by a short segment of a minimum ionising muon. The number of photons is
+// the one KM3Cherenkov would have created (with the quantum efficiency of
+// the cathods folded in). The secondaries of the muon (stochastic losses)
+// are tracked as usual, or parametrized by the shower models.
+class KM3MuonLight {
+ public:
+  KM3MuonLight(KM3Detector *, KM3SD *);
+  ~KM3MuonLight();
+
+  void LoadTables(const G4String &aFile);
+  // the tracks whose light is sampled
+  G4bool IsParametrized(const G4Track *aTrack) const;
+  void AddStep(const G4Step *aStep);
+
+  G4double MaxSegment;
+
+ private:
+  // Cherenkov photons per length that pass the quantum efficiency
+  G4double PhotonYield(G4double beta) const;
+
+  KM3Detector *myStDetector;
+  KM3EMDirectFlux *myFlux;
+  KM3OMSampler mySampler;
+  // refraction index of the water and quantum efficiency on a grid of
+  // photon energies
+  std::vector<G4double> YieldRindex;
+  std::vector<G4double> YieldQE;
+  G4double YieldEnergyStep;
+};
+
+#endif
@@ -0,0 +1,26 @@
+#include "KM3OMSampler.h"
+#include "KM3TrackingAction.h"
+#include "G4Track.hh"
+#include "G4RunManager.hh"
+
+KM3OMSampler::KM3OMSampler(KM3Detector *aDetector, KM3SD *aSD) {
+  myStDetector = aDetector;
+  aMySD = aSD;
+  myTracking = NULL;
+}
+
+G4int KM3OMSampler::GetProvenance(const G4Track *aTrack) {
+  if (myTracking == NULL)
+    myTracking = (const KM3TrackingAction *)G4RunManager::GetRunManager()
+                     ->GetUserTrackingAction();
+  return myTracking->GetProvenance(aTrack->GetTrackID());
+}
+
+void KM3OMSampler::GetFrame(const G4ThreeVector &p0,
+                            const G4ThreeVector &FromGeneToOM,
+                            G4ThreeVector &x, G4ThreeVector &y) {
+  x = p0 - p0.dot(FromGeneToOM) * FromGeneToOM;
+  if (x.mag2() < 1.0e-12) x = FromGeneToOM.orthogonal();
+  x = x.unit();
+  y = FromGeneToOM.cross(x);
+}
@@ -0,0 +1,104 @@
+#ifndef KM3OMSampler_h
+#define KM3OMSampler_h 1
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+#include "G4Step.hh"
+#include "KM3SD.h"
+#include "KM3EMTimePointDis.h"
+#include <CLHEP/Units/SystemOfUnits.h>
+
+class G4Track;
+
+// The photoelectrons the parametrizations sample on the OMs around a
+// point source (KM3EMShowerModel, KM3HAShowerModel, KM3DeltaRayLight and
+// KM3MuonLight). For every OM within MaxAbsDist the flux finds its bins
+// from the distance and the cosine of the angle between the source axis
+// and the direction to the OM, and the photons it samples become hits
+// through KM3SD::InsertExternalHit.
+//
+// The Flux has FindBins(amount, distance, angle) for the amount of light
+// of the source (an energy or a number of photons), GetNumberOfSamples
+// and GetSamplePoint.
+class KM3OMSampler {
+ public:
+  KM3OMSampler(KM3Detector *, KM3SD *);
+  ~KM3OMSampler() {};
+
+  // of the track emitting the light, see KM3Provenance
+  G4int GetProvenance(const G4Track *aTrack);
+
+  template <class Flux>
+  void Emit(Flux *aFlux, G4double amount, const G4ThreeVector &x0,
+            const G4ThreeVector &p0, G4double t0, G4int provenance);
+  // the step is cut in pieces of at most MaxSegment that share amount,
+  // so that each piece is a point source
+  template <class Flux>
+  void EmitStep(Flux *aFlux, G4double amount, const G4Step *aStep,
+                G4double MaxSegment);
+
+  // the frame of the sampled directions of an OM in the unit direction
+  // FromGeneToOM from a source with axis p0: relative to the source to OM
+  // line, with phi measured from the plane that holds the source axis.
+  // KM3TableBuilder histograms the photons in the same frame
+  static void GetFrame(const G4ThreeVector &p0,
+                       const G4ThreeVector &FromGeneToOM, G4ThreeVector &x,
+                       G4ThreeVector &y);
+
+ private:
+  KM3Detector *myStDetector;
+  KM3SD *aMySD;
+  const KM3TrackingAction *myTracking;
+};
+
+template <class Flux>
+void KM3OMSampler::Emit(Flux *aFlux, G4double amount, const G4ThreeVector &x0,
+                        const G4ThreeVector &p0, G4double t0,
+                        G4int provenance) {
+  G4double speed = aMySD->GetSpeedAtMaxQE();
+  KM3Cathods *cathods = myStDetector->allCathods;
+  for (G4int iom = 0; iom < cathods->GetNumberOfOMs(); iom++) {
+    const OpticalModule &anOM = cathods->GetOM(iom);
+    G4ThreeVector FromGeneToOM = anOM.Position - x0;
+    G4double distancein = FromGeneToOM.mag();
+    if (distancein > myStDetector->MaxAbsDist) continue;
+    FromGeneToOM /= distancein;
+    G4double anglein = p0.dot(FromGeneToOM);
+
+    aFlux->FindBins(amount, distancein, anglein);
+    G4int NumberOfSamples = aFlux->GetNumberOfSamples();
+    if (NumberOfSamples == 0) continue;
+
+    G4ThreeVector x, y;
+    GetFrame(p0, FromGeneToOM, x, y);
+    G4double tdirect = t0 + distancein / speed;
+    for (G4int isa = 0; isa < NumberOfSamples; isa++) {
+      onePE aPE = aFlux->GetSamplePoint();
+      G4double sinth = sqrt(1.0 - aPE.costh * aPE.costh);
+      G4ThreeVector photonDirection = sinth * cos(aPE.phi) * x +
+                                      sinth * sin(aPE.phi) * y +
+                                      aPE.costh * FromGeneToOM;
+      aMySD->InsertExternalHit(iom, tdirect + aPE.time * CLHEP::ns,
+                               provenance, photonDirection);
+    }
+  }
+}
+
+template <class Flux>
+void KM3OMSampler::EmitStep(Flux *aFlux, G4double amount, const G4Step *aStep,
+                            G4double MaxSegment) {
+  G4int provenance = GetProvenance(aStep->GetTrack());
+  G4ThreeVector x1 = aStep->GetPreStepPoint()->GetPosition();
+  G4ThreeVector x2 = aStep->GetPostStepPoint()->GetPosition();
+  G4double t1 = aStep->GetPreStepPoint()->GetGlobalTime();
+  G4double t2 = aStep->GetPostStepPoint()->GetGlobalTime();
+  G4int NumberOfSegments = G4int(ceil(aStep->GetStepLength() / MaxSegment));
+  G4ThreeVector p0 = (x2 - x1).unit();
+  for (G4int iseg = 0; iseg < NumberOfSegments; iseg++) {
+    G4double f = (iseg + 0.5) / NumberOfSegments;
+    Emit(aFlux, amount / NumberOfSegments, x1 + f * (x2 - x1), p0,
+         t1 + f * (t2 - t1), provenance);
+  }
+}
+
+#endif
@@ -0,0 +1,170 @@
+#include "KM3PMTResponse.h"
+#include "KM3Cathods.h"
+#include "G4Material.hh"
+#include "G4MaterialPropertiesTable.hh"
+#include "G4ios.hh"
+#include "Randomize.hh"
+
+#include <fstream>
+#include <sstream>
+#include <math.h>
+
+using CLHEP::ns;
+using CLHEP::pi;
+
+KM3PMTResponse::KM3PMTResponse() {
+  TTS = 0.0;
+  MinCos = -1.0;
+  MaxCos = 0.25;
+  InverseStep = 0.0;
+  myCathods = NULL;
+  HasEfficiencies = false;
+
+  // the quantiles by bisection of the cumulative distribution
+  GaussTable.resize(GaussBins);
+  for (G4int ib = 0; ib < GaussBins; ib++) {
+    G4double p = (ib + 0.5) / GaussBins;
+    G4double low = -10.0;
+    G4double high = 10.0;
+    for (G4int it = 0; it < 60; it++) {
+      G4double x = 0.5 * (low + high);
+      if (0.5 * erfc(-x / sqrt(2.0)) < p)
+        low = x;
+      else
+        high = x;
+    }
+    GaussTable[ib] = 0.5 * (low + high);
+  }
+}
+
+void KM3PMTResponse::Initialize(KM3Cathods *aCathods) {
+  myCathods = aCathods;
+  G4MaterialPropertyVector *Ang_Acc =
+      G4Material::GetMaterial("Cathod")->GetMaterialPropertiesTable()
+          ->GetProperty("ANGULAR_ACCEPTANCE");
+  MinCos = Ang_Acc->GetMinLowEdgeEnergy();
+  MaxCos = Ang_Acc->GetMaxLowEdgeEnergy();
+  G4double step = (MaxCos - MinCos) / AcceptanceBins;
+  InverseStep = (step > 0.0) ? 1.0 / step : 0.0;
+  SphericalAcceptance.resize(AcceptanceBins + 1);
+  for (G4int i = 0; i <= AcceptanceBins; i++)
+    SphericalAcceptance[i] = Ang_Acc->Value(MinCos + i * step);
+
+  Types.clear();
+  TypeAcceptance.clear();
+  G4int NumberOfCathods = aCathods->GetNumberOfCathods();
+  CathodType.resize(NumberOfCathods);
+  for (G4int id = 0; id < NumberOfCathods; id++) {
+    G4double Radius = aCathods->GetCathodRadius(id);
+    G4double Height = aCathods->GetCathodHeight(id);
+    std::pair<G4double, G4double> key(Radius, Height);
+    std::map<std::pair<G4double, G4double>, G4int>::iterator it =
+        Types.find(key);
+    if (it == Types.end()) {
+      std::vector<G4double> aTable(AcceptanceBins + 1);
+      for (G4int i = 0; i <= AcceptanceBins; i++) {
+        G4double x = MinCos + i * step;
+        G4double AngularAccSim =
+            fabs(x) + (2.0 * Height / (pi * Radius)) * sqrt(1 - x * x);
+        aTable[i] = SphericalAcceptance[i] / AngularAccSim;
+      }
+      it = Types.insert(std::make_pair(key, (G4int)TypeAcceptance.size()))
+               .first;
+      TypeAcceptance.push_back(aTable);
+    }
+    CathodType[id] = it->second;
+  }
+  Efficiency.assign(NumberOfCathods, 1.0);
+  HasEfficiencies = false;
+  G4cout << "PMT response: " << TypeAcceptance.size() << " PMT types, TTS "
+         << TTS / ns << " ns" << G4endl;
+}
+
+void KM3PMTResponse::ReadEfficiencies(const std::string &aFile) {
+  std::ifstream infile(aFile.c_str());
+  if (!infile.good())
+    G4Exception("Error opening the PMT efficiency file", "", FatalException,
+                "");
+  std::map<G4int, G4int> CathodOfPMT;
+  for (G4int id = 0; id < myCathods->GetNumberOfCathods(); id++)
+    CathodOfPMT[myCathods->GetPMTId(id)] = id;
+
+  G4int NumberRead = 0;
+  G4int NumberUnknown = 0;
+  std::string line;
+  while (std::getline(infile, line)) {
+    std::istringstream iss(line);
+    std::string first;
+    if (!(iss >> first) || (first[0] == '#')) continue;
+    std::istringstream fields(line);
+    G4int pmt;
+    G4double anEfficiency;
+    if (!(fields >> pmt >> anEfficiency) || (anEfficiency < 0.0))
+      G4Exception("Error reading the PMT efficiency file", "", FatalException,
+                  "");
+    std::map<G4int, G4int>::const_iterator it = CathodOfPMT.find(pmt);
+    if (it == CathodOfPMT.end()) {
+      NumberUnknown++;
+      continue;
+    }
+    Efficiency[it->second] = anEfficiency;
+    NumberRead++;
+  }
+  HasEfficiencies = true;
+  G4cout << "PMT efficiencies from " << aFile << ": " << NumberRead
+         << " PMTs";
+  if (NumberUnknown > 0)
+    G4cout << ", " << NumberUnknown << " not in the detector";
+  G4cout << G4endl;
+}
+
+// every loop over the flat arrays is free of branches, so that it is
+// vectorized
+void KM3PMTResponse::Apply(KM3HitsCollection *aCollection) {
+  std::vector<KM3Hit *> &hits = *aCollection->GetVector();
+  size_t n = hits.size();
+  if (n == 0) return;
+  CLHEP::HepRandomEngine *engine = CLHEP::HepRandom::getTheEngine();
+
+  // a hit is kept floor(e + u) times, i.e. floor(e) times and once more
+  // with the probability of the fraction of e
+  if (HasEfficiencies) {
+    HitEfficiency.resize(n);
+    Randoms.resize(n);
+    Counts.resize(n);
+    for (size_t i = 0; i < n; i++)
+      HitEfficiency[i] = Efficiency[hits[i]->GetCathodId()];
+    engine->flatArray(n, &Randoms[0]);
+    for (size_t i = 0; i < n; i++)
+      Counts[i] = G4int(HitEfficiency[i] + Randoms[i]);
+
+    std::vector<KM3Hit *> kept;
+    kept.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+      if (Counts[i] == 0) {
+        delete hits[i];
+        continue;
+      }
+      kept.push_back(hits[i]);
+      for (G4int ic = 1; ic < Counts[i]; ic++)
+        kept.push_back(new KM3Hit(*hits[i]));
+    }
+    hits.swap(kept);
+    n = hits.size();
+    if (n == 0) return;
+  }
+
+  if (TTS > 0.0) {
+    Times.resize(n);
+    Randoms.resize(n);
+    for (size_t i = 0; i < n; i++) Times[i] = hits[i]->GetTime();
+    engine->flatArray(n, &Randoms[0]);
+    const G4double *table = &GaussTable[0];
+    for (size_t i = 0; i < n; i++) {
+      G4int ib = G4int(Randoms[i] * GaussBins);
+      ib = (ib < GaussBins) ? ib : GaussBins - 1;
+      Times[i] += TTS * table[ib];
+    }
+    for (size_t i = 0; i < n; i++) hits[i]->SetTime(Times[i]);
+  }
+}
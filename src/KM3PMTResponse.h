@@ -0,0 +1,112 @@
+#ifndef KM3PMTResponse_h
+#define KM3PMTResponse_h 1
+
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include "globals.hh"
+#include "Randomize.hh"
+#include "KM3Hit.h"
+
+class KM3Cathods;
+class G4MaterialPropertyVector;
+
+// The response of the PMTs to the photons that reach a cathod, from
+// tables that are filled once for every PMT type (cathod radius and
+// height) instead of the material property vectors of every photon.
+//
+// The angular acceptance is decided per photon, since a rejected photon
+// goes on and may reach another cathod. The table of a cylindrical
+// cathod has the acceptance of the cathod shape divided out,
+//   a(x) = |x| + (2 d / (pi R)) sqrt(1 - x^2)
+// for a cylinder of radius R and height d, so that the detected photons
+// follow the ANGULAR_ACCEPTANCE of the Cathod material (the MultiPMT OM,
+// WPD Document January 2011). The photons of
+// the parametrizations arrive on the sphere of the OM and only get the
+// ANGULAR_ACCEPTANCE.
+//
+// The efficiency of every PMT and the transit time spread are applied
+// to the hits of an event at once, in flat arrays, before they are
+// sorted and merged. The quantum efficiency stays in KM3Cherenkov, where
+// the photons are created.
+class KM3PMTResponse {
+ public:
+  KM3PMTResponse();
+  ~KM3PMTResponse() {};
+
+  // builds the tables for these cathods
+  void Initialize(KM3Cathods *aCathods);
+  // reads the efficiencies of the PMTs from a file of "pmt_id efficiency"
+  // lines, with the pmt ids of the detector file. The PMTs not in the file
+  // keep 1, and an efficiency above 1 duplicates hits
+  void ReadEfficiencies(const std::string &aFile);
+
+  // true if a photon reaching cathod id with this cosine to its direction
+  // is detected
+  inline G4bool Accept(G4int id, G4double cosangle) const;
+  // the same for a photon on the sphere of the OM
+  inline G4bool AcceptSpherical(G4double cosangle) const;
+
+  // applies the efficiencies and the transit time spread to the hits
+  void Apply(KM3HitsCollection *aCollection);
+
+  // gaussian sigma of the transit time, 0 for none
+  G4double TTS;
+
+ private:
+  inline G4bool AcceptTable(const std::vector<G4double> &aTable,
+                            G4double cosangle) const;
+
+  // acceptance at AcceptanceBins+1 equidistant cosines from MinCos to
+  // MaxCos, linearly interpolated. Photons above MaxCos are rejected and
+  // below MinCos accepted, as in the material property vector
+  static const G4int AcceptanceBins = 1024;
+  G4double MinCos;
+  G4double MaxCos;
+  G4double InverseStep;
+  std::vector<std::vector<G4double> > TypeAcceptance;
+  std::vector<G4double> SphericalAcceptance;
+
+  // (radius, height) to index in TypeAcceptance, and the type of every
+  // cathod
+  std::map<std::pair<G4double, G4double>, G4int> Types;
+  std::vector<G4int> CathodType;
+
+  KM3Cathods *myCathods;
+  std::vector<G4double> Efficiency;
+  G4bool HasEfficiencies;
+
+  // quantiles of the unit gaussian at the centres of GaussBins equal bins
+  // of probability
+  static const G4int GaussBins = 4096;
+  std::vector<G4double> GaussTable;
+
+  // the hits in flat arrays
+  std::vector<G4double> Times;
+  std::vector<G4double> HitEfficiency;
+  std::vector<G4double> Randoms;
+  std::vector<G4int> Counts;
+};
+
+inline G4bool KM3PMTResponse::AcceptTable(const std::vector<G4double> &aTable,
+                                          G4double cosangle) const {
+  if (cosangle > MaxCos) return false;
+  if (cosangle < MinCos) return true;
+  G4double u = (cosangle - MinCos) * InverseStep;
+  G4int i = G4int(u);
+  if (i >= AcceptanceBins) i = AcceptanceBins - 1;
+  G4double f = u - i;
+  G4double acceptance = aTable[i] + f * (aTable[i + 1] - aTable[i]);
+  return G4UniformRand() <= acceptance;
+}
+
+inline G4bool KM3PMTResponse::Accept(G4int id, G4double cosangle) const {
+  return AcceptTable(TypeAcceptance[CathodType[id]], cosangle);
+}
+
+inline G4bool KM3PMTResponse::AcceptSpherical(G4double cosangle) const {
+  return AcceptTable(SphericalAcceptance, cosangle);
+}
+
+#endif
@@ -22,6 +22,7 @@
 #include "G4GammaConversion.hh"
 //#include "G4GammaConversionToMuons.hh"
 #include "G4PhotoElectricEffect.hh"
+#include "G4FastSimulationManagerProcess.hh"
 
 // newgeant #include "G4MultipleScattering.h"
 // in version 4.9.3.p02 geant4 threatens than G4MultipleScattering class
@@ -180,7 +181,7 @@ void KM3Physics::ConstructParticle() {
 
 void KM3Physics::ConstructProcess() {
   AddTransportation();
-  //AddParameterisation();
+  AddParameterisation();
   ConstructEM();
   // construct hadronic processes only in case of Pythia input
   // (for apparent reasons)
@@ -604,6 +605,7 @@ void KM3Physics::ConstructOP() {
 
   theCerenkovProcess->SetVerboseLevel(0);
   theCerenkovProcess->SetDetector(aDetector);
+  aDetector->CherenkovProcess = theCerenkovProcess;
   theAbsorptionProcess->SetVerboseLevel(0);
 
   G4int MaxNumPhotons = -30000;
@@ -613,6 +615,7 @@ void KM3Physics::ConstructOP() {
 
   G4OpMie *theMieProcess = new G4OpMie();
   theMieProcess->SetVerboseLevel(0);
+  theMieProcess->SetCountScatters(aDetector->ExtendedHits);
 
   theParticleIterator->reset();
   while ((*theParticleIterator)()) {
@@ -633,6 +636,33 @@ void KM3Physics::ConstructOP() {
   // set ordering for AtRestDoIt
 }
 
+// the shower models live in the world region; the particles they apply
+// to get the process that hands them over
+void KM3Physics::AddParameterisation() {
+  G4bool useEM = !aDetector->EMParamFile.empty() ||
+                 !aDetector->ShowerLibraryFile.empty();
+  G4bool useHA = !aDetector->HAParamFile.empty();
+  // the geantinos standing for the events of an emitter file
+  G4bool useReplay = aDetector->EmitterReader != NULL;
+  if (!useEM && !useHA && !useReplay) return;
+  G4FastSimulationManagerProcess *theFastSimulationManagerProcess =
+      new G4FastSimulationManagerProcess();
+  theParticleIterator->reset();
+  while ((*theParticleIterator)()) {
+    G4ParticleDefinition *particle = theParticleIterator->value();
+    G4String particleName = particle->GetParticleName();
+    G4int pdg = abs(particle->GetPDGEncoding());
+    G4bool isEM = (particleName == "e-") || (particleName == "e+") ||
+                  (particleName == "gamma");
+    G4bool isHA = (pdg == 211) || (pdg == 321) || (pdg == 130) ||
+                  (pdg == 2212) || (pdg == 2112);
+    G4bool isReplay = particleName == "geantino";
+    if ((useEM && isEM) || (useHA && isHA) || (useReplay && isReplay))
+      particle->GetProcessManager()->AddDiscreteProcess(
+          theFastSimulationManagerProcess);
+  }
+}
+
 void KM3Physics::ConstructGeneral() {
   // Add Decay Process
   G4Decay *theDecayProcess = new G4Decay();
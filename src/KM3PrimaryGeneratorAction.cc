@@ -8,6 +8,9 @@
 #include "Randomize.hh"
 #include "G4ParticleDefinition.hh"
 #include "G4ParticleTypes.hh"
+#include "KM3EmitterFile.h"
+
+#include <stdint.h>
 
 using CLHEP::TeV;
 using CLHEP::GeV;
@@ -16,14 +19,23 @@ using CLHEP::ns;
 using CLHEP::cm;
 using CLHEP::m;
 
-KM3PrimaryGeneratorAction::KM3PrimaryGeneratorAction() {}
+KM3PrimaryGeneratorAction::KM3PrimaryGeneratorAction() {
+  antaresHEPEvt = NULL;
+  EmitterReader = NULL;
+  FirstEvent = 0;
+  FirstEventOffset = 0;
+  NumberOfEvents = 0;
+  EventSeeds = false;
+  RunSeed = 0;
+}
 
 KM3PrimaryGeneratorAction::~KM3PrimaryGeneratorAction() {
   delete antaresHEPEvt;
 }
 
 void KM3PrimaryGeneratorAction::Initialize() {
-  antaresHEPEvt = new HOURSevtRead(infile_evt);
+  antaresHEPEvt =
+      new HOURSevtRead(infile_evt, FirstEventOffset, NumberOfEvents);
   nevents = antaresHEPEvt->GetNumberOfEvents();
   useHEPEvt = antaresHEPEvt->IsNeutrinoEvent();
 }
@@ -50,8 +62,28 @@ void KM3PrimaryGeneratorAction::GeneratePrimaries(G4Event *anEvent) {
   G4double t0;
 
   ievent++;
+  if (EventSeeds) {
+    // a seed below the limit of HepJamesRandom, apart from the ones of
+    // KM3Background
+    uint64_t seed = (uint64_t)RunSeed * 2654435761u +
+                    (uint64_t)(FirstEvent + anEvent->GetEventID()) * 69069u +
+                    12345u;
+    CLHEP::HepRandom::setTheSeed((long)(seed % 900000000u));
+  }
   event_action->Initialize();
-  if (!useHEPEvt) {
+  if (EmitterReader != NULL) {
+    antaresHEPEvt->ReadEvent();
+    if (!EmitterReader->NextEvent() ||
+        (EmitterReader->GetEventNumber() != anEvent->GetEventID()))
+      G4Exception("Emitter file out of step with the input events", "",
+                  FatalException, "");
+    G4PrimaryParticle *initialParticle =
+        new G4PrimaryParticle(G4Geantino::GeantinoDefinition());
+    G4PrimaryVertex *vertex = new G4PrimaryVertex(G4ThreeVector(), 0.0);
+    vertex->SetPrimary(initialParticle);
+    anEvent->AddPrimaryVertex(vertex);
+    numberofParticles = 1;
+  } else if (!useHEPEvt) {
     // the target id is not relevant in case of injected particles.
     idtarget = 0;
     // neither is the neutrino id
@@ -124,4 +156,5 @@ void KM3PrimaryGeneratorAction::GeneratePrimaries(G4Event *anEvent) {
            << " GeV" << G4endl;
   }
   myTracking->numofInitialParticles = numberofParticles;
+  myTracking->ClearProvenance();
 }
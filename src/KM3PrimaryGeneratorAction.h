@@ -10,7 +10,6 @@
 #include "KM3TrackingAction.h"
 #include "G4ThreeVector.hh"
 #include "KM3EventAction.h"
-#include "HAVertexMuons.h"
 #include "HOURSevtRead.h"
 #include "KM3EvtIO.h"
 #include <CLHEP/Units/SystemOfUnits.h>
@@ -19,6 +18,7 @@
 
 class G4Event;
 class G4VPrimaryGenerator;
+class KM3EmitterReader;
 
 
 class KM3PrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction {
@@ -30,6 +30,14 @@ class KM3PrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction {
   int nevents;
   FILE *outfile_evt;
   std::string infile_evt;
+  // the events of the run in infile_evt, from its index (see KM3EvtIndex)
+  G4int FirstEvent;
+  std::streamoff FirstEventOffset;
+  G4int NumberOfEvents;
+  // seed every event from RunSeed and its number in infile_evt, so that
+  // its result does not depend on how a run is split
+  G4bool EventSeeds;
+  G4long RunSeed;
   G4int numberofParticles;
   void GeneratePrimaries(G4Event *anEvent);
   void Initialize(void);
@@ -41,6 +49,9 @@ class KM3PrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction {
   G4double random_R;
   G4ThreeVector position;
   G4ThreeVector direction;
+  // second stage of a split run: the events of the input file are only
+  // followed, a geantino stands for the segments of the emitter file
+  KM3EmitterReader *EmitterReader;
 
  private:
   G4VPrimaryGenerator *HEPEvt;
@@ -52,8 +63,6 @@ class KM3PrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction {
   G4double detectorMaxz;
   G4double bottomPosition;
 
-  HAVertexMuons *aHAVertexMuons;
-
  public:
   void PutFromDetector(G4ThreeVector dC, G4double dMR, G4double dMz,
                        G4double bP) {
@@ -0,0 +1,41 @@
+#include "KM3Provenance.h"
+#include "G4VProcess.hh"
+#include <map>
+
+G4int KM3Provenance::CreatorCode(const G4VProcess *aProcess) {
+  static const G4VProcess *lastProcess = NULL;
+  static G4int lastCode = kOther;
+  static std::map<const G4VProcess *, G4int> theCodes;
+
+  if (aProcess == NULL) return kOther;
+  if (aProcess == lastProcess) return lastCode;
+
+  std::map<const G4VProcess *, G4int>::const_iterator it =
+      theCodes.find(aProcess);
+  G4int code;
+  if (it != theCodes.end()) {
+    code = it->second;
+  } else {
+    const G4String &creator = aProcess->GetProcessName();
+    if (creator == "KM3Cherenkov")
+      code = kCherenkov;
+    else if (creator == "muPairProd")
+      code = kPairProduction;
+    else if (creator == "muIoni")
+      code = kIonisation;
+    else if (creator == "muBrems")
+      code = kBremsstrahlung;
+    else if (creator == "muonNuclear")
+      code = kMuonNuclear;
+    else if (creator == "Decay")
+      code = kDecay;
+    else if (creator == "muMinusCaptureAtRest")
+      code = kCapture;
+    else
+      code = kOther;
+    theCodes[aProcess] = code;
+  }
+  lastProcess = aProcess;
+  lastCode = code;
+  return code;
+}
@@ -0,0 +1,46 @@
+#ifndef KM3Provenance_h
+#define KM3Provenance_h 1
+
+#include "globals.hh"
+
+class G4VProcess;
+
+// The origin of a track packed in one integer: the primary it descends
+// from, the process that created its first generation ancestor and a
+// few flags. Tracks and photons share the value of their ancestor, so
+// no per track copies are needed.
+//
+//   bits 0-3  creator code (as written in the hit tag of the evt file)
+//   bits 4-7  flags
+//   bits 8-   primary track number (1..N, 0 if unknown)
+class KM3Provenance {
+ public:
+  enum Creator {
+    kCherenkov = 0,  // light from the primary itself
+    kPairProduction = 1,
+    kIonisation = 2,
+    kBremsstrahlung = 3,
+    kMuonNuclear = 4,
+    kOther = 5,
+    kDecay = 8,
+    kCapture = 9
+  };
+
+  enum Flag {
+    kScattered = 1,  // emitted by a parametrization as already scattered
+    kBackground = 2  // optical background, no primary (see KM3Background)
+  };
+
+  static G4int Pack(G4int primary, G4int creator, G4int flags = 0) {
+    return (primary << 8) | ((flags & 0xf) << 4) | (creator & 0xf);
+  }
+  static G4int GetPrimary(G4int provenance) { return provenance >> 8; }
+  static G4int GetCreator(G4int provenance) { return provenance & 0xf; }
+  static G4int GetFlags(G4int provenance) { return (provenance >> 4) & 0xf; }
+
+  // the creator code of a process, the name is looked at only once per
+  // process
+  static G4int CreatorCode(const G4VProcess *);
+};
+
+#endif
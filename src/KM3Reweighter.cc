@@ -0,0 +1,186 @@
+#include "KM3Reweighter.h"
+#include "KM3Detector.h"
+#include "seaweed.h"
+#include "KM3CompressedStream.h"
+#include "G4ios.hh"
+#include "Randomize.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <math.h>
+#include <stdio.h>
+
+using CLHEP::c_light;
+using CLHEP::h_Planck;
+using CLHEP::meter;
+using CLHEP::nm;
+
+namespace {
+// a hit_photon word
+struct PhotonRecord {
+  G4int Id;
+  G4double Wavelength, PathLength;
+  G4int Scatters;
+  G4double AbsorptionLength, ScatteringLength, QE;
+  G4double Weight;
+};
+
+// as KM3EvtIO::AddHitPhoton
+std::string FormatPhoton(const PhotonRecord &aPhoton, G4int id) {
+  char buffer[256];
+  sprintf(buffer, "%8d %7.2f %9.3f %4d %8.3f %8.3f %7.5f", id,
+          aPhoton.Wavelength, aPhoton.PathLength, aPhoton.Scatters,
+          aPhoton.AbsorptionLength, aPhoton.ScatteringLength, aPhoton.QE);
+  return std::string(buffer);
+}
+}
+
+KM3Reweighter::KM3Reweighter(const std::string &ParameterFile) {
+  KM3Detector *aDetector = new KM3Detector;
+  aDetector->Parameter_File = ParameterFile;
+  aDetector->GetOpticalCurves(Energy, Absorption, Scattering, QE);
+  delete aDetector;
+  if (Energy.front() > Energy.back()) {
+    std::reverse(Energy.begin(), Energy.end());
+    std::reverse(Absorption.begin(), Absorption.end());
+    std::reverse(Scattering.begin(), Scattering.end());
+    std::reverse(QE.begin(), QE.end());
+  }
+  if (Energy.size() < 2)
+    G4Exception("Too few photon energies in the parameter file", "",
+                FatalException, "");
+}
+
+G4double KM3Reweighter::Interpolate(const std::vector<G4double> &values,
+                                    G4double energy) const {
+  if (energy <= Energy.front()) return values.front();
+  if (energy >= Energy.back()) return values.back();
+  size_t i = std::upper_bound(Energy.begin(), Energy.end(), energy) -
+             Energy.begin() - 1;
+  G4double f = (energy - Energy[i]) / (Energy[i + 1] - Energy[i]);
+  return values[i] + f * (values[i + 1] - values[i]);
+}
+
+G4double KM3Reweighter::PhotonWeight(G4double wavelength, G4double path,
+                                     G4int scatters, G4double abslength,
+                                     G4double scatlength, G4double qe) const {
+  G4double energy = h_Planck * c_light / (wavelength * nm);
+  G4double NewQE = Interpolate(QE, energy);
+  G4double NewAbsorption = Interpolate(Absorption, energy) / meter;
+  G4double NewScattering = Interpolate(Scattering, energy) / meter;
+  G4double LogWeight =
+      -path * (1.0 / NewAbsorption - 1.0 / abslength) -
+      path * (1.0 / NewScattering - 1.0 / scatlength) +
+      scatters * log(scatlength / NewScattering);
+  return NewQE / qe * exp(LogWeight);
+}
+
+void KM3Reweighter::Run(const std::string &EvtIn, const std::string &EvtOut,
+                        G4bool Downsample) {
+  KM3InputStream infile(EvtIn);
+  KM3OutputStream outfile(EvtOut);
+  if (!infile.good() || !outfile.good())
+    G4Exception("Error opening the evt files to reweight", "", FatalException,
+                "");
+
+  seaweed::event evt;
+  char buffer[256];
+  G4int NumberOfEvents = 0;
+  long PlainHits = 0;
+  long Overweight = 0;
+  while (evt.read(infile) == 0) {
+    G4int NumberOfHits = evt.ndat("hit");
+    if (NumberOfHits == 0) {
+      evt.write(outfile);
+      continue;
+    }
+    NumberOfEvents++;
+
+    // the photon records of every hit
+    std::map<G4int, std::vector<PhotonRecord> > photons;
+    G4int NumberOfPhotons = evt.ndat("hit_photon");
+    for (G4int ip = 0; ip < NumberOfPhotons; ip++) {
+      std::string dw = evt.next("hit_photon");
+      PhotonRecord aPhoton;
+      if (sscanf(dw.c_str(), "%d %lf %lf %d %lf %lf %lf", &aPhoton.Id,
+                 &aPhoton.Wavelength, &aPhoton.PathLength, &aPhoton.Scatters,
+                 &aPhoton.AbsorptionLength, &aPhoton.ScatteringLength,
+                 &aPhoton.QE) != 7)
+        G4Exception("Error reading a hit_photon record", "", FatalException,
+                    "");
+      aPhoton.Weight = PhotonWeight(
+          aPhoton.Wavelength, aPhoton.PathLength, aPhoton.Scatters,
+          aPhoton.AbsorptionLength, aPhoton.ScatteringLength, aPhoton.QE);
+      photons[aPhoton.Id].push_back(aPhoton);
+    }
+
+    std::vector<std::string> hits;
+    for (G4int ih = 0; ih < NumberOfHits; ih++) hits.push_back(evt.next("hit"));
+    if (!Downsample) {
+      evt.tagd("hit_weight");
+      for (G4int ih = 0; ih < NumberOfHits; ih++) {
+        G4int id = atoi(hits[ih].c_str());
+        G4double weight = 1.0;
+        if (photons.count(id) > 0) {
+          weight = 0.0;
+          for (size_t ip = 0; ip < photons[id].size(); ip++)
+            weight += photons[id][ip].Weight;
+        } else {
+          PlainHits++;
+        }
+        sprintf(buffer, "%8d %10.4f", id, weight);
+        evt.taga("hit_weight", buffer);
+      }
+      evt.write(outfile);
+      continue;
+    }
+
+    // keep the photons with the probability of their weight, the hits are
+    // renumbered and their photon counts rewritten
+    evt.tagd("hit");
+    evt.tagd("hit_photon");
+    evt.tagd("total_hits");
+    G4int NumberOfKept = 0;
+    for (G4int ih = 0; ih < NumberOfHits; ih++) {
+      G4int id, pmt, gid, trackid, npepure, creator;
+      G4double pe, t, ttpure;
+      if (sscanf(hits[ih].c_str(), "%d %d %lf %lf %d %d %d %lf %d", &id, &pmt,
+                 &pe, &t, &gid, &trackid, &npepure, &ttpure, &creator) != 9)
+        G4Exception("Error reading a hit", "", FatalException, "");
+      std::vector<const PhotonRecord *> kept;
+      G4int npe = npepure;
+      if (photons.count(id) > 0) {
+        const std::vector<PhotonRecord> &hitPhotons = photons[id];
+        for (size_t ip = 0; ip < hitPhotons.size(); ip++) {
+          if (hitPhotons[ip].Weight > 1.0) Overweight++;
+          if (G4UniformRand() < hitPhotons[ip].Weight)
+            kept.push_back(&hitPhotons[ip]);
+        }
+        npe = kept.size();
+      } else {
+        PlainHits++;
+      }
+      if (npe == 0) continue;
+      NumberOfKept++;
+      // as KM3EvtIO::AddHit
+      sprintf(buffer, "%8d %6d %6.2f %10.2f %4d %4d %3d %10.2f %4d",
+              NumberOfKept, pmt, double(npe), t, gid, trackid, npe, ttpure,
+              creator);
+      evt.taga("hit", buffer);
+      for (size_t ip = 0; ip < kept.size(); ip++)
+        evt.taga("hit_photon", FormatPhoton(*kept[ip], NumberOfKept));
+    }
+    sprintf(buffer, "%8d", NumberOfKept);
+    evt.taga("total_hits", buffer);
+    evt.write(outfile);
+  }
+
+  G4cout << "Reweighted " << NumberOfEvents << " events" << G4endl;
+  if (PlainHits > 0)
+    G4cout << PlainHits << " hits without photon records were kept as they "
+           << "were" << G4endl;
+  if (Overweight > 0)
+    G4cout << Overweight << " photons had a weight above 1 and were kept, "
+           << "the new parameters need a run with more light" << G4endl;
+}
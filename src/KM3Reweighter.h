@@ -0,0 +1,44 @@
+#ifndef KM3Reweighter_h
+#define KM3Reweighter_h 1
+
+#include <string>
+#include <vector>
+#include "globals.hh"
+
+// Reweights the hits of a run with extended hits (--extended-hits) to the
+// water and quantum efficiency of another parameter file, without
+// simulating again. Every hit_photon record gives the probability ratio
+// of its photon under the new parameters: the ratio of the quantum
+// efficiencies, of the survival exp(-L/a) over its path L, and of the
+// likelihood (1/s)^n exp(-L/s) of its n Mie scatters. The path itself is
+// kept, so the refraction index and the angular acceptance must not
+// change, and photons culled beyond the maximum absorption distance of
+// the run cannot come back.
+//
+// Each hit gets a hit_weight word, the sum of the weights of its photons.
+// With Downsample the photons are instead kept with the probability of
+// their weight and the hits are rewritten with those left, which is exact
+// for a run with --max-qe and a lower quantum efficiency.
+class KM3Reweighter {
+ public:
+  KM3Reweighter(const std::string &ParameterFile);
+  ~KM3Reweighter() {};
+
+  G4double PhotonWeight(G4double wavelength, G4double path, G4int scatters,
+                        G4double abslength, G4double scatlength,
+                        G4double qe) const;
+  void Run(const std::string &EvtIn, const std::string &EvtOut,
+           G4bool Downsample);
+
+ private:
+  // linear in the photon energy, as G4PhysicsVector::Value
+  G4double Interpolate(const std::vector<G4double> &values,
+                       G4double energy) const;
+
+  std::vector<G4double> Energy;
+  std::vector<G4double> Absorption;
+  std::vector<G4double> Scattering;
+  std::vector<G4double> QE;
+};
+
+#endif
@@ -4,15 +4,29 @@
 #include "G4ThreeVector.hh"
 #include "G4SDManager.hh"
 #include "G4ios.hh"
+#include "G4RunManager.hh"
+#include "G4Event.hh"
 #include "KM3TrackInformation.h"
+#include "KM3Provenance.h"
+#include "KM3TableBuilder.h"
+#include "KM3PMTResponse.h"
+#include "KM3Digitizer.h"
+#include "KM3Background.h"
+#include "KM3Trigger.h"
 
 using CLHEP::c_light;
 using CLHEP::cm;
+using CLHEP::h_Planck;
+using CLHEP::nm;
 using CLHEP::meter;
 using CLHEP::ns;
-using CLHEP::pi;
 
 KM3SD::KM3SD(G4String name) : G4VSensitiveDetector(name) {
+  theMaxQE = -1.0;
+  thespeedmaxQE = 0.0;
+  WaterAbsorption = NULL;
+  WaterScattering = NULL;
+  CathodQE = NULL;
   G4String HCname;
   collectionName.insert(HCname = "HitsCollection");
 }
@@ -20,7 +34,12 @@ KM3SD::KM3SD(G4String name) : G4VSensitiveDetector(name) {
 KM3SD::~KM3SD() {}
 
 void KM3SD::Initialize(G4HCofThisEvent *HCE) {
+  myTracking = (const KM3TrackingAction *)G4RunManager::GetRunManager()
+                   ->GetUserTrackingAction();
   HitsCollection = new KM3HitsCollection(SensitiveDetectorName, collectionName[0]);
+  for (G4int ir = 1; ir < myStDetector->Realisations; ir++)
+    RealisationHits.push_back(
+        new KM3HitsCollection(SensitiveDetectorName, collectionName[0]));
 }
 
 G4bool KM3SD::ProcessHits(G4Step *aStep, G4TouchableHistory *ROhist) {
@@ -96,12 +115,19 @@ G4bool KM3SD::ProcessHits(G4Step *aStep, G4TouchableHistory *ROhist) {
 		G4int id = theTouchable->GetCopyNumber();
 		G4int motherID = theTouchable->GetCopyNumber(1);
 
+    // when building the parametrization tables the photons are
+    // histogrammed before the angular acceptance and not recorded
+    if (myStDetector->TableBuilder != NULL) {
+      myStDetector->TableBuilder->AddPhoton(
+          id, aStep->GetPostStepPoint()->GetGlobalTime(), photonDirection);
+      aStep->GetTrack()->SetTrackStatus(fStopAndKill);
+      return false;
+    }
+
     // check if this photon passes after the angular acceptance
     G4ThreeVector PMTDirection = myStDetector->allCathods->GetDirection(id);
-    G4double CathodRadius = myStDetector->allCathods->GetCathodRadius(id);
-    G4double CathodHeight = myStDetector->allCathods->GetCathodHeight(id);
-    if (not AcceptAngle(photonDirection.dot(PMTDirection), CathodRadius,
-                      CathodHeight, false)) {
+    if (not myStDetector->PMTResponse->Accept(
+            id, photonDirection.dot(PMTDirection))) {
         // at this point we dont kill the track if it is not accepted
         // due to anglular acceptance this has an observable effect a
         // few percent only when running simulation with parametrization
@@ -119,53 +145,23 @@ G4bool KM3SD::ProcessHits(G4Step *aStep, G4TouchableHistory *ROhist) {
     newHit->SetCathodId(id);
     newHit->SetTime(aStep->GetPostStepPoint()->GetGlobalTime());
 
-    G4int originalTrackCreatorProcess;
-    G4int originalParentID;
+    // photons carry the provenance of the track that emitted them,
+    // unless it was set explicitly when they were injected
+    G4int provenance;
     if (info == NULL)
       info = (KM3TrackInformation *)(aStep->GetTrack()->GetUserInformation());
-    originalParentID = info->GetOriginalParentID();
-    G4String creator = info->GetOriginalTrackCreatorProcess();
-    if (creator == "KM3Cherenkov")
-      originalTrackCreatorProcess = 0;
-    else if (creator == "muPairProd")
-      originalTrackCreatorProcess = 1;
-    else if (creator == "muIoni")
-      originalTrackCreatorProcess = 2;
-    else if (creator == "muBrems")
-      originalTrackCreatorProcess = 3;
-    else if (creator == "muonNuclear")
-      originalTrackCreatorProcess = 4;
-    else if (creator == "Decay")
-      originalTrackCreatorProcess = 8;
-    else if (creator == "muMinusCaptureAtRest")
-      originalTrackCreatorProcess = 9;
-    else
-      originalTrackCreatorProcess = 5;
-    originalParentID = 1;
-    originalTrackCreatorProcess = 0;
-    if (creator == "KM3Cherenkov")
-      originalTrackCreatorProcess = 0;
-    else if (creator == "muPairProd")
-      originalTrackCreatorProcess = 1;
-    else if (creator == "muIoni")
-      originalTrackCreatorProcess = 2;
-    else if (creator == "muBrems")
-      originalTrackCreatorProcess = 3;
-    else if (creator == "muonNuclear")
-      originalTrackCreatorProcess = 4;
-    else if (creator == "Decay")
-      originalTrackCreatorProcess = 8;
-    else if (creator == "muMinusCaptureAtRest")
-      originalTrackCreatorProcess = 9;
+    if (info != NULL)
+      provenance = info->Provenance;
     else
-      originalTrackCreatorProcess = 5;
-    originalParentID = 1;
-    originalTrackCreatorProcess = 0;
-    G4int originalInfo;
-    originalInfo = (originalParentID - 1) * 10 + originalTrackCreatorProcess;
-    //    newHit->SetoriginalInfo(int(1.e6*h_Planck*c_light/aStep->GetTrack()->GetTotalEnergy()));
-    newHit->SetoriginalInfo(originalInfo);
+      provenance = myTracking->GetProvenance(aStep->GetTrack()->GetParentID());
+    newHit->SetoriginalInfo(provenance);
     newHit->SetMany(1);
+    if (myStDetector->ExtendedHits)
+      newHit->SetPhoton(NewHitPhoton(aStep->GetTrack(), info));
+    // photons of the other optical realisations carry their number
+    KM3HitsCollection *aCollection = HitsCollection;
+    if ((info != NULL) && (info->Realisation > 0))
+      aCollection = RealisationHits[info->Realisation - 1];
 
     // short    G4ThreeVector posHit=aStep->GetPostStepPoint()->GetPosition();
     // short    G4ThreeVector posPMT=myStDetector->allCathods->GetPosition();
@@ -195,7 +191,7 @@ G4bool KM3SD::ProcessHits(G4Step *aStep, G4TouchableHistory *ROhist) {
     // short    newHit->SetangleIncident(angleIncident);
     // short    newHit->SetangleDirection(angleDirection);
 
-    HitsCollection->insert(newHit);
+    aCollection->insert(newHit);
   }
 
   // killing must not been done, when we have EM or HA or FIT
@@ -205,204 +201,336 @@ G4bool KM3SD::ProcessHits(G4Step *aStep, G4TouchableHistory *ROhist) {
 
   return true;
 }
-// this method is used to add hits from the EM shower model
-//
-// short void KM3SD::InsertExternalHit(G4int id,G4double time,G4int
-// originalInfo,G4int angleDirection,G4int angleIncident)
-void KM3SD::InsertExternalHit(G4int id, const G4ThreeVector &OMPosition,
-                              G4double time, G4int originalInfo,
-                              const G4ThreeVector &photonDirection) {
-  // calculate the photon speed at max QE to correct time
-  static G4int ooo = 0;
-  if (ooo == 0) {
-    ooo = 1;
-    G4Material *cathMaterial = G4Material::GetMaterial("Cathod");
-    G4double MaxQE = -1;
-    G4double PhEneAtMaxQE;
-    G4MaterialPropertyVector *cathPropertyVector =
-        cathMaterial->GetMaterialPropertiesTable()->GetProperty("Q_EFF");
-    for (size_t i = 0; i < cathPropertyVector->GetVectorLength(); i++) {
-      G4double ThisQE = (*cathPropertyVector)[i];
-      G4double ThisPhEne = cathPropertyVector->Energy(i);
-      if (ThisQE > MaxQE) {
-        MaxQE = ThisQE;
-        PhEneAtMaxQE = ThisPhEne;
-      }
+KM3HitPhoton *KM3SD::NewHitPhoton(const G4Track *aTrack,
+                                  const KM3TrackInformation *info) {
+  if (CathodQE == NULL) {
+    G4MaterialPropertiesTable *WaterProperties =
+        G4Material::GetMaterial("Water")->GetMaterialPropertiesTable();
+    WaterAbsorption = WaterProperties->GetProperty("ABSLENGTH");
+    WaterScattering = WaterProperties->GetProperty("MIELENGTH");
+    CathodQE = G4Material::GetMaterial("Cathod")
+                   ->GetMaterialPropertiesTable()
+                   ->GetProperty("Q_EFF");
+  }
+  G4double energy = aTrack->GetTotalEnergy();
+  KM3HitPhoton *aPhoton = new KM3HitPhoton;
+  aPhoton->Wavelength = h_Planck * c_light / energy / nm;
+  aPhoton->PathLength = aTrack->GetTrackLength() / meter;
+  aPhoton->Scatters = (info != NULL) ? info->Scatters : 0;
+  aPhoton->AbsorptionLength = WaterAbsorption->Value(energy) / meter;
+  aPhoton->ScatteringLength = WaterScattering->Value(energy) / meter;
+  // as KM3Cherenkov applies it
+  aPhoton->QE = myStDetector->Quantum_Efficiency *
+                (myStDetector->MaxQE ? CathodQE->GetMaxValue()
+                                     : CathodQE->Value(energy));
+  return aPhoton;
+}
+
+void KM3SD::WriteHitPhotons(G4int numhit, G4int j) {
+  G4int last = j + (*HitsCollection)[j]->GetMany();
+  for (G4int k = j; k < last; k++) {
+    const KM3HitPhoton *aPhoton = (*HitsCollection)[k]->GetPhoton();
+    if (aPhoton == NULL) continue;
+    myStDetector->TheEVTtoWrite->AddHitPhoton(
+        numhit, aPhoton->Wavelength, aPhoton->PathLength, aPhoton->Scatters,
+        aPhoton->AbsorptionLength, aPhoton->ScatteringLength, aPhoton->QE);
+  }
+}
+
+// the maximum QE of the cathods and the group velocity of the photons
+// at that wavelength. The parametrizations are made at max QE
+void KM3SD::FindMaxQE() {
+  G4Material *cathMaterial = G4Material::GetMaterial("Cathod");
+  G4double PhEneAtMaxQE = 0.0;
+  theMaxQE = -1;
+  G4MaterialPropertyVector *cathPropertyVector =
+      cathMaterial->GetMaterialPropertiesTable()->GetProperty("Q_EFF");
+  for (size_t i = 0; i < cathPropertyVector->GetVectorLength(); i++) {
+    G4double ThisQE = (*cathPropertyVector)[i];
+    G4double ThisPhEne = cathPropertyVector->Energy(i);
+    if (ThisQE > theMaxQE) {
+      theMaxQE = ThisQE;
+      PhEneAtMaxQE = ThisPhEne;
     }
-    cathMaterial = G4Material::GetMaterial("Water");
-    G4MaterialPropertyVector *GroupVel =
-        cathMaterial->GetMaterialPropertiesTable()->GetProperty("GROUPVEL");
-    // coresponds to the maximum qe each time. This is the right one
-    thespeedmaxQE = GroupVel->Value(PhEneAtMaxQE);
   }
+  cathMaterial = G4Material::GetMaterial("Water");
+  G4MaterialPropertyVector *GroupVel =
+      cathMaterial->GetMaterialPropertiesTable()->GetProperty("GROUPVEL");
+  // coresponds to the maximum qe each time. This is the right one
+  thespeedmaxQE = GroupVel->Value(PhEneAtMaxQE);
+}
 
-  // TODO:
-  // why is this param stuff still here?
-  //G4ThreeVector dirPARAM(0.0, 0.0, 1.0);
-  //G4double startz = -600.0 * meter;
-  //G4ThreeVector vertexPARAM(0.0, 0.0, startz);
-  //G4ThreeVector posPMT = myStDetector->allCathods->GetPosition(id);
-  //G4double TRes = TResidual(time, posPMT, vertexPARAM, dirPARAM);
-  //if (fabs(TRes) < 20.0 * ns) ArrayParam[id]++;
-  //if ((TRes > -20.0 * ns) && (TRes < 100.0 * ns)) ArrayParamAll[id]++;
+G4double KM3SD::GetMaxQE() {
+  if (theMaxQE < 0.0) FindMaxQE();
+  return theMaxQE;
+}
+
+G4double KM3SD::GetSpeedAtMaxQE() {
+  if (theMaxQE < 0.0) FindMaxQE();
+  return thespeedmaxQE;
+}
+
+G4bool KM3SD::WriteTrigger() {
+  KM3Trigger *aTrigger = myStDetector->Trigger;
+  G4bool triggered = aTrigger->Process(*HitsCollection->GetVector());
+  myStDetector->TheEVTtoWrite->AddTrigger(
+      aTrigger->GetNumberOfL1(), aTrigger->GetNumberOfTriggerDOMs(),
+      triggered, triggered || (aTrigger->Mode != KM3Trigger::kNothing));
+  if (triggered || (aTrigger->Mode == KM3Trigger::kFull)) return true;
+  G4int NbHits = HitsCollection->entries();
+  G4int NbHitsWrite = 0;
+  for (G4int i = 0; i < NbHits; i++)
+    if ((*HitsCollection)[i]->GetMany() > 0) NbHitsWrite++;
+  myStDetector->TheEVTtoWrite->AddNumberOfHits(NbHitsWrite);
+  return false;
+}
+
+void KM3SD::WriteRawHits() {
+  const std::vector<KM3RawHit> &RawHits =
+      myStDetector->Digitizer->Digitize(*HitsCollection->GetVector());
+  myStDetector->TheEVTtoWrite->AddNumberOfRawHits(RawHits.size());
+  for (size_t ih = 0; ih < RawHits.size(); ih++)
+    myStDetector->TheEVTtoWrite->AddRawHit(ih + 1, RawHits[ih].CathodId,
+                                           G4int(RawHits[ih].ToT / ns),
+                                           RawHits[ih].Time / ns);
+}
+
+// this method is used to add hits from the EM shower model. The photon
+// arrives on OM iom with the given direction, it is given to the cathod
+// of the OM that faces it best
+void KM3SD::InsertExternalHit(G4int iom, G4double time, G4int originalInfo,
+                              const G4ThreeVector &photonDirection) {
+  if (HitsCollection->entries() >= 10000000) return;
+
+  const OpticalModule &anOM = myStDetector->allCathods->GetOM(iom);
+  G4int id = -1;
+  G4double cosangle = 2.0;
+  for (size_t ic = 0; ic < anOM.CathodIds.size(); ic++) {
+    G4double c = photonDirection.dot(
+        myStDetector->allCathods->GetDirection(anOM.CathodIds[ic]));
+    if (c < cosangle) {
+      cosangle = c;
+      id = anOM.CathodIds[ic];
+    }
+  }
+  if (id < 0) return;
+  if (!myStDetector->PMTResponse->AcceptSpherical(cosangle)) return;
+
+  KM3Hit *newHit = new KM3Hit();
+  newHit->SetCathodId(id);
+  newHit->SetTime(time);
+  newHit->SetoriginalInfo(originalInfo);
+  newHit->SetMany(1);
+  HitsCollection->insert(newHit);
 }
 
 void KM3SD::EndOfEvent(G4HCofThisEvent *HCE) {
   if (verboseLevel > 0) {
-    G4int TotalNumberOfCathods = myStDetector->allCathods->GetNumberOfCathods();
-    outfile = myStDetector->outfile;
-    // count for this event
-    G4int NbHits = HitsCollection->entries();
-    // count total
-    static G4int ooo = 0;
-    ooo += NbHits;
-    G4cout << "Total Hits: " << ooo << G4endl;
-    G4cout << "This Event Hits: " << NbHits << G4endl;
-    int i;
-
-    // here we sort HitsCollection according to ascending pmt number
-    std::vector<KM3Hit *> *theCollectionVector = HitsCollection->GetVector();
-    QuickSort(0, theCollectionVector, 0, NbHits - 1);
-    // from now on the hits are sorted in cathod id
-    // next sort according to ascending time for each cathod id
-    if (NbHits > 1) {
-      G4int prevCathod, currentCathod;
-      G4int istart, istop;
-      istart = 0;
-      prevCathod = (*HitsCollection)[istart]->GetCathodId();
-      for (i = 1; i < NbHits; i++) {
-        currentCathod = (*HitsCollection)[i]->GetCathodId();
-        if (currentCathod != prevCathod) {
-          istop = i - 1;
-          QuickSort(1, theCollectionVector, istart, istop);
-          G4double MergeWindow = 0.5 * ns;
-          MergeHits(istart, istop + 1, MergeWindow);
-          prevCathod = currentCathod;
-          istart = i;
-        } else if ((currentCathod == prevCathod) && (i == NbHits - 1)) {
-          istop = i;
-          QuickSort(1, theCollectionVector, istart, istop);
-          G4double MergeWindow = 0.5 * ns;
-          MergeHits(istart, istop + 1, MergeWindow);
-        }
-      }
+    // the other optical realisations go to their own copies of the event
+    KM3HitsCollection *firstHits = HitsCollection;
+    for (size_t ir = 0; ir < RealisationHits.size(); ir++) {
+      myStDetector->TheEVTtoWrite->SetRealisation(ir + 1);
+      HitsCollection = RealisationHits[ir];
+      AddPMTResponse(ir + 1);
+      WriteHits(NULL);
     }
+    RealisationHits.clear();
+    myStDetector->TheEVTtoWrite->SetRealisation(0);
+    HitsCollection = firstHits;
+    AddPMTResponse(0);
+    WriteHits(HCE);
+  }
+}
 
-    // find the number of hit entries to write
-    G4int NbHitsWrite = 0;
-    for (i = 0; i < NbHits; i++)
-      if ((*HitsCollection)[i]->GetMany() > 0) NbHitsWrite++;
-
-    // find earliest hit time
-    G4double timefirst = 1E20;
-    for (i = 0; i < NbHits; i++) {
-      if ((*HitsCollection)[i]->GetTime() < timefirst &&
-          (*HitsCollection)[i]->GetMany() > 0)
-        timefirst = (*HitsCollection)[i]->GetTime();
+// the efficiencies and the time spread of the PMTs, then the background,
+// whose rates are the ones the PMTs see
+void KM3SD::AddPMTResponse(G4int realisation) {
+  myStDetector->PMTResponse->Apply(HitsCollection);
+  if (myStDetector->Background != NULL)
+    myStDetector->Background->AddHits(
+        HitsCollection, myStDetector->allCathods,
+        G4RunManager::GetRunManager()->GetCurrentEvent()->GetEventID(),
+        realisation);
+}
+
+// sorts and merges the hits of HitsCollection and adds them to the event
+void KM3SD::WriteHits(G4HCofThisEvent *HCE) {
+  G4int TotalNumberOfCathods = myStDetector->allCathods->GetNumberOfCathods();
+  outfile = myStDetector->outfile;
+  // count for this event
+  G4int NbHits = HitsCollection->entries();
+  // count total
+  static G4int ooo = 0;
+  ooo += NbHits;
+  G4cout << "Total Hits: " << ooo << G4endl;
+  G4cout << "This Event Hits: " << NbHits << G4endl;
+  int i;
+
+  // here we sort HitsCollection according to ascending pmt number
+  std::vector<KM3Hit *> *theCollectionVector = HitsCollection->GetVector();
+  QuickSort(0, theCollectionVector, 0, NbHits - 1);
+  // from now on the hits are sorted in cathod id
+  // next sort according to ascending time for each cathod id
+  if (NbHits > 1) {
+    G4int prevCathod, currentCathod;
+    G4int istart, istop;
+    istart = 0;
+    prevCathod = (*HitsCollection)[istart]->GetCathodId();
+    for (i = 1; i < NbHits; i++) {
+      currentCathod = (*HitsCollection)[i]->GetCathodId();
+      if (currentCathod != prevCathod) {
+        istop = i - 1;
+        QuickSort(1, theCollectionVector, istart, istop);
+        G4double MergeWindow = 0.5 * ns;
+        MergeHits(istart, istop + 1, MergeWindow);
+        prevCathod = currentCathod;
+        istart = i;
+      } else if ((currentCathod == prevCathod) && (i == NbHits - 1)) {
+        istop = i;
+        QuickSort(1, theCollectionVector, istart, istop);
+        G4double MergeWindow = 0.5 * ns;
+        MergeHits(istart, istop + 1, MergeWindow);
+      }
     }
+  }
 
-    // find how many cathods are hitted
-    int allhit = 0;
-    int prevcathod = -1;
-    for (i = 0; i < NbHits; i++) {
-      if (prevcathod != (*HitsCollection)[i]->GetCathodId()) allhit++;
-      prevcathod = (*HitsCollection)[i]->GetCathodId();
+  // an event the trigger would not keep loses its hits
+  if ((myStDetector->Trigger != NULL) && !WriteTrigger()) {
+    ReleaseHits(HCE);
+    return;
+  }
+
+  // only the pulses of the PMTs are written
+  if (myStDetector->Digitizer != NULL) {
+    WriteRawHits();
+    ReleaseHits(HCE);
+    return;
+  }
+
+  // find the number of hit entries to write
+  G4int NbHitsWrite = 0;
+  for (i = 0; i < NbHits; i++)
+    if ((*HitsCollection)[i]->GetMany() > 0) NbHitsWrite++;
+
+  // find earliest hit time
+  G4double timefirst = 1E20;
+  for (i = 0; i < NbHits; i++) {
+    if ((*HitsCollection)[i]->GetTime() < timefirst &&
+        (*HitsCollection)[i]->GetMany() > 0)
+      timefirst = (*HitsCollection)[i]->GetTime();
+  }
+
+  // find how many cathods are hitted
+  int allhit = 0;
+  int prevcathod = -1;
+  for (i = 0; i < NbHits; i++) {
+    if (prevcathod != (*HitsCollection)[i]->GetCathodId()) allhit++;
+    prevcathod = (*HitsCollection)[i]->GetCathodId();
+  }
+  myStDetector->TheEVTtoWrite->AddNumberOfHits(NbHitsWrite);
+
+  // find the last pmt how many hits has
+  G4int LastPmtNumber;
+  G4int LastHitNumber;
+  for (i = NbHits - 1; i >= 0; i--)
+    if ((*HitsCollection)[i]->GetMany() > 0) {
+      LastPmtNumber = (*HitsCollection)[i]->GetCathodId();
+      LastHitNumber = i;
+      break;
     }
-    myStDetector->TheEVTtoWrite->AddNumberOfHits(NbHitsWrite);
-
-    // find the last pmt how many hits has
-    G4int LastPmtNumber;
-    G4int LastHitNumber;
-    for (i = NbHits - 1; i >= 0; i--)
-      if ((*HitsCollection)[i]->GetMany() > 0) {
-        LastPmtNumber = (*HitsCollection)[i]->GetCathodId();
-        LastHitNumber = i;
+  G4int LastPmtNumHits = 0;
+  for (i = NbHits - 1; i >= 0; i--)
+    if ((*HitsCollection)[i]->GetMany() > 0) {
+      if ((*HitsCollection)[i]->GetCathodId() == LastPmtNumber)
+        LastPmtNumHits++;
+      else
         break;
-      }
-    G4int LastPmtNumHits = 0;
-    for (i = NbHits - 1; i >= 0; i--)
-      if ((*HitsCollection)[i]->GetMany() > 0) {
-        if ((*HitsCollection)[i]->GetCathodId() == LastPmtNumber)
-          LastPmtNumHits++;
-        else
-          break;
-      }
+    }
 
-    int numphotons = 0;
-    G4double firstphoton = 1.E50;
-    int numpes = 0;
-    if (NbHits > 0) prevcathod = (*HitsCollection)[0]->GetCathodId();
-    int prevstart = 0;
-    int numhit = 0;
-    for (i = 0; i < NbHits; i++) {
-      if ((*HitsCollection)[i]->GetMany() > 0) {
-        if (prevcathod == (*HitsCollection)[i]->GetCathodId()) {
-          numphotons++;
-          numpes += (*HitsCollection)[i]->GetMany();
-          if ((*HitsCollection)[i]->GetTime() - timefirst < firstphoton)
-            firstphoton = (*HitsCollection)[i]->GetTime() - timefirst;
-        } else {
-          if (myStDetector->vrmlhits) {  // draw hits
-            G4ThreeVector Cposition =
-                myStDetector->allCathods->GetPosition(prevcathod);
-          }
-          for (int j = prevstart; j < i; j++) {
-            if ((*HitsCollection)[j]->GetMany() > 0) {
-              numhit++;
-              // here write antares format info
-              G4int originalInfo = (*HitsCollection)[j]->GetoriginalInfo();
-              G4int originalParticleNumber = originalInfo / 10 + 1;
-              G4int originalTrackCreatorProcess =
-                  originalInfo - (originalParticleNumber - 1) * 10;
-              myStDetector->TheEVTtoWrite->AddHit(
-                  numhit, prevcathod, double((*HitsCollection)[j]->GetMany()),
-                  (*HitsCollection)[j]->GetTime(), originalParticleNumber,
-                  (*HitsCollection)[j]->GetMany(), (*HitsCollection)[j]->GetTime(),
-                  originalTrackCreatorProcess);
-            }
-          }
-          prevstart = i;
-          numphotons = 1;
+  int numphotons = 0;
+  G4double firstphoton = 1.E50;
+  int numpes = 0;
+  if (NbHits > 0) prevcathod = (*HitsCollection)[0]->GetCathodId();
+  int prevstart = 0;
+  int numhit = 0;
+  for (i = 0; i < NbHits; i++) {
+    if ((*HitsCollection)[i]->GetMany() > 0) {
+      if (prevcathod == (*HitsCollection)[i]->GetCathodId()) {
+        numphotons++;
+        numpes += (*HitsCollection)[i]->GetMany();
+        if ((*HitsCollection)[i]->GetTime() - timefirst < firstphoton)
           firstphoton = (*HitsCollection)[i]->GetTime() - timefirst;
-          numpes = (*HitsCollection)[i]->GetMany();
+      } else {
+        if (myStDetector->vrmlhits) {  // draw hits
+          G4ThreeVector Cposition =
+              myStDetector->allCathods->GetPosition(prevcathod);
         }
-        prevcathod = (*HitsCollection)[i]->GetCathodId();
-        //  if(i == (NbHits-1) ){
-        //  if(numhit == (NbHitsWrite-1) ){
-        if (numhit == (NbHitsWrite - LastPmtNumHits) && i == LastHitNumber) {
-          if (myStDetector->vrmlhits) {  // draw hits
-            G4ThreeVector Cposition = myStDetector->allCathods->GetPosition(
-                (*HitsCollection)[i]->GetCathodId());
+        for (int j = prevstart; j < i; j++) {
+          if ((*HitsCollection)[j]->GetMany() > 0) {
+            numhit++;
+            // here write antares format info
+            G4int originalInfo = (*HitsCollection)[j]->GetoriginalInfo();
+            G4int originalParticleNumber =
+                KM3Provenance::GetPrimary(originalInfo);
+            G4int originalTrackCreatorProcess =
+                KM3Provenance::GetCreator(originalInfo);
+            myStDetector->TheEVTtoWrite->AddHit(
+                numhit, prevcathod, double((*HitsCollection)[j]->GetMany()),
+                (*HitsCollection)[j]->GetTime(), originalParticleNumber,
+                (*HitsCollection)[j]->GetMany(), (*HitsCollection)[j]->GetTime(),
+                originalTrackCreatorProcess);
+            if (myStDetector->ExtendedHits) WriteHitPhotons(numhit, j);
           }
-          for (int j = prevstart; j < NbHits; j++) {
-            if ((*HitsCollection)[j]->GetMany() > 0) {
-              numhit++;
-              // here write antares format info
-              G4int originalInfo = (*HitsCollection)[j]->GetoriginalInfo();
-              G4int originalParticleNumber = originalInfo / 10 + 1;
-              G4int originalTrackCreatorProcess =
-                  originalInfo - (originalParticleNumber - 1) * 10;
-              myStDetector->TheEVTtoWrite->AddHit(
-                  numhit, (*HitsCollection)[i]->GetCathodId(),
-                  double((*HitsCollection)[j]->GetMany()),
-                  (*HitsCollection)[j]->GetTime(), originalParticleNumber,
-                  (*HitsCollection)[j]->GetMany(), (*HitsCollection)[j]->GetTime(),
-                  originalTrackCreatorProcess);
-            }
+        }
+        prevstart = i;
+        numphotons = 1;
+        firstphoton = (*HitsCollection)[i]->GetTime() - timefirst;
+        numpes = (*HitsCollection)[i]->GetMany();
+      }
+      prevcathod = (*HitsCollection)[i]->GetCathodId();
+      //  if(i == (NbHits-1) ){
+      //  if(numhit == (NbHitsWrite-1) ){
+      if (numhit == (NbHitsWrite - LastPmtNumHits) && i == LastHitNumber) {
+        if (myStDetector->vrmlhits) {  // draw hits
+          G4ThreeVector Cposition = myStDetector->allCathods->GetPosition(
+              (*HitsCollection)[i]->GetCathodId());
+        }
+        for (int j = prevstart; j < NbHits; j++) {
+          if ((*HitsCollection)[j]->GetMany() > 0) {
+            numhit++;
+            // here write antares format info
+            G4int originalInfo = (*HitsCollection)[j]->GetoriginalInfo();
+            G4int originalParticleNumber =
+                KM3Provenance::GetPrimary(originalInfo);
+            G4int originalTrackCreatorProcess =
+                KM3Provenance::GetCreator(originalInfo);
+            myStDetector->TheEVTtoWrite->AddHit(
+                numhit, (*HitsCollection)[i]->GetCathodId(),
+                double((*HitsCollection)[j]->GetMany()),
+                (*HitsCollection)[j]->GetTime(), originalParticleNumber,
+                (*HitsCollection)[j]->GetMany(), (*HitsCollection)[j]->GetTime(),
+                originalTrackCreatorProcess);
+            if (myStDetector->ExtendedHits) WriteHitPhotons(numhit, j);
           }
         }
       }
     }
-
-    if (myStDetector->vrmlhits) {
-      static G4int HCID = -1;
-      if (HCID < 0) {
-        HCID = GetCollectionID(0);
-      }
-      HCE->AddHitsCollection(HCID, HitsCollection);
-    } else
-      delete HitsCollection;
   }
+
+  ReleaseHits(HCE);
+}
+
+// the event owns the hits it draws, the others are done with
+void KM3SD::ReleaseHits(G4HCofThisEvent *HCE) {
+  if (myStDetector->vrmlhits && (HCE != NULL)) {
+    static G4int HCID = -1;
+    if (HCID < 0) {
+      HCID = GetCollectionID(0);
+    }
+    HCE->AddHitsCollection(HCID, HitsCollection);
+  } else
+    delete HitsCollection;
+  HitsCollection = NULL;
 }
 
 void KM3SD::MergeHits(G4int nfirst, G4int nlast, G4double MergeWindow) {
@@ -526,43 +654,3 @@ G4int KM3SD::partition_Time(std::vector<KM3Hit *> *theCollectionVector,
   } while (i < j);
   return j;  // returns middle subscript
 }
-
-// the angular acceptance is according to the MultiPMT OM (WPD
-// Document January 2011) doing linear interpolation
-// if shapespherical==true then it is from parametrization and take
-// into account only the <<experimental>> angular acceptance
-// if shapespherical==false then it is not from param and take also
-// the simulated angular acceptance of the cathod shape
-G4bool KM3SD::AcceptAngle(G4double cosangle, G4double CathodRadius,
-                          G4double CathodHeight, bool shapespherical) {
-  static G4MaterialPropertyVector *Ang_Acc = NULL;
-  static G4double MinCos_Acc = -1.0;
-  static G4double MaxCos_Acc = 0.25;
-  if (Ang_Acc == NULL) {
-    G4Material *cathMaterial = G4Material::GetMaterial("Cathod");
-    Ang_Acc = cathMaterial->GetMaterialPropertiesTable()->GetProperty(
-        "ANGULAR_ACCEPTANCE");
-    MinCos_Acc = Ang_Acc->GetMinLowEdgeEnergy();
-    MaxCos_Acc = Ang_Acc->GetMaxLowEdgeEnergy();
-  }
-
-  if (cosangle > MaxCos_Acc) return false;
-  if (cosangle < MinCos_Acc) return true;
-  G4double AngAcc = Ang_Acc->Value(cosangle);
-
-  // the following is the simulated angular acceptance (from the shape of the
-  // photocathod)
-  // A cylinder of radius R and height d has angular acceptance vs costh as
-  // a(x)=abs(x)+(2*d/(pi*R))*sqrt(1-x*x)
-  G4double AngularAccSim;
-
-  if (!shapespherical) {
-    AngularAccSim = fabs(cosangle) +
-                    (2.0 * CathodHeight / (pi * CathodRadius)) *
-                        sqrt(1 - cosangle * cosangle);
-    AngAcc /= AngularAccSim;
-  }
-
-  if (G4UniformRand() <= AngAcc) return true;
-  return false;
-}
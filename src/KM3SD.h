@@ -6,6 +6,7 @@
 #include <stdio.h>
 #include <vector>
 #include "KM3Detector.h"
+#include "KM3TrackingAction.h"
 #include "Randomize.hh"
 #include "G4MaterialPropertiesTable.hh"
 #include <CLHEP/Units/SystemOfUnits.h>
@@ -13,6 +14,7 @@
 
 class G4Step;
 class G4HCofThisEvent;
+class KM3TrackInformation;
 
 class KM3SD : public G4VSensitiveDetector {
  public:
@@ -24,15 +26,30 @@ class KM3SD : public G4VSensitiveDetector {
   G4bool ProcessHits(G4Step *, G4TouchableHistory *);
   void EndOfEvent(G4HCofThisEvent *);
   KM3Detector *myStDetector;
-  // short  void InsertExternalHit(G4int ic,G4double time,G4int
-  // originalInfo,G4int angleDirection,G4int angleIncident);
-  void InsertExternalHit(G4int ic, const G4ThreeVector &OMPosition,
-                         G4double time, G4int originalInfo,
+  // hit from a parametrization on OM iom, originalInfo is the packed
+  // provenance (see KM3Provenance)
+  void InsertExternalHit(G4int iom, G4double time, G4int originalInfo,
                          const G4ThreeVector &photonDirection);
+  G4double GetMaxQE();
+  G4double GetSpeedAtMaxQE();
 
  private:
   KM3HitsCollection *HitsCollection;
+  // the hits of the optical realisations after the first, see
+  // KM3Detector::Realisations
+  std::vector<KM3HitsCollection *> RealisationHits;
+  // holds the provenance of the tracks emitting the photons
+  const KM3TrackingAction *myTracking;
   G4int ProcessHitsCollection(KM3HitsCollection *aCollection);
+  void AddPMTResponse(G4int realisation);
+  void WriteHits(G4HCofThisEvent *HCE);
+  // runs the trigger on the sorted and merged HitsCollection, false if
+  // its hits are not to be written
+  G4bool WriteTrigger();
+  // the digitized hits of the sorted and merged HitsCollection
+  void WriteRawHits();
+  // hands HitsCollection to HCE or deletes it, on every path of WriteHits
+  void ReleaseHits(G4HCofThisEvent *HCE);
   G4double TResidual(G4double, const G4ThreeVector &, const G4ThreeVector &,
                      const G4ThreeVector &);
   void clear();
@@ -43,9 +60,17 @@ class KM3SD : public G4VSensitiveDetector {
                            G4int top, G4int bottom);
   G4int partition_Time(std::vector<KM3Hit *> *theCollectionVector, G4int top,
                        G4int bottom);
-  G4bool AcceptAngle(G4double cosangle, G4double CathodRadius,
-                     G4double CathodHeight, bool);
   void MergeHits(G4int nfirst, G4int nlast, G4double MergeWindow);
+  // the extended record of a detected photon
+  KM3HitPhoton *NewHitPhoton(const G4Track *aTrack,
+                             const KM3TrackInformation *info);
+  // the photon records of the hit at j, merged from the hits after it
+  void WriteHitPhotons(G4int numhit, G4int j);
+  G4MaterialPropertyVector *WaterAbsorption;
+  G4MaterialPropertyVector *WaterScattering;
+  G4MaterialPropertyVector *CathodQE;
+  void FindMaxQE();
+  G4double theMaxQE;
   G4double thespeedmaxQE;
 };
 
@@ -0,0 +1,73 @@
+#include "KM3Sampling.h"
+#include "Randomize.hh"
+#include <algorithm>
+
+void KM3AliasTable::Build(const G4float *cumulative, G4int n, G4int stride) {
+  Prob.assign(n, 0.0);
+  Alias.assign(n, 0);
+  // the bins, with the decreasing steps of the cumulative clamped at 0
+  std::vector<G4double> scaled(n);
+  G4double total = 0.0;
+  G4double previous = 0.0;
+  for (G4int i = 0; i < n; i++) {
+    G4double c = cumulative[i * stride];
+    scaled[i] = std::max(c - previous, 0.0);
+    previous = std::max(previous, c);
+    total += scaled[i];
+  }
+  if (total <= 0.0)
+    G4Exception("Alias table of an empty distribution", "", FatalException,
+                "");
+
+  // probabilities scaled so that their mean is one
+  std::vector<G4int> small, large;
+  for (G4int i = 0; i < n; i++) {
+    scaled[i] *= n / total;
+    if (scaled[i] < 1.0)
+      small.push_back(i);
+    else
+      large.push_back(i);
+  }
+  while (!small.empty() && !large.empty()) {
+    G4int s = small.back();
+    small.pop_back();
+    G4int l = large.back();
+    Prob[s] = scaled[s];
+    Alias[s] = l;
+    scaled[l] -= 1.0 - scaled[s];
+    if (scaled[l] < 1.0) {
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+  // what is left is one up to rounding
+  for (size_t i = 0; i < large.size(); i++) {
+    Prob[large[i]] = 1.0;
+    Alias[large[i]] = large[i];
+  }
+  for (size_t i = 0; i < small.size(); i++) {
+    Prob[small[i]] = 1.0;
+    Alias[small[i]] = small[i];
+  }
+}
+
+G4int KM3AliasTable::Sample() const {
+  G4double u = G4UniformRand() * Prob.size();
+  G4int i = G4int(u);
+  if (i >= G4int(Prob.size())) i = Prob.size() - 1;
+  if (u - i < Prob[i]) return i;
+  return Alias[i];
+}
+
+void KM3ValidBins::Bracket(G4double x, G4int &ibin1, G4int &ibin2) const {
+  G4int n = Values.size();
+  if (n < 2)
+    G4Exception("Less than two valid bins to interpolate", "", FatalException,
+                "");
+  // the first valid bin above x, or the last one
+  G4int k = std::upper_bound(Values.begin(), Values.end(), x) - Values.begin();
+  if (k == n) k = n - 1;
+  if (k == 0) k = 1;
+  ibin1 = Bins[k - 1];
+  ibin2 = Bins[k];
+}
@@ -0,0 +1,42 @@
+#ifndef KM3Sampling_h
+#define KM3Sampling_h 1
+
+#include <vector>
+#include "globals.hh"
+
+// Walker's alias table (Vose's construction) of a discrete distribution
+// given as a cumulative, so that a bin is drawn with one random number in
+// constant time instead of scanning the cumulative.
+class KM3AliasTable {
+ public:
+  KM3AliasTable() {};
+  // n cumulative values, stride floats apart. The last one need not be 1,
+  // a decrease counts as an empty bin and the bins are normalized to their
+  // sum
+  void Build(const G4float *cumulative, G4int n, G4int stride = 1);
+  G4bool IsBuilt() const { return !Prob.empty(); };
+  G4int Sample() const;
+
+ private:
+  std::vector<G4float> Prob;
+  std::vector<G4int> Alias;
+};
+
+// Bins of a table in increasing value, some of which may be invalid (a
+// null distribution). Bracket finds by binary search the two valid bins
+// to interpolate between, the same way the linear scans over the valid
+// bins did.
+class KM3ValidBins {
+ public:
+  void Add(G4int bin, G4double value) {
+    Bins.push_back(bin);
+    Values.push_back(value);
+  };
+  void Bracket(G4double x, G4int &ibin1, G4int &ibin2) const;
+
+ private:
+  std::vector<G4int> Bins;
+  std::vector<G4double> Values;
+};
+
+#endif
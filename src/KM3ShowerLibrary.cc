@@ -0,0 +1,234 @@
+#include "KM3ShowerLibrary.h"
+#include "KM3MappedFile.h"
+#include "G4Track.hh"
+#include "G4OpticalPhoton.hh"
+#include "G4ios.hh"
+#include "Randomize.hh"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+
+using CLHEP::GeV;
+using CLHEP::eV;
+using CLHEP::meter;
+using CLHEP::ns;
+
+namespace {
+// a shower to write and where its photons are
+struct LibraryEntry {
+  KM3LibraryShower Shower;
+  const KM3LibraryPhoton *Photons;
+};
+
+bool LibraryEntryOrder(const LibraryEntry &a, const LibraryEntry &b) {
+  if (a.Shower.Particle != b.Shower.Particle)
+    return a.Shower.Particle < b.Shower.Particle;
+  return a.Shower.Energy < b.Shower.Energy;
+}
+
+// the number of showers and the padding up to the records
+const size_t LibraryPreamble = 2 * sizeof(uint64_t);
+
+void WriteLibrary(const std::string &LibraryOut,
+                  std::vector<LibraryEntry> &entries) {
+  std::stable_sort(entries.begin(), entries.end(), LibraryEntryOrder);
+  uint64_t NumberOfPhotons = 0;
+  for (size_t is = 0; is < entries.size(); is++) {
+    entries[is].Shower.FirstPhoton = NumberOfPhotons;
+    NumberOfPhotons += entries[is].Shower.NumberOfPhotons;
+  }
+
+  std::ofstream outfile(LibraryOut.c_str(), std::ios::out | std::ios::binary);
+  std::vector<uint32_t> types(1, KM3MappedFile::kShowerBlock);
+  std::vector<uint64_t> sizes(
+      1, LibraryPreamble + entries.size() * sizeof(KM3LibraryShower) +
+             NumberOfPhotons * sizeof(KM3LibraryPhoton));
+  KM3MappedFile::WriteHeader(outfile, types, sizes);
+  uint64_t preamble[2] = {entries.size(), 0};
+  outfile.write((const char *)preamble, sizeof(preamble));
+  for (size_t is = 0; is < entries.size(); is++)
+    outfile.write((const char *)&entries[is].Shower,
+                  sizeof(KM3LibraryShower));
+  for (size_t is = 0; is < entries.size(); is++)
+    outfile.write((const char *)entries[is].Photons,
+                  entries[is].Shower.NumberOfPhotons *
+                      sizeof(KM3LibraryPhoton));
+  if (!outfile.good())
+    G4Exception("Error writing shower library", "", FatalException, "");
+  G4cout << "Shower library " << LibraryOut << ": " << entries.size()
+         << " showers, " << NumberOfPhotons << " photons" << G4endl;
+}
+}
+
+KM3ShowerLibrary::KM3ShowerLibrary(const std::string &aFile) {
+  myFile = KM3MappedFile::Open(aFile);
+  G4int ib = myFile->HasHeader()
+                 ? myFile->FindBlock(KM3MappedFile::kShowerBlock)
+                 : -1;
+  if (ib < 0)
+    G4Exception("Not a shower library file", "", FatalException, "");
+  const char *base = (const char *)myFile->GetData(myFile->GetBlockOffset(ib));
+  const char *end = (const char *)myFile->GetDataEnd();
+  NumberOfShowers = *(const uint64_t *)base;
+  Showers = (const KM3LibraryShower *)(base + LibraryPreamble);
+  Photons = (const KM3LibraryPhoton *)(Showers + NumberOfShowers);
+  if ((NumberOfShowers == 0) || ((const char *)Photons > end))
+    G4Exception("Shower library is empty or truncated", "", FatalException,
+                "");
+  const KM3LibraryShower &last = Showers[NumberOfShowers - 1];
+  if ((const char *)(Photons + last.FirstPhoton + last.NumberOfPhotons) > end)
+    G4Exception("Shower library is truncated", "", FatalException, "");
+
+  // the records are sorted, so the showers of one particle and energy
+  // are consecutive
+  for (uint64_t is = 0; is < NumberOfShowers; is++) {
+    std::vector<EnergyGroup> &groups = Groups[Showers[is].Particle];
+    if (groups.empty() ||
+        (groups.back().Energy != Showers[is].Energy * GeV)) {
+      EnergyGroup aGroup;
+      aGroup.Energy = Showers[is].Energy * GeV;
+      aGroup.First = is;
+      groups.push_back(aGroup);
+    }
+    groups.back().Last = is + 1;
+  }
+}
+
+const std::vector<KM3ShowerLibrary::EnergyGroup> *KM3ShowerLibrary::FindGroups(
+    G4int particle) const {
+  std::map<G4int, std::vector<EnergyGroup> >::const_iterator it =
+      Groups.find(particle);
+  if ((it == Groups.end()) && ((particle == 11) || (particle == -11)))
+    it = Groups.find(-particle);
+  if (it == Groups.end()) it = Groups.begin();
+  return &it->second;
+}
+
+const KM3LibraryShower *KM3ShowerLibrary::FindShower(G4int particle,
+                                                     G4double energy) const {
+  const std::vector<EnergyGroup> &groups = *FindGroups(particle);
+  size_t best = 0;
+  G4double bestDistance = fabs(log(energy / groups[0].Energy));
+  for (size_t ig = 1; ig < groups.size(); ig++) {
+    G4double distance = fabs(log(energy / groups[ig].Energy));
+    if (distance < bestDistance) {
+      best = ig;
+      bestDistance = distance;
+    }
+  }
+  const EnergyGroup &aGroup = groups[best];
+  uint64_t is = aGroup.First + uint64_t(G4UniformRand() *
+                                        (aGroup.Last - aGroup.First));
+  if (is >= aGroup.Last) is = aGroup.Last - 1;
+  return Showers + is;
+}
+
+KM3ShowerRecorder::KM3ShowerRecorder(const std::string &aFile) {
+  FileName = aFile;
+  SpoolName = aFile + ".photons";
+  Spool.open(SpoolName.c_str(), std::ios::out | std::ios::binary);
+  if (!Spool.good())
+    G4Exception("Error opening shower library spool file", "",
+                FatalException, "");
+  SpooledPhotons = 0;
+  Recording = false;
+}
+
+KM3ShowerRecorder::~KM3ShowerRecorder() {
+  if (Spool.is_open()) {
+    Spool.close();
+    remove(SpoolName.c_str());
+  }
+}
+
+G4bool KM3ShowerRecorder::AddTrack(const G4Track *aTrack) {
+  if (aTrack->GetParentID() == 0) {
+    G4int pdg = aTrack->GetDefinition()->GetPDGEncoding();
+    if ((pdg != 11) && (pdg != -11) && (pdg != 22))
+      G4Exception("Shower library primaries must be e-, e+ or gamma", "",
+                  FatalException, "");
+    if (Recording)
+      G4Exception("Shower library events must have one primary", "",
+                  FatalException, "");
+    Recording = true;
+    Current.Particle = pdg;
+    Current.Energy = aTrack->GetKineticEnergy() / GeV;
+    Current.FirstPhoton = SpooledPhotons;
+    Current.NumberOfPhotons = 0;
+    Vertex = aTrack->GetPosition();
+    StartTime = aTrack->GetGlobalTime();
+    AxisZ = aTrack->GetMomentumDirection();
+    AxisX = AxisZ.orthogonal().unit();
+    AxisY = AxisZ.cross(AxisX);
+    return false;
+  }
+  if (aTrack->GetDefinition() != G4OpticalPhoton::OpticalPhotonDefinition())
+    return false;
+
+  // in the frame of the primary
+  G4ThreeVector x = aTrack->GetPosition() - Vertex;
+  const G4ThreeVector &p = aTrack->GetMomentumDirection();
+  KM3LibraryPhoton aPhoton;
+  aPhoton.Position[0] = x.dot(AxisX) / meter;
+  aPhoton.Position[1] = x.dot(AxisY) / meter;
+  aPhoton.Position[2] = x.dot(AxisZ) / meter;
+  aPhoton.Direction[0] = p.dot(AxisX);
+  aPhoton.Direction[1] = p.dot(AxisY);
+  aPhoton.Direction[2] = p.dot(AxisZ);
+  aPhoton.Time = (aTrack->GetGlobalTime() - StartTime) / ns;
+  aPhoton.Energy = aTrack->GetKineticEnergy() / eV;
+  Buffer.push_back(aPhoton);
+  return true;
+}
+
+void KM3ShowerRecorder::EndOfEvent() {
+  if (!Recording) return;
+  Recording = false;
+  Current.NumberOfPhotons = Buffer.size();
+  if (!Buffer.empty())
+    Spool.write((const char *)&Buffer[0],
+                Buffer.size() * sizeof(KM3LibraryPhoton));
+  if (!Spool.good())
+    G4Exception("Error writing shower library spool file", "",
+                FatalException, "");
+  SpooledPhotons += Buffer.size();
+  Showers.push_back(Current);
+  Buffer.clear();
+}
+
+void KM3ShowerRecorder::Save() {
+  Spool.close();
+  if (Showers.empty())
+    G4Exception("No showers recorded for the library", "", FatalException,
+                "");
+  // the spool is a raw file, mapped whole
+  const KM3LibraryPhoton *spooled = NULL;
+  if (SpooledPhotons > 0)
+    spooled = (const KM3LibraryPhoton *)KM3MappedFile::Open(SpoolName)
+                  ->GetData(0);
+  std::vector<LibraryEntry> entries(Showers.size());
+  for (size_t is = 0; is < Showers.size(); is++) {
+    entries[is].Shower = Showers[is];
+    entries[is].Photons = spooled + Showers[is].FirstPhoton;
+  }
+  WriteLibrary(FileName, entries);
+  remove(SpoolName.c_str());
+}
+
+void KM3ShowerRecorder::Merge(const std::vector<std::string> &LibrariesIn,
+                              const std::string &LibraryOut) {
+  std::vector<LibraryEntry> entries;
+  for (size_t il = 0; il < LibrariesIn.size(); il++) {
+    KM3ShowerLibrary *aLibrary = new KM3ShowerLibrary(LibrariesIn[il]);
+    for (G4int is = 0; is < aLibrary->GetNumberOfShowers(); is++) {
+      LibraryEntry anEntry;
+      anEntry.Shower = *aLibrary->GetShower(is);
+      anEntry.Photons = aLibrary->GetPhotons(aLibrary->GetShower(is));
+      entries.push_back(anEntry);
+    }
+    // the mapping stays in the registry
+    delete aLibrary;
+  }
+  WriteLibrary(LibraryOut, entries);
+}
@@ -0,0 +1,105 @@
+#ifndef KM3ShowerLibrary_h
+#define KM3ShowerLibrary_h 1
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <stdint.h>
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+
+class G4Track;
+class KM3MappedFile;
+
+// A library of electromagnetic showers of full simulation. Every shower
+// is the list of the Cherenkov photons it emitted (after the quantum
+// efficiency that KM3Cherenkov applies), in the frame of the particle
+// that started it: vertex at the origin, direction along z, time zero at
+// the start. A library depends on the water and on the cathods it was
+// recorded with, like the parametrization tables.
+//
+// The library is a block of a KM3TABLE file (KM3MappedFile::kShowerBlock):
+// the number of showers, the shower records sorted by particle and
+// energy, and the photons of all the showers. It is mapped read-only, so
+// all the processes of a node share it.
+struct KM3LibraryShower {
+  int32_t Particle;  // PDG code
+  G4float Energy;    // kinetic, GeV
+  uint64_t FirstPhoton;
+  uint64_t NumberOfPhotons;
+};
+
+struct KM3LibraryPhoton {
+  G4float Position[3];   // m
+  G4float Direction[3];
+  G4float Time;          // ns
+  G4float Energy;        // eV
+};
+
+class KM3ShowerLibrary {
+ public:
+  KM3ShowerLibrary(const std::string &aFile);
+  ~KM3ShowerLibrary() {};
+
+  // a random shower of this particle at the recorded energy nearest to
+  // this one (in log). An e+ may get an e- shower and the other way
+  // round, and any shower is better than none
+  const KM3LibraryShower *FindShower(G4int particle, G4double energy) const;
+  const KM3LibraryShower *GetShower(G4int is) const { return Showers + is; };
+  const KM3LibraryPhoton *GetPhotons(const KM3LibraryShower *aShower) const {
+    return Photons + aShower->FirstPhoton;
+  };
+  G4int GetNumberOfShowers() const { return NumberOfShowers; };
+
+ private:
+  // the showers of one particle and energy, [First, Last) in Showers
+  struct EnergyGroup {
+    G4double Energy;
+    uint64_t First;
+    uint64_t Last;
+  };
+  const std::vector<EnergyGroup> *FindGroups(G4int particle) const;
+
+  const KM3MappedFile *myFile;
+  uint64_t NumberOfShowers;
+  const KM3LibraryShower *Showers;
+  const KM3LibraryPhoton *Photons;
+  std::map<G4int, std::vector<EnergyGroup> > Groups;
+};
+
+// Records a shower library. Every event must have one e-, e+ or gamma
+// primary: its photons are taken when the stacking action sees them and
+// killed, and are spooled to a scratch file next to the library. Save
+// sorts the showers and writes the library.
+class KM3ShowerRecorder {
+ public:
+  KM3ShowerRecorder(const std::string &aFile);
+  ~KM3ShowerRecorder();
+
+  // for every new track; true if it was taken and must be killed
+  G4bool AddTrack(const G4Track *aTrack);
+  void EndOfEvent();
+  void Save();
+
+  // the showers of all the libraries in one
+  static void Merge(const std::vector<std::string> &LibrariesIn,
+                    const std::string &LibraryOut);
+
+ private:
+  std::string FileName;
+  std::string SpoolName;
+  std::ofstream Spool;
+  uint64_t SpooledPhotons;
+  std::vector<KM3LibraryShower> Showers;
+
+  // the shower of the current event
+  G4bool Recording;
+  KM3LibraryShower Current;
+  G4ThreeVector Vertex;
+  G4double StartTime;
+  G4ThreeVector AxisX, AxisY, AxisZ;
+  std::vector<KM3LibraryPhoton> Buffer;
+};
+
+#endif
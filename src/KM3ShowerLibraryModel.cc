@@ -0,0 +1,117 @@
+#include "KM3ShowerLibraryModel.h"
+#include "KM3Detector.h"
+#include "G4Electron.hh"
+#include "G4Positron.hh"
+#include "G4Gamma.hh"
+#include "G4OpticalPhoton.hh"
+#include "G4DynamicParticle.hh"
+#include "Randomize.hh"
+
+using CLHEP::GeV;
+using CLHEP::eV;
+using CLHEP::meter;
+using CLHEP::ns;
+using CLHEP::twopi;
+
+KM3ShowerLibraryModel::KM3ShowerLibraryModel(const G4String &name,
+                                             G4Region *anEnvelope,
+                                             KM3Detector *aDetector)
+    : G4VFastSimulationModel(name, anEnvelope) {
+  myStDetector = aDetector;
+  myLibrary = NULL;
+  EnergyThreshold = 1.0 * GeV;
+}
+
+KM3ShowerLibraryModel::~KM3ShowerLibraryModel() { delete myLibrary; }
+
+void KM3ShowerLibraryModel::LoadLibrary(const G4String &aFile) {
+  delete myLibrary;
+  myLibrary = new KM3ShowerLibrary(aFile);
+}
+
+G4bool KM3ShowerLibraryModel::IsApplicable(
+    const G4ParticleDefinition &particle) {
+  return (&particle == G4Electron::ElectronDefinition()) ||
+         (&particle == G4Positron::PositronDefinition()) ||
+         (&particle == G4Gamma::GammaDefinition());
+}
+
+G4bool KM3ShowerLibraryModel::ModelTrigger(const G4FastTrack &fastTrack) {
+  const G4Track *track = fastTrack.GetPrimaryTrack();
+  if (track->GetKineticEnergy() < EnergyThreshold) return false;
+  return myStDetector->BoundingVolume->IsInside(track->GetPosition());
+}
+
+void KM3ShowerLibraryModel::DoIt(const G4FastTrack &fastTrack,
+                                 G4FastStep &fastStep) {
+  const G4Track *track = fastTrack.GetPrimaryTrack();
+  G4double energy = track->GetKineticEnergy();
+  G4int particle = track->GetDefinition()->GetPDGEncoding();
+  G4ThreeVector x0 = track->GetPosition();
+  G4ThreeVector p0 = track->GetMomentumDirection();
+  G4double t0 = track->GetGlobalTime();
+
+  fastStep.KillPrimaryTrack();
+  fastStep.ProposePrimaryTrackPathLength(0.0);
+  fastStep.ProposeTotalEnergyDeposited(energy);
+
+  // whole showers up to the energy, each picked anew, and a part of one
+  // more for the rest
+  std::vector<const KM3LibraryShower *> showers;
+  G4double remaining = energy;
+  G4double fraction = 1.0;
+  uint64_t NumberOfPhotons = 0;
+  while (remaining > 0.0) {
+    const KM3LibraryShower *aShower = myLibrary->FindShower(particle, energy);
+    G4double ShowerEnergy = aShower->Energy * GeV;
+    showers.push_back(aShower);
+    NumberOfPhotons += aShower->NumberOfPhotons;
+    if (ShowerEnergy >= remaining) fraction = remaining / ShowerEnergy;
+    remaining -= ShowerEnergy;
+  }
+
+  fastStep.SetNumberOfSecondaryTracks(NumberOfPhotons);
+  for (size_t is = 0; is < showers.size(); is++)
+    Replay(showers[is], (is + 1 < showers.size()) ? 1.0 : fraction, x0, p0,
+           t0, fastStep);
+}
+
+void KM3ShowerLibraryModel::Replay(const KM3LibraryShower *aShower,
+                                   G4double fraction,
+                                   const G4ThreeVector &x0,
+                                   const G4ThreeVector &p0, G4double t0,
+                                   G4FastStep &fastStep) {
+  // the frame of the particle, turned by a random azimuth so that the
+  // same shower replayed twice does not look the same
+  G4ThreeVector x = p0.orthogonal().unit();
+  x.rotate(twopi * G4UniformRand(), p0);
+  G4ThreeVector y = p0.cross(x);
+
+  const KM3LibraryPhoton *photons = myLibrary->GetPhotons(aShower);
+  for (uint64_t ip = 0; ip < aShower->NumberOfPhotons; ip++) {
+    if ((fraction < 1.0) && (G4UniformRand() >= fraction)) continue;
+    const KM3LibraryPhoton &aPhoton = photons[ip];
+    G4ThreeVector position =
+        x0 + (aPhoton.Position[0] * x + aPhoton.Position[1] * y +
+              aPhoton.Position[2] * p0) *
+                 meter;
+    // the stacking action would kill them anyway
+    if (!myStDetector->BoundingVolume->IsInside(position)) continue;
+    G4ThreeVector direction = aPhoton.Direction[0] * x +
+                              aPhoton.Direction[1] * y +
+                              aPhoton.Direction[2] * p0;
+    direction = direction.unit();
+    // Cherenkov light is polarized in the plane of the photon and the
+    // shower axis, which is the best guess for the emitter
+    G4ThreeVector polarization = direction.dot(p0) * direction - p0;
+    if (polarization.mag2() < 1.0e-12) polarization = direction.orthogonal();
+    polarization = polarization.unit();
+
+    G4DynamicParticle aCerenkovPhoton(G4OpticalPhoton::OpticalPhoton(),
+                                      direction, aPhoton.Energy * eV);
+    aCerenkovPhoton.SetPolarization(polarization.x(), polarization.y(),
+                                    polarization.z());
+    fastStep.CreateSecondaryTrack(aCerenkovPhoton, position,
+                                  t0 + aPhoton.Time * ns, false);
+  }
+}
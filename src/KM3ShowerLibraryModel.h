@@ -0,0 +1,43 @@
+#ifndef KM3ShowerLibraryModel_h
+#define KM3ShowerLibraryModel_h 1
+
+#include "G4VFastSimulationModel.hh"
+#include "G4Region.hh"
+#include "globals.hh"
+#include "KM3ShowerLibrary.h"
+#include <CLHEP/Units/SystemOfUnits.h>
+
+class KM3Detector;
+
+// Replay of recorded electromagnetic showers. An e-, e+ or gamma above
+// EnergyThreshold is killed and the photons of library showers of the
+// nearest energy are created in its place, rotated to its direction (at
+// a random azimuth), moved to its position and delayed to its time.
+// They are then propagated like the photons of KM3Cherenkov, so unlike
+// KM3EMShowerModel the scattering and the geometry are simulated. The
+// energy is matched by replaying whole showers, and the last one
+// partially, keeping every photon with the remaining fraction.
+class KM3ShowerLibraryModel : public G4VFastSimulationModel {
+ public:
+  KM3ShowerLibraryModel(const G4String &, G4Region *, KM3Detector *);
+  ~KM3ShowerLibraryModel();
+
+  void LoadLibrary(const G4String &aFile);
+
+  G4bool IsApplicable(const G4ParticleDefinition &);
+  G4bool ModelTrigger(const G4FastTrack &);
+  void DoIt(const G4FastTrack &, G4FastStep &);
+
+  G4double EnergyThreshold;
+
+ private:
+  // the photons of aShower kept with this probability
+  void Replay(const KM3LibraryShower *aShower, G4double fraction,
+              const G4ThreeVector &x0, const G4ThreeVector &p0, G4double t0,
+              G4FastStep &fastStep);
+
+  KM3Detector *myStDetector;
+  KM3ShowerLibrary *myLibrary;
+};
+
+#endif
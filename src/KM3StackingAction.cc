@@ -5,8 +5,15 @@
 #include "G4Track.hh"
 #include "G4UnitsTable.hh"
 #include "G4VProcess.hh"
+#include "KM3DeltaRayLight.h"
+#include "KM3ShowerLibrary.h"
 #include <math.h>
+#include <climits>
+#include <fstream>
+#include <sstream>
 #include "G4StackManager.hh"
+#include "G4ParticleTable.hh"
+#include "KM3Evaluator.h"
 // the following was added to see what initial hadrons can give muons
 //#include "KM3TrackInformation.h"
 //#ifdef G4MYHAMUONS_PARAMETERIZATION
@@ -20,118 +27,205 @@ using CLHEP::TeV;
 using CLHEP::ns;
 using CLHEP::m;
 
-KM3StackingAction::KM3StackingAction() { ; }
+KM3StackingAction::KM3StackingAction() {
+  MyStDetector = NULL;
+  LastDefinition = NULL;
+  LastRule = NULL;
+  CurrentStage = kMuonStage;
+  DefaultRule.Threshold = 0.0;
+  DefaultRule.Stage = kShowerStage;
+  DefaultRule.Kill = false;
+  DefaultRule.Muon = false;
+  DefaultRule.CanCut = true;
+  // enough to keep peak memory around a few hundred MB
+  HighWaterMark[kMuonStage] = INT_MAX;
+  HighWaterMark[kShowerStage] = 200000;
+  HighWaterMark[kPhotonStage] = 500000;
+  for (G4int i = 0; i < kNumberOfStages; i++) NumberOfDrains[i] = 0;
+}
 
-KM3StackingAction::~KM3StackingAction() { ; }
+KM3StackingAction::~KM3StackingAction() {
+  for (G4int i = 0; i < kNumberOfStages; i++)
+    if (NumberOfDrains[i] > 0)
+      G4cout << "Stage " << i << " was drained early " << NumberOfDrains[i]
+             << " times" << G4endl;
+}
 
 G4ClassificationOfNewTrack KM3StackingAction::ClassifyNewTrack(
     const G4Track *aTrack) {
-  static KM3PrimaryGeneratorAction *aGeneAction =
-      (KM3PrimaryGeneratorAction *)(G4RunManager::GetRunManager()
-                                        ->GetUserPrimaryGeneratorAction());
-  G4double kineticEnergy;
-  G4ThreeVector x0;
-  G4ThreeVector p0;
-  G4ThreeVector distanceV;
-  G4double direction, distanceRho2;
-  static G4double detectorMaxRho2 =
-      MyStDetector->detectorMaxRho * MyStDetector->detectorMaxRho;
-
   // here kill tracks that have already killed by other classes
   if ((aTrack->GetTrackStatus() == fStopAndKill) ||
       (aTrack->GetTrackStatus() == fKillTrackAndSecondaries))
     return fKill;
 
-  // first check that is not a photon to save time
-  if (aTrack->GetDefinition() != G4OpticalPhoton::OpticalPhotonDefinition()) {
-    kineticEnergy = aTrack->GetKineticEnergy();
+  // the photons of a shower being recorded are not propagated
+  if ((MyStDetector->ShowerRecorder != NULL) &&
+      MyStDetector->ShowerRecorder->AddTrack(aTrack))
+    return fKill;
 
-    // threshold for electron cerenkov production (not applicable for
-    // positron due to anihhilation
-    if ((aTrack->GetDefinition()->GetParticleName() == "e-") &&
-        (kineticEnergy < 240 * keV))
-      return fKill;
-    // threshold for gamma potentially absorbed by an atomic electron
-    if ((aTrack->GetDefinition()->GetParticleName() == "gamma") &&
-        (kineticEnergy < 240 * keV))
+  const ParticleRule &rule = GetRule(aTrack->GetDefinition());
+  if (rule.Kill) return fKill;
+
+  // delta rays whose light is parametrized along the muon
+  if ((MyStDetector->DeltaRayLight != NULL) &&
+      MyStDetector->DeltaRayLight->IsSuppressed(aTrack))
+    return fKill;
+
+  // threshold for Cherenkov production or absorption by an atomic electron
+  if (aTrack->GetKineticEnergy() < rule.Threshold) return fKill;
+
+  if (rule.Muon) {
+    // if it is a muon kill it only if is not going to cross the can
+    G4double CanIn, CanOut;
+    if (!MyStDetector->BoundingVolume->Intersect(
+            aTrack->GetPosition(), aTrack->GetMomentumDirection(), CanIn,
+            CanOut) ||
+        (CanOut <= 0))
       return fKill;
-    // kill produced neutrinos
-    if ((aTrack->GetDefinition()->GetParticleType() == "lepton") &&
-        (aTrack->GetDefinition()->GetPDGMass() == 0.0))
+  } else if (rule.CanCut) {
+    // if the particle is created outside the can kill it
+    if (!MyStDetector->BoundingVolume->IsInside(aTrack->GetPosition()))
       return fKill;
+  }
 
-    x0 = aTrack->GetPosition();
-    distanceV = x0 - MyStDetector->detectorCenter;
-    distanceRho2 = distanceV[0] * distanceV[0] + distanceV[1] * distanceV[1];
-
-    // if the particle is not muon and is created outside the can kill it
-    if (aTrack->GetDefinition() != G4MuonPlus::MuonPlusDefinition() &&
-        aTrack->GetDefinition() != G4MuonMinus::MuonMinusDefinition()) {
-      if ((x0[2] < MyStDetector->bottomPosition) ||
-          (distanceRho2 > detectorMaxRho2) ||
-          (x0[2] > MyStDetector->detectorMaxz))
-        return fKill;
-      return fUrgent;
-    } else {
-      // if it is a muon kill it only if is not going to cross the can
-      p0 = aTrack->GetMomentumDirection();
-      if ((x0[2] < MyStDetector->bottomPosition) && (p0[2] < 0))
-        // goes down while below the can
-        return fKill;
-      if ((x0[2] > MyStDetector->detectorMaxz) && (p0[2] > 0))
-        // goes up while above the can
-        return fKill;
-      direction = p0[0] * distanceV[0] + p0[1] * distanceV[1];
-      if ((distanceRho2 > detectorMaxRho2) && (direction > 0))
-        // goes away while outside the can
-        return fKill;
-
-      // first check if it is inside the can
-      G4double rxy2 = x0[0] * x0[0] + x0[1] * x0[1];
-      if ((rxy2 < detectorMaxRho2) && (x0[2] > MyStDetector->bottomPosition) &&
-          (x0[2] < MyStDetector->detectorMaxz))
-        return fUrgent;
-      G4double Ttop = (MyStDetector->detectorMaxz - x0[2]) / p0[2];
-      if (Ttop > 0) {
-        G4double Xtop = x0[0] + Ttop * p0[0] - MyStDetector->detectorCenter[0];
-        G4double Ytop = x0[1] + Ttop * p0[1] - MyStDetector->detectorCenter[1];
-        G4double dRhoTop = Xtop * Xtop + Ytop * Ytop;
-        if (dRhoTop < detectorMaxRho2) return fUrgent;
-      }
-      G4double Tbottom = (MyStDetector->bottomPosition - x0[2]) / p0[2];
-      if (Tbottom > 0) {
-        G4double Xbottom =
-            x0[0] + Tbottom * p0[0] - MyStDetector->detectorCenter[0];
-        G4double Ybottom =
-            x0[1] + Tbottom * p0[1] - MyStDetector->detectorCenter[1];
-        G4double dRhoBottom = Xbottom * Xbottom + Ybottom * Ybottom;
-        if (dRhoBottom < detectorMaxRho2) return fUrgent;
-      }
-      G4double a = p0[0] * p0[0] + p0[1] * p0[1];
-      G4double b = x0[0] * p0[0] + x0[1] * p0[1];
-      G4double c = x0[0] * x0[0] + x0[1] * x0[1] - detectorMaxRho2;
-      G4double dia = b * b - a * c;
-      if (dia > 0) {
-        dia = sqrt(dia);
-        G4double SideDist1 = (-b - dia) / a;
-        G4double sidez1 = x0[2] + SideDist1 * p0[2];
-        if ((sidez1 > MyStDetector->bottomPosition) &&
-            (sidez1 < MyStDetector->detectorMaxz) && (SideDist1 > 0))
-          return fUrgent;
-        G4double SideDist2 = (-b + dia) / a;
-        G4double sidez2 = x0[2] + SideDist2 * p0[2];
-        if ((sidez2 > MyStDetector->bottomPosition) &&
-            (sidez2 < MyStDetector->detectorMaxz) && (SideDist2 > 0))
-          return fUrgent;
-      }
-      return fKill;
-    }
+  G4int stage = rule.Stage;
+  if (aTrack->GetParentID() == 0) stage = kMuonStage;
+  return StageToStack(stage);
+}
+
+G4ClassificationOfNewTrack KM3StackingAction::StageToStack(G4int stage) {
+  // stages already reached are tracked at once
+  G4int ahead = stage - CurrentStage;
+  if (ahead <= 0) return fUrgent;
+
+  // fWaiting is the next stage, fWaiting_1 the one after. When a stage
+  // piles up beyond its high-water mark it is moved to the urgent
+  // stack, so it is tracked before anything else
+  G4int waiting = stackManager->GetNWaitingTrack(ahead - 1);
+  G4ClassificationOfNewTrack stack =
+      (ahead == 1) ? fWaiting : (G4ClassificationOfNewTrack)(fWaiting_1 +
+                                                             ahead - 2);
+  if (waiting >= HighWaterMark[stage]) {
+    stackManager->TransferStackedTracks(stack, fUrgent);
+    NumberOfDrains[stage]++;
+    return fUrgent;
   }
-  return fUrgent;
+  return stack;
 }
 
-void KM3StackingAction::NewStage() {}
+void KM3StackingAction::NewStage() {
+  // the stage just tracked is complete
+  for (size_t i = 0; i < theHooks.size(); i++)
+    theHooks[i]->StageFinished(CurrentStage);
+  CurrentStage++;
+}
 
-void KM3StackingAction::PrepareNewEvent() {}
+void KM3StackingAction::PrepareNewEvent() {
+  if (theRules.empty()) {
+    BuildRules();
+    stackManager->SetNumberOfAdditionalWaitingStacks(kNumberOfStages - 2);
+  }
+  CurrentStage = kMuonStage;
+}
 
 void KM3StackingAction::SetDetector(KM3Detector *adet) { MyStDetector = adet; }
+
+void KM3StackingAction::SetHighWaterMark(G4int stage, G4int ntracks) {
+  if ((stage < 0) || (stage >= kNumberOfStages))
+    G4Exception("Stacking stage out of range", "", FatalException, "");
+  HighWaterMark[stage] = ntracks;
+}
+
+void KM3StackingAction::AddStageHook(KM3StageHook *aHook) {
+  theHooks.push_back(aHook);
+}
+
+const KM3StackingAction::ParticleRule &KM3StackingAction::GetRule(
+    const G4ParticleDefinition *aDefinition) {
+  if (aDefinition == LastDefinition) return *LastRule;
+  std::map<const G4ParticleDefinition *, ParticleRule>::const_iterator it =
+      theRules.find(aDefinition);
+  LastDefinition = aDefinition;
+  LastRule = (it == theRules.end()) ? &DefaultRule : &(it->second);
+  return *LastRule;
+}
+
+void KM3StackingAction::BuildRules() {
+  G4ParticleTable::G4PTblDicIterator *theParticleIterator =
+      G4ParticleTable::GetParticleTable()->GetIterator();
+  theParticleIterator->reset();
+  while ((*theParticleIterator)()) {
+    G4ParticleDefinition *particle = theParticleIterator->value();
+    ParticleRule rule = DefaultRule;
+    if (particle == G4OpticalPhoton::OpticalPhotonDefinition()) {
+      // photons are culled at emission
+      rule.Stage = kPhotonStage;
+      rule.CanCut = false;
+    } else if ((particle == G4MuonPlus::MuonPlusDefinition()) ||
+               (particle == G4MuonMinus::MuonMinusDefinition())) {
+      rule.Stage = kMuonStage;
+      rule.Muon = true;
+      rule.CanCut = false;
+    } else if (particle == G4Geantino::GeantinoDefinition()) {
+      // stands for the segments of an emitter file, wherever it is
+      rule.Stage = kMuonStage;
+      rule.CanCut = false;
+    } else if ((particle->GetParticleType() == "lepton") &&
+               (particle->GetPDGMass() == 0.0)) {
+      // kill produced neutrinos
+      rule.Kill = true;
+    } else if (particle == G4Electron::ElectronDefinition()) {
+      // threshold for electron cerenkov production (not applicable for
+      // positron due to anihhilation
+      rule.Threshold = 240 * keV;
+    } else if (particle == G4Gamma::GammaDefinition()) {
+      // threshold for gamma potentially absorbed by an atomic electron
+      rule.Threshold = 240 * keV;
+    }
+    theRules[particle] = rule;
+  }
+  LastDefinition = NULL;
+
+  if (!PolicyFile.empty()) ReadPolicy(PolicyFile);
+}
+
+// Each line of the policy file is one of
+//   <particle name> <threshold> <stage> [kill]
+//   HIGHWATER <stage> <number of tracks>
+// Thresholds are expressions with Geant4 units (e.g. 240*keV), lines
+// starting with # are comments.
+void KM3StackingAction::ReadPolicy(const G4String &aFile) {
+  std::ifstream infile(aFile.c_str());
+  if (!infile.good())
+    G4Exception("Error opening the stacking policy file", "", FatalException,
+                "");
+
+  KM3Evaluator fCalc(aFile);
+  G4int nline = 0;
+  std::string line;
+  while (std::getline(infile, line)) {
+    nline++;
+    std::istringstream iss(line);
+    std::string name, first, second, flag;
+    if (!(iss >> name) || (name[0] == '#')) continue;
+    if (!(iss >> first >> second))
+      G4Exception("Incomplete line in the stacking policy file", "",
+                  FatalException, "");
+    if (name == "HIGHWATER") {
+      SetHighWaterMark((G4int)fCalc.Evaluate(first, nline),
+                       (G4int)fCalc.Evaluate(second, nline));
+      continue;
+    }
+    G4ParticleDefinition *particle =
+        G4ParticleTable::GetParticleTable()->FindParticle(name);
+    if (particle == NULL)
+      G4Exception("Unknown particle in the stacking policy file", "",
+                  FatalException, "");
+    ParticleRule &rule = theRules[particle];
+    rule.Threshold = fCalc.Evaluate(first, nline);
+    rule.Stage = (G4int)fCalc.Evaluate(second, nline);
+    if ((rule.Stage < 0) || (rule.Stage >= kNumberOfStages))
+      G4Exception("Stacking stage out of range", "", FatalException, "");
+    rule.Kill = (iss >> flag) && (flag == "kill");
+  }
+}
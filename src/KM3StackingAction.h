@@ -8,21 +8,69 @@
 #include "KM3EMDeltaFlux.h"
 #include <CLHEP/Units/SystemOfUnits.h>
 #include <CLHEP/Units/PhysicalConstants.h>
+#include <map>
+#include <vector>
+
+// called by the stacking action every time a stage has been tracked
+// completely, e.g. to run a fast simulation on what was collected
+class KM3StageHook {
+ public:
+  virtual ~KM3StageHook() {}
+  virtual void StageFinished(G4int stage) = 0;
+};
 
 class KM3StackingAction : public G4UserStackingAction {
  public:
   KM3StackingAction();
   virtual ~KM3StackingAction();
 
+  // tracks are processed stage by stage in this order
+  enum Stage {
+    kMuonStage = 0,    // primaries and muons
+    kShowerStage = 1,  // hadronic and electromagnetic showers
+    kPhotonStage = 2,  // optical photons
+    kNumberOfStages = 3
+  };
+
+  // what happens to new tracks of one particle type
+  struct ParticleRule {
+    G4double Threshold;  // kinetic energy below which the track is killed
+    G4int Stage;
+    G4bool Kill;       // never tracked (e.g. neutrinos)
+    G4bool Muon;       // kept only if its line crosses the can
+    G4bool CanCut;     // kept only if created inside the can
+  };
+
  public:
   virtual G4ClassificationOfNewTrack ClassifyNewTrack(const G4Track *aTrack);
   virtual void NewStage();
   virtual void PrepareNewEvent();
   void SetDetector(KM3Detector *);
 
+  // optional file overriding the default rules, see ReadPolicy
+  G4String PolicyFile;
+  void SetHighWaterMark(G4int stage, G4int ntracks);
+  void AddStageHook(KM3StageHook *);
+
  private:
+  void BuildRules();
+  void ReadPolicy(const G4String &);
+  const ParticleRule &GetRule(const G4ParticleDefinition *);
+  G4ClassificationOfNewTrack StageToStack(G4int stage);
+
   KM3Detector *MyStDetector;
 
+  std::map<const G4ParticleDefinition *, ParticleRule> theRules;
+  // most tracks come in runs of the same type
+  const G4ParticleDefinition *LastDefinition;
+  const ParticleRule *LastRule;
+  ParticleRule DefaultRule;
+
+  G4int CurrentStage;
+  G4int HighWaterMark[kNumberOfStages];
+  G4int NumberOfDrains[kNumberOfStages];
+  std::vector<KM3StageHook *> theHooks;
+
  protected:
 };
 
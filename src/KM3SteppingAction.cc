@@ -2,6 +2,8 @@
 #include "G4ParticleDefinition.hh"
 #include "G4ParticleTypes.hh"
 #include "G4Step.hh"
+#include "KM3DeltaRayLight.h"
+#include "KM3MuonLight.h"
 
 using CLHEP::TeV;
 using CLHEP::GeV;
@@ -21,12 +23,39 @@ KM3SteppingAction::KM3SteppingAction() {
   P1LOW[1] = 0.97777;
   P1HIGH[0] = 3.9298;
   P1HIGH[1] = 0.85567e-01;
+
+  // 0.01 steps in log10(E/GeV) from 100 MeV to 100 PeV
+  RangeLogEMin = -1.0;
+  RangeLogEStep = 0.01;
+  for (G4int i = 0; i <= 900; i++)
+    RangeTable.push_back(
+        MuonRangeFormula(GeV * pow(10.0, RangeLogEMin + i * RangeLogEStep)));
+
+  // about 1 mrad
+  CosTolerance = 1.0 - 5.0e-7;
+  CachedTrackID = -1;
+}
+
+void KM3SteppingAction::UpdateCanCache(const G4Track *aTrack) {
+  CachedTrackID = aTrack->GetTrackID();
+  CachedPosition = aTrack->GetPosition();
+  CachedDirection = aTrack->GetMomentumDirection();
+  CanHit = myStDetector->BoundingVolume->Intersect(
+      CachedPosition, CachedDirection, CanIn, CanOut);
+  SmallCanHit = myStDetector->IntersectCylinder(
+      CachedPosition, CachedDirection,
+      myStDetector->detectorMaxRho - 150.0 * m,
+      myStDetector->bottomPosition + 50.0 * m,
+      myStDetector->detectorMaxz - 150.0 * m, SmallCanIn, SmallCanOut);
 }
 
 void KM3SteppingAction::UserSteppingAction(const G4Step *aStep) {
   G4ThreeVector x0;
   G4ThreeVector p0;
-  G4double distanceRho, direction;
+
+  // light of the delta rays that are not tracked
+  if (myStDetector->DeltaRayLight != NULL)
+    myStDetector->DeltaRayLight->AddStep(aStep);
 
   if (aStep->GetTrack()->GetParentID() == 0) {  // only the primary particle
     if (aStep->GetTrack()->GetDefinition() ==
@@ -68,220 +97,104 @@ void KM3SteppingAction::UserSteppingAction(const G4Step *aStep) {
       }
 
       // here kill muons that have not enough energy to reach the can
-      // first check if it is inside the can
-      G4double RRR2 =
-          myStDetector->detectorMaxRho * myStDetector->detectorMaxRho;
-      G4double rxy2 = x0[0] * x0[0] + x0[1] * x0[1];
-      if ((rxy2 > RRR2) || (x0[2] < myStDetector->bottomPosition) ||
-          (x0[2] >
-           myStDetector->detectorMaxz)) {  // if it is not inside the can
-        G4double Tbottom = (myStDetector->bottomPosition - x0[2]) / p0[2];
-        G4double Xbottom =
-            x0[0] + Tbottom * p0[0] - myStDetector->detectorCenter[0];
-        G4double Ybottom =
-            x0[1] + Tbottom * p0[1] - myStDetector->detectorCenter[1];
-        G4double dRhoBottom = Xbottom * Xbottom + Ybottom * Ybottom;
-        if ((dRhoBottom > RRR2) || (Tbottom < 0)) Tbottom = 1.0e21;
-
-        G4double Ttop = (myStDetector->detectorMaxz - x0[2]) / p0[2];
-        G4double Xtop = x0[0] + Ttop * p0[0] - myStDetector->detectorCenter[0];
-        G4double Ytop = x0[1] + Ttop * p0[1] - myStDetector->detectorCenter[1];
-        G4double dRhoTop = Xtop * Xtop + Ytop * Ytop;
-        if ((dRhoTop > RRR2) || (Ttop < 0)) Ttop = 1.0e21;
-
-        G4double a = p0[0] * p0[0] + p0[1] * p0[1];
-        G4double b = x0[0] * p0[0] + x0[1] * p0[1];
-        G4double c = x0[0] * x0[0] + x0[1] * x0[1] - RRR2;
-        G4double dia = b * b - a * c;
-        G4double SideDistIn = 1.0e21;
-        if (dia > 0) {
-          dia = sqrt(dia);
-          G4double SideDistIn1 = (-b - dia) / a;
-          G4double SideDistIn2 = (-b + dia) / a;
-          G4double sidezIn1 = x0[2] + SideDistIn1 * p0[2];
-          G4double sidezIn2 = x0[2] + SideDistIn2 * p0[2];
-          if (SideDistIn1 > 0 && sidezIn1 > myStDetector->bottomPosition &&
-              sidezIn1 < myStDetector->detectorMaxz)
-            SideDistIn = SideDistIn1;
-          if (SideDistIn2 > 0 && sidezIn2 > myStDetector->bottomPosition &&
-              sidezIn2 < myStDetector->detectorMaxz && SideDistIn2 < SideDistIn)
-            SideDistIn = SideDistIn2;
-        }
-        G4double TMin = 1.0e30;
-        if (TMin > Tbottom) TMin = Tbottom;
-        if (TMin > Ttop) TMin = Ttop;
-        if (TMin > SideDistIn) TMin = SideDistIn;
-
-        if (TMin < 1.0e20) {
-          if (TMin > MuonRange(aStep->GetTrack()->GetKineticEnergy())) {
-            aStep->GetTrack()->SetTrackStatus(fStopAndKill);
-            return;
-          }
-        } else {
+      // or that are leaving it. The crossings are cached per track, so
+      // per step only the distance travelled along the cached direction
+      // is needed
+      if ((aStep->GetTrack()->GetCurrentStepNumber() == 1) ||
+          (aStep->GetTrack()->GetTrackID() != CachedTrackID) ||
+          (p0.dot(CachedDirection) < CosTolerance))
+        UpdateCanCache(aStep->GetTrack());
+      G4double Travelled = (x0 - CachedPosition).dot(CachedDirection);
+
+      if (!CanHit) {
+        aStep->GetTrack()->SetTrackStatus(fStopAndKill);
+        return;
+      }
+      if (Travelled < CanIn) {  // if it is not inside the can yet
+        if (CanIn - Travelled >
+            MuonRange(aStep->GetTrack()->GetKineticEnergy())) {
           aStep->GetTrack()->SetTrackStatus(fStopAndKill);
           return;
         }
-      }  // if not inside detector
+      }
 
       // new here we report the points when the muon goes in the
       // detector (smaller can by 50 meters on the bottom and 150m on
       // top and sides)
       // first be sure that this muon is registered in Event Action
       G4int MuonSlot = event_action->GetSlot(aStep->GetTrack()->GetTrackID());
-      if (MuonSlot >= 0) {
-        G4double SideRadiusSmallCan = myStDetector->detectorMaxRho - 150.0 * m;
-        G4double TopPosSmallCan = myStDetector->detectorMaxz - 150.0 * m;
-        G4double BottomPosSmallCan = myStDetector->bottomPosition + 50.0 * m;
-        RRR2 = SideRadiusSmallCan * SideRadiusSmallCan;
+      if ((MuonSlot >= 0) && SmallCanHit) {
+        G4double DistToEnter = SmallCanIn - Travelled;
+        G4double DistToLeave = SmallCanOut - Travelled;
+        G4double DistToCenter = 0.5 * (DistToEnter + DistToLeave);
 
-        G4double DistToTop = (TopPosSmallCan - x0[2]) / p0[2];
-        G4double DistToBottom = (BottomPosSmallCan - x0[2]) / p0[2];
-        G4ThreeVector PointOnTop = x0 + DistToTop * p0;
-        G4ThreeVector PointOnBottom = x0 + DistToBottom * p0;
-        G4double HorDistTop2 =
-            PointOnTop[0] * PointOnTop[0] + PointOnTop[1] * PointOnTop[1];
-        G4double HorDistBottom2 = PointOnBottom[0] * PointOnBottom[0] +
-            PointOnBottom[1] * PointOnBottom[1];
-
-        G4bool conti = true;
-        if ((HorDistTop2 > RRR2) || (HorDistBottom2 > RRR2)) {
-          G4double a = p0[0] * p0[0] + p0[1] * p0[1];
-          G4double b = x0[0] * p0[0] + x0[1] * p0[1];
-          G4double c = x0[0] * x0[0] + x0[1] * x0[1] - RRR2;
-          G4double dia = b * b - a * c;
-          if (dia < 0) {
-            conti = false;
-          } else {
-            dia = sqrt(dia);
-            G4double SideDist1 = (-b - dia) / a;
-            G4double SideDist2 = (-b + dia) / a;
-            G4double sidez1 = x0[2] + SideDist1 * p0[2];
-            G4double sidez2 = x0[2] + SideDist2 * p0[2];
-            if (((sidez1 < PointOnBottom[2]) && (sidez2 < PointOnBottom[2])) ||
-                ((sidez1 > PointOnTop[2]) && (sidez2 > PointOnTop[2]))) {
-              conti = false;
-            } else if (((sidez1 > PointOnBottom[2]) &&
-                        (sidez2 > PointOnBottom[2])) &&
-                       ((sidez1 < PointOnTop[2]) && (sidez2 < PointOnTop[2]))) {
-              if (sidez1 < sidez2) {
-                DistToTop = SideDist2;
-                PointOnTop = x0 + DistToTop * p0;
-                DistToBottom = SideDist1;
-                PointOnBottom = x0 + DistToBottom * p0;
-              } else {
-                DistToTop = SideDist1;
-                PointOnTop = x0 + DistToTop * p0;
-                DistToBottom = SideDist2;
-                PointOnBottom = x0 + DistToBottom * p0;
-              }
-            } else if ((PointOnBottom[2] < sidez1) &&
-                       (sidez1 < PointOnTop[2])) {
-              if (HorDistTop2 > RRR2) {
-                DistToTop = SideDist1;
-                PointOnTop = x0 + DistToTop * p0;
-              } else {
-                DistToBottom = SideDist1;
-                PointOnBottom = x0 + DistToBottom * p0;
-              }
-
-            } else {
-              if (HorDistTop2 > RRR2) {
-                DistToTop = SideDist2;
-                PointOnTop = x0 + DistToTop * p0;
-              } else {
-                DistToBottom = SideDist2;
-                PointOnBottom = x0 + DistToBottom * p0;
-              }
-            }
-          }
+        if ((DistToCenter < -20.0 * m) && (DistToCenter > -30.0 * m)) {
+          event_action->centerPost[MuonSlot] = x0;
+        }
+        if ((DistToCenter < 30.0 * m) && (DistToCenter > 20.0 * m)) {
+          event_action->centerPre[MuonSlot] = x0;
+        }
+        if ((DistToCenter < 5.0 * m) && (DistToCenter > -5.0 * m)) {
+          event_action->centerMomentum[MuonSlot] =
+              aStep->GetTrack()->GetMomentum().mag();
+          event_action->centerPosition[MuonSlot] = x0;
+          event_action->centerTime[MuonSlot] =
+              aStep->GetTrack()->GetGlobalTime();
         }
 
-        if (conti) {
-          G4ThreeVector PointOnMiddle = 0.5 * (PointOnTop + PointOnBottom);
-          // before G4ThreeVector PointOnMiddle = PointOnTop -
-          // (PointOnTop.dot(PointOnBottom-PointOnTop)/(PointOnBottom-PointOnTop).mag2())*(PointOnBottom-PointOnTop);
-          G4double DistToEnter, DistToCenter, DistToLeave;
-          DistToCenter = (PointOnMiddle[2] - x0[2]) / p0[2];
-          if (p0[2] < 0) {
-            DistToEnter = DistToTop;
-            DistToLeave = DistToBottom;
-          } else {
-            DistToEnter = DistToBottom;
-            DistToLeave = DistToTop;
-          }
-
-          if ((DistToCenter < -20.0 * m) && (DistToCenter > -30.0 * m)) {
-            event_action->centerPost[MuonSlot] = x0;
-          }
-          if ((DistToCenter < 30.0 * m) && (DistToCenter > 20.0 * m)) {
-            event_action->centerPre[MuonSlot] = x0;
-          }
-          if ((DistToCenter < 5.0 * m) && (DistToCenter > -5.0 * m)) {
-            event_action->centerMomentum[MuonSlot] =
-                aStep->GetTrack()->GetMomentum().mag();
-            event_action->centerPosition[MuonSlot] = x0;
-            event_action->centerTime[MuonSlot] =
-                aStep->GetTrack()->GetGlobalTime();
-          }
-
-          if ((DistToEnter < -20.0 * m) && (DistToEnter > -30.0 * m)) {
-            event_action->enterPost[MuonSlot] = x0;
-          }
-          if ((DistToEnter < 30.0 * m) && (DistToEnter > 20.0 * m)) {
-            event_action->enterPre[MuonSlot] = x0;
-          }
-          if ((DistToEnter < 5.0 * m) && (DistToEnter > -5.0 * m)) {
-            event_action->enterMomentum[MuonSlot] =
-                aStep->GetTrack()->GetMomentum().mag();
-            event_action->enterPosition[MuonSlot] = x0;
-            event_action->enterTime[MuonSlot] =
-                aStep->GetTrack()->GetGlobalTime();
-          }
+        if ((DistToEnter < -20.0 * m) && (DistToEnter > -30.0 * m)) {
+          event_action->enterPost[MuonSlot] = x0;
+        }
+        if ((DistToEnter < 30.0 * m) && (DistToEnter > 20.0 * m)) {
+          event_action->enterPre[MuonSlot] = x0;
+        }
+        if ((DistToEnter < 5.0 * m) && (DistToEnter > -5.0 * m)) {
+          event_action->enterMomentum[MuonSlot] =
+              aStep->GetTrack()->GetMomentum().mag();
+          event_action->enterPosition[MuonSlot] = x0;
+          event_action->enterTime[MuonSlot] =
+              aStep->GetTrack()->GetGlobalTime();
+        }
 
-          if ((DistToLeave < -20.0 * m) && (DistToLeave > -30.0 * m)) {
-            event_action->leavePost[MuonSlot] = x0;
-          }
-          if ((DistToLeave < 30.0 * m) && (DistToLeave > 20.0 * m)) {
-            event_action->leavePre[MuonSlot] = x0;
-          }
-          if ((DistToLeave < 5.0 * m) && (DistToLeave > -5.0 * m)) {
-            event_action->leaveMomentum[MuonSlot] =
-                aStep->GetTrack()->GetMomentum().mag();
-            event_action->leavePosition[MuonSlot] = x0;
-            event_action->leaveTime[MuonSlot] =
-                aStep->GetTrack()->GetGlobalTime();
-          }
+        if ((DistToLeave < -20.0 * m) && (DistToLeave > -30.0 * m)) {
+          event_action->leavePost[MuonSlot] = x0;
+        }
+        if ((DistToLeave < 30.0 * m) && (DistToLeave > 20.0 * m)) {
+          event_action->leavePre[MuonSlot] = x0;
+        }
+        if ((DistToLeave < 5.0 * m) && (DistToLeave > -5.0 * m)) {
+          event_action->leaveMomentum[MuonSlot] =
+              aStep->GetTrack()->GetMomentum().mag();
+          event_action->leavePosition[MuonSlot] = x0;
+          event_action->leaveTime[MuonSlot] =
+              aStep->GetTrack()->GetGlobalTime();
         }
       }
 
       // here kill only muons that are leaving the can. All other
       // particles are already killed if outside the can
-      G4ThreeVector distanceV;
-      distanceV = x0 - myStDetector->detectorCenter;
-      if ((x0[2] < myStDetector->bottomPosition) &&
-          (p0[2] < 0)) {  // goes down while below the can
-        aStep->GetTrack()->SetTrackStatus(fStopAndKill);
-        return;
-      }
-      if ((x0[2] > myStDetector->detectorMaxz) &&
-          (p0[2] > 0)) {  // goes up while above the can
-        aStep->GetTrack()->SetTrackStatus(fStopAndKill);
-        return;
-      }
-      direction = p0[0] * distanceV[0] + p0[1] * distanceV[1];
-      distanceRho =
-          sqrt(distanceV[0] * distanceV[0] + distanceV[1] * distanceV[1]);
-      if ((distanceRho > myStDetector->detectorMaxRho) &&
-          (direction > 0)) {  // goes away while outside the can
+      if (Travelled > CanOut) {
         aStep->GetTrack()->SetTrackStatus(fStopAndKill);
         return;
       }
 
+      // the Cherenkov light of the muon from the tables
+      if (myStDetector->MuonLight != NULL)
+        myStDetector->MuonLight->AddStep(aStep);
+
     }  // if muon
   }    // if initial particle
 }
 
 G4double KM3SteppingAction::MuonRange(G4double KineticEnergy) {
+  G4double x = (log10(KineticEnergy / GeV) - RangeLogEMin) / RangeLogEStep;
+  if (!(x >= 0.0) || (x >= RangeTable.size() - 1))
+    return MuonRangeFormula(KineticEnergy);
+  G4int i = (G4int)x;
+  return RangeTable[i] + (x - i) * (RangeTable[i + 1] - RangeTable[i]);
+}
+
+G4double KM3SteppingAction::MuonRangeFormula(G4double KineticEnergy) {
   G4double ENERGYLOG = log10(KineticEnergy / GeV);
   G4double RANGELOG;
   if (ENERGYLOG < 1.0) {
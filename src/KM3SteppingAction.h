@@ -7,6 +7,7 @@
 
 #include <CLHEP/Units/SystemOfUnits.h>
 #include <CLHEP/Units/PhysicalConstants.h>
+#include <vector>
 
 class KM3SteppingAction : public G4UserSteppingAction {
  public:
@@ -18,9 +19,31 @@ class KM3SteppingAction : public G4UserSteppingAction {
 
  private:
   G4double MuonRange(G4double);
+  G4double MuonRangeFormula(G4double);
   G4double P7[8];
   G4double P1LOW[2];
   G4double P1HIGH[2];
+
+  // muon range tabulated in log10(E/GeV)
+  std::vector<G4double> RangeTable;
+  G4double RangeLogEMin;
+  G4double RangeLogEStep;
+
+  // can crossings of the current primary muon. They are path lengths
+  // along CachedDirection from CachedPosition and are recomputed only
+  // when a new muon starts or its direction changes more than
+  // CosTolerance allows
+  void UpdateCanCache(const G4Track *);
+  G4int CachedTrackID;
+  G4ThreeVector CachedPosition;
+  G4ThreeVector CachedDirection;
+  G4double CosTolerance;
+  G4bool CanHit;
+  G4double CanIn;
+  G4double CanOut;
+  G4bool SmallCanHit;
+  G4double SmallCanIn;
+  G4double SmallCanOut;
 };
 
 #endif
@@ -0,0 +1,525 @@
+#include "KM3TableBuilder.h"
+#include "KM3Cathods.h"
+#include "KM3EMTimePointDis.h"
+#include "KM3MappedFile.h"
+#include "KM3OMSampler.h"
+#include "G4ios.hh"
+
+#include <map>
+#include <thread>
+#include <algorithm>
+#include <string.h>
+#include <stdint.h>
+
+using CLHEP::GeV;
+using CLHEP::degree;
+using CLHEP::meter;
+using CLHEP::ns;
+using CLHEP::pi;
+
+namespace {
+// the binning of the samplers
+const G4int DirectionBins = KM3EMTimePointDis::NumberOfDirectionBins;
+const G4int TimeSolidAngleBins = KM3EMTimePointDis::NumberOfTimeSolidAngleBins;
+const G4int TimeBins = KM3EMTimePointDis::NumberOfTimeBins;
+// floats of one KM3EMTimePointDis in the table
+const G4int CellSize = 3 + 3 * DirectionBins + TimeSolidAngleBins * TimeBins;
+const uint32_t PartialVersion = 1;
+
+template <class T>
+void WriteValue(std::ofstream &outfile, const T &value) {
+  outfile.write((const char *)&value, sizeof(T));
+}
+
+template <class T>
+void ReadValue(std::ifstream &infile, T &value) {
+  infile.read((char *)&value, sizeof(T));
+}
+
+// the HEP code and mass (GeV) of the particles that can be injected
+struct InjectedParticle {
+  G4int PDG;
+  G4int HEP;
+  G4double Mass;
+};
+
+const InjectedParticle InjectedParticles[] = {
+    {22, 1, 0.0},           {-11, 2, 0.000511},   {11, 3, 0.000511},
+    {211, 8, 0.13957},      {-211, 9, 0.13957},   {130, 10, 0.497614},
+    {321, 11, 0.493677},    {-321, 12, 0.493677}, {2112, 13, 0.939565},
+    {2212, 14, 0.938272},   {-2212, 15, 0.938272}, {-2112, 25, 0.939565}};
+
+const InjectedParticle *FindInjectedParticle(G4int PDG) {
+  for (size_t i = 0;
+       i < sizeof(InjectedParticles) / sizeof(InjectedParticles[0]); i++)
+    if (InjectedParticles[i].PDG == PDG) return &InjectedParticles[i];
+  return NULL;
+}
+
+// slope of the exponential density on [0,width] with this mean, the
+// inverse of the mean w(1-1/u+1/(exp(u)-1)) with u=slope*width
+G4double ExponentialSlope(G4double mean, G4double width) {
+  G4double target = mean / width;
+  G4double ulow = -50.0;
+  G4double uhigh = 50.0;
+  for (G4int i = 0; i < 60; i++) {
+    G4double u = 0.5 * (ulow + uhigh);
+    G4double f;
+    if (fabs(u) < 1.0e-4)
+      f = 0.5 + u / 12.0;
+    else
+      f = 1.0 - 1.0 / u + 1.0 / (exp(u) - 1.0);
+    if (f < target)
+      ulow = u;
+    else
+      uhigh = u;
+  }
+  return 0.5 * (ulow + uhigh) / width;
+}
+}
+
+KM3TableBuilder::KM3TableBuilder() {
+  Particle = 11;
+  Energy = 100.0 * GeV;
+  NumberOfOrientations = 20;
+  DistanceMin = 1.0 * meter;
+  DistanceMax = 300.0 * meter;
+  allCathods = NULL;
+  MaxQE = 0.0;
+  SpeedAtMaxQE = 0.0;
+  TotCathodArea = 0.0;
+  NumberOfEvents = 0;
+  EventPrepared = false;
+}
+
+KM3TableBuilder::~KM3TableBuilder() {
+  for (size_t i = 0; i < Cells.size(); i++) delete Cells[i];
+}
+
+void KM3TableBuilder::MakeGrid() {
+  Distances.clear();
+  for (G4int i = 0; i < NumberOfDistances; i++)
+    Distances.push_back(DistanceMin *
+                        pow(DistanceMax / DistanceMin,
+                            G4double(i) / (NumberOfDistances - 1)));
+  Angles.clear();
+  for (G4int i = 0; i < NumberOfAngles; i++)
+    Angles.push_back(-1.0 + 2.0 * i / (NumberOfAngles - 1));
+  Cells.assign(NumberOfDistances * NumberOfAngles, NULL);
+
+  // spread evenly on the sphere (Fibonacci lattice)
+  Orientations.clear();
+  G4double golden = pi * (3.0 - sqrt(5.0));
+  for (G4int i = 0; i < NumberOfOrientations; i++) {
+    G4double z = 1.0 - (2.0 * i + 1.0) / NumberOfOrientations;
+    G4double r = sqrt(1.0 - z * z);
+    Orientations.push_back(
+        G4ThreeVector(r * cos(golden * i), r * sin(golden * i), z));
+  }
+}
+
+void KM3TableBuilder::WriteInjectionFile(const std::string &evtFile,
+                                         G4int nevents) {
+  const InjectedParticle *injected = FindInjectedParticle(Particle);
+  if (injected == NULL)
+    G4Exception("Particle cannot be injected to build tables", "",
+                FatalException, "");
+  MakeGrid();
+
+  FILE *outfile = fopen(evtFile.c_str(), "w");
+  if (outfile == NULL)
+    G4Exception("Error opening table builder injection file", "",
+                FatalException, "");
+  fprintf(outfile, "start_run: 1\nend_event:\n");
+  G4double totenergy = Energy / GeV + injected->Mass;
+  for (G4int ievt = 0; ievt < nevents; ievt++) {
+    const G4ThreeVector &p0 = Orientations[ievt % Orientations.size()];
+    fprintf(outfile, "start_event: %d 1\n", ievt + 1);
+    fprintf(outfile, "track_in: 1 %.6f %.6f %.6f %.9f %.9f %.9f %.9e 0 %d %d\n",
+            Vertex[0] / meter, Vertex[1] / meter, Vertex[2] / meter, p0[0],
+            p0[1], p0[2], totenergy, injected->HEP, injected->PDG);
+    fprintf(outfile, "end_event:\n");
+  }
+  fclose(outfile);
+}
+
+void KM3TableBuilder::Initialize(KM3Cathods *aCathods, G4double aMaxQE,
+                                 G4double aSpeedAtMaxQE,
+                                 G4double aTotCathodArea) {
+  allCathods = aCathods;
+  MaxQE = aMaxQE;
+  SpeedAtMaxQE = aSpeedAtMaxQE;
+  TotCathodArea = aTotCathodArea;
+  if (Orientations.empty()) MakeGrid();
+
+  CathodOM.assign(allCathods->GetNumberOfCathods(), -1);
+  OMs.resize(allCathods->GetNumberOfOMs());
+  for (G4int iom = 0; iom < allCathods->GetNumberOfOMs(); iom++) {
+    const OpticalModule &anOM = allCathods->GetOM(iom);
+    for (size_t ic = 0; ic < anOM.CathodIds.size(); ic++)
+      CathodOM[anOM.CathodIds[ic]] = iom;
+    OMs[iom].Sum = 0.0;
+  }
+}
+
+KM3TableCell *KM3TableBuilder::GetCell(G4int icell) {
+  if (Cells[icell] == NULL) {
+    KM3TableCell *aCell = new KM3TableCell;
+    aCell->Exposures = 0.0;
+    aCell->Sum = 0.0;
+    aCell->Sum2 = 0.0;
+    aCell->Direction.assign(3 * DirectionBins, 0.0);
+    aCell->Time.assign(TimeSolidAngleBins * TimeBins, 0.0);
+    Cells[icell] = aCell;
+  }
+  return Cells[icell];
+}
+
+// the (distance, angle) cell of every OM for the orientation of this event.
+// An OM goes to the nearest grid point and its photons are scaled to the
+// flux at the distance of the grid point (d^2 F is what the samplers
+// interpolate)
+void KM3TableBuilder::PrepareEvent() {
+  const G4ThreeVector &p0 = Orientations[NumberOfEvents % Orientations.size()];
+  G4double logStep = log(DistanceMax / DistanceMin) / (NumberOfDistances - 1);
+  for (G4int iom = 0; iom < allCathods->GetNumberOfOMs(); iom++) {
+    OMGeometry &aGeometry = OMs[iom];
+    aGeometry.Cell = -1;
+    G4ThreeVector FromGeneToOM = allCathods->GetOM(iom).Position - Vertex;
+    G4double distance = FromGeneToOM.mag();
+    if (distance <= 0.0) continue;
+    G4int idist = G4int(floor(log(distance / DistanceMin) / logStep + 0.5));
+    if ((idist < 0) || (idist > NumberOfDistances - 1)) continue;
+    FromGeneToOM /= distance;
+    G4double angle = p0.dot(FromGeneToOM);
+    G4int iang = G4int(floor((angle + 1.0) * 0.5 * (NumberOfAngles - 1) + 0.5));
+    aGeometry.Cell = idist * NumberOfAngles + iang;
+    aGeometry.Scale =
+        (distance / Distances[idist]) * (distance / Distances[idist]);
+    aGeometry.DirectTime = distance / SpeedAtMaxQE;
+    // the frame the samplers emit in
+    KM3OMSampler::GetFrame(p0, FromGeneToOM, aGeometry.X, aGeometry.Y);
+    aGeometry.Z = FromGeneToOM;
+  }
+  EventPrepared = true;
+}
+
+void KM3TableBuilder::AddPhoton(G4int cathodId, G4double time,
+                                const G4ThreeVector &direction) {
+  if (!EventPrepared) PrepareEvent();
+  G4int iom = CathodOM[cathodId];
+  if (iom < 0) return;
+  OMGeometry &aGeometry = OMs[iom];
+  if (aGeometry.Cell < 0) return;
+
+  // undo the acceptance of the cylindrical cathod (see KM3PMTResponse)
+  // to get the photons per cathod area
+  G4double cosangle = direction.dot(allCathods->GetDirection(cathodId));
+  G4double AngularAccSim =
+      fabs(cosangle) + (2.0 * allCathods->GetCathodHeight(cathodId) /
+                        (pi * allCathods->GetCathodRadius(cathodId))) *
+                           sqrt(1 - cosangle * cosangle);
+  if (AngularAccSim <= 0.0) return;
+  G4double weight = aGeometry.Scale / AngularAccSim;
+
+  G4double costh = direction.dot(aGeometry.Z);
+  costh = std::max(-1.0, std::min(1.0, costh));
+  G4double theta = acos(costh) / degree;
+  G4double phi =
+      fabs(atan2(direction.dot(aGeometry.Y), direction.dot(aGeometry.X))) /
+      degree;
+
+  KM3TableCell *aCell = GetCell(aGeometry.Cell);
+  G4int idir = KM3EMTimePointDis::FindDirectionBin(theta, phi);
+  G4double thetaLow, thetaHigh, phiLow, phiHigh;
+  KM3EMTimePointDis::GetDirectionBinLimits(idir, thetaLow, thetaHigh, phiLow,
+                                           phiHigh);
+  aCell->Direction[3 * idir] += weight;
+  aCell->Direction[3 * idir + 1] += weight * (theta - thetaLow);
+  aCell->Direction[3 * idir + 2] += weight * (phi - phiLow);
+  G4int isa = KM3EMTimePointDis::FindTimeSolidAngleBin(theta, phi);
+  G4int it = KM3EMTimePointDis::FindTimeBin((time - aGeometry.DirectTime) / ns);
+  aCell->Time[isa * TimeBins + it] += weight;
+  aGeometry.Sum += weight;
+}
+
+void KM3TableBuilder::EndOfEvent() {
+  if (!EventPrepared) PrepareEvent();
+  for (size_t iom = 0; iom < OMs.size(); iom++) {
+    OMGeometry &aGeometry = OMs[iom];
+    if (aGeometry.Cell < 0) continue;
+    KM3TableCell *aCell = GetCell(aGeometry.Cell);
+    aCell->Exposures += 1.0;
+    aCell->Sum += aGeometry.Sum;
+    aCell->Sum2 += aGeometry.Sum * aGeometry.Sum;
+    aGeometry.Sum = 0.0;
+  }
+  NumberOfEvents++;
+  EventPrepared = false;
+}
+
+void KM3TableBuilder::Save(const std::string &aFile) const {
+  std::ofstream outfile(aFile.c_str(), std::ios::out | std::ios::binary);
+  outfile.write("KM3PART", 8);
+  WriteValue(outfile, PartialVersion);
+  WriteValue(outfile, (int32_t)Particle);
+  WriteValue(outfile, Energy / GeV);
+  WriteValue(outfile, MaxQE);
+  WriteValue(outfile, TotCathodArea);
+  WriteValue(outfile, (uint32_t)NumberOfEvents);
+  WriteValue(outfile, (uint32_t)NumberOfDistances);
+  WriteValue(outfile, (uint32_t)NumberOfAngles);
+  for (G4int i = 0; i < NumberOfDistances; i++)
+    WriteValue(outfile, Distances[i] / meter);
+  uint32_t ncells = 0;
+  for (size_t i = 0; i < Cells.size(); i++)
+    if (Cells[i] != NULL) ncells++;
+  WriteValue(outfile, ncells);
+  for (size_t i = 0; i < Cells.size(); i++) {
+    if (Cells[i] == NULL) continue;
+    WriteValue(outfile, (uint32_t)i);
+    WriteValue(outfile, Cells[i]->Exposures);
+    WriteValue(outfile, Cells[i]->Sum);
+    WriteValue(outfile, Cells[i]->Sum2);
+    outfile.write((const char *)&Cells[i]->Direction[0],
+                  Cells[i]->Direction.size() * sizeof(G4double));
+    outfile.write((const char *)&Cells[i]->Time[0],
+                  Cells[i]->Time.size() * sizeof(G4double));
+  }
+  outfile.close();
+  if (!outfile.good())
+    G4Exception("Error writing partial parametrization table", "",
+                FatalException, "");
+  G4cout << "Saved the histograms of " << NumberOfEvents << " events to "
+         << aFile << G4endl;
+}
+
+// adds a partial file to the histograms. The first one read sets the
+// particle, energy and grid, the others must have the same
+void KM3TableBuilder::Read(std::ifstream &infile, const std::string &aFile) {
+  uint32_t version, nevents, ndist, nang, ncells;
+  int32_t particle;
+  G4double energy, qe, area;
+  ReadValue(infile, version);
+  ReadValue(infile, particle);
+  ReadValue(infile, energy);
+  ReadValue(infile, qe);
+  ReadValue(infile, area);
+  ReadValue(infile, nevents);
+  ReadValue(infile, ndist);
+  ReadValue(infile, nang);
+  if ((version != PartialVersion) ||
+      (ndist != (uint32_t)NumberOfDistances) ||
+      (nang != (uint32_t)NumberOfAngles))
+    G4Exception("Partial parametrization table of another version", "",
+                FatalException, "");
+  std::vector<G4double> distances(ndist);
+  for (uint32_t i = 0; i < ndist; i++) {
+    ReadValue(infile, distances[i]);
+    distances[i] *= meter;
+  }
+
+  if (Distances.empty()) {
+    Particle = particle;
+    Energy = energy * GeV;
+    MaxQE = qe;
+    TotCathodArea = area;
+    Distances = distances;
+    for (G4int i = 0; i < NumberOfAngles; i++)
+      Angles.push_back(-1.0 + 2.0 * i / (NumberOfAngles - 1));
+    Cells.assign(NumberOfDistances * NumberOfAngles, NULL);
+  } else {
+    if ((particle != Particle) ||
+        (fabs(energy * GeV - Energy) > 1.0e-6 * Energy))
+      G4Exception("Partial parametrization tables of different particles", "",
+                  FatalException, "");
+    if ((fabs(qe - MaxQE) > 1.0e-6 * MaxQE) ||
+        (fabs(area - TotCathodArea) > 1.0e-6 * TotCathodArea))
+      G4Exception("Partial parametrization tables of different detectors", "",
+                  FatalException, "");
+    for (uint32_t i = 0; i < ndist; i++)
+      if (fabs(distances[i] - Distances[i]) > 1.0e-6 * Distances[i])
+        G4Exception("Partial parametrization tables of different distances",
+                    "", FatalException, "");
+  }
+  NumberOfEvents += nevents;
+
+  ReadValue(infile, ncells);
+  std::vector<G4double> buffer(3 * DirectionBins +
+                               TimeSolidAngleBins * TimeBins);
+  for (uint32_t ic = 0; ic < ncells; ic++) {
+    uint32_t icell;
+    G4double exposures, sum, sum2;
+    ReadValue(infile, icell);
+    ReadValue(infile, exposures);
+    ReadValue(infile, sum);
+    ReadValue(infile, sum2);
+    infile.read((char *)&buffer[0], buffer.size() * sizeof(G4double));
+    if (!infile.good() || (icell >= Cells.size()))
+      G4Exception("Partial parametrization table is truncated", "",
+                  FatalException, "");
+    KM3TableCell *aCell = GetCell(icell);
+    aCell->Exposures += exposures;
+    aCell->Sum += sum;
+    aCell->Sum2 += sum2;
+    for (G4int i = 0; i < 3 * DirectionBins; i++)
+      aCell->Direction[i] += buffer[i];
+    for (G4int i = 0; i < TimeSolidAngleBins * TimeBins; i++)
+      aCell->Time[i] += buffer[3 * DirectionBins + i];
+  }
+  G4cout << "Read " << nevents << " events of particle " << Particle
+         << " at " << energy << " GeV from " << aFile << G4endl;
+}
+
+// one KM3EMTimePointDis of the table. A cell without photons is written
+// as a null distribution, which the samplers skip
+void KM3TableBuilder::FinalizeCell(G4int icell, G4float *out) const {
+  memset(out, 0, CellSize * sizeof(G4float));
+  out[0] = Angles[icell % NumberOfAngles];
+  const KM3TableCell *aCell = Cells[icell];
+  if ((aCell == NULL) || (aCell->Exposures <= 0.0) || (aCell->Sum <= 0.0))
+    return;
+
+  G4double norm = MaxQE * TotCathodArea;
+  G4double mean = aCell->Sum / aCell->Exposures;
+  G4double variance = aCell->Sum2 / aCell->Exposures - mean * mean;
+  out[1] = mean / norm;
+  out[2] = sqrt(std::max(variance, 0.0)) / norm;
+
+  // cumulative of the directions and the slopes inside every bin
+  G4float *direction = out + 3;
+  G4double total = 0.0;
+  for (G4int i = 0; i < DirectionBins; i++)
+    total += aCell->Direction[3 * i];
+  G4double cumulative = 0.0;
+  for (G4int i = 0; i < DirectionBins; i++) {
+    G4double weight = aCell->Direction[3 * i];
+    cumulative += weight;
+    direction[3 * i] = cumulative / total;
+    if (weight <= 0.0) continue;
+    G4double thetaLow, thetaHigh, phiLow, phiHigh;
+    KM3EMTimePointDis::GetDirectionBinLimits(i, thetaLow, thetaHigh, phiLow,
+                                             phiHigh);
+    direction[3 * i + 1] = ExponentialSlope(
+        aCell->Direction[3 * i + 1] / weight, thetaHigh - thetaLow);
+    direction[3 * i + 2] =
+        ExponentialSlope(aCell->Direction[3 * i + 2] / weight, phiHigh - phiLow);
+  }
+  direction[3 * (DirectionBins - 1)] = 1.0;
+
+  // cumulatives of the times. A solid angle bin without photons gets the
+  // times of the whole cell
+  G4float *times = direction + 3 * DirectionBins;
+  std::vector<G4double> all(TimeBins, 0.0);
+  G4double allTotal = 0.0;
+  for (G4int isa = 0; isa < TimeSolidAngleBins; isa++)
+    for (G4int it = 0; it < TimeBins; it++) {
+      all[it] += aCell->Time[isa * TimeBins + it];
+      allTotal += aCell->Time[isa * TimeBins + it];
+    }
+  for (G4int isa = 0; isa < TimeSolidAngleBins; isa++) {
+    const G4double *row = &aCell->Time[isa * TimeBins];
+    G4double rowTotal = 0.0;
+    for (G4int it = 0; it < TimeBins; it++) rowTotal += row[it];
+    if (rowTotal <= 0.0) {
+      row = &all[0];
+      rowTotal = allTotal;
+    }
+    cumulative = 0.0;
+    for (G4int it = 0; it < TimeBins; it++) {
+      cumulative += row[it];
+      times[isa * TimeBins + it] = cumulative / rowTotal;
+    }
+    times[isa * TimeBins + TimeBins - 1] = 1.0;
+  }
+}
+
+// the energy block of the table. The cells are independent, so they are
+// shared between the threads
+void KM3TableBuilder::Finalize(G4float *block, G4int threads) const {
+  G4int DistanceSize = 1 + NumberOfAngles * CellSize;
+  block[0] = Energy / GeV;
+  for (G4int idist = 0; idist < NumberOfDistances; idist++)
+    block[1 + idist * DistanceSize] = Distances[idist] / meter;
+
+  G4int ncells = NumberOfDistances * NumberOfAngles;
+  std::vector<std::thread> workers;
+  for (G4int ith = 0; ith < threads; ith++)
+    workers.push_back(std::thread([this, block, ith, threads, ncells,
+                                   DistanceSize]() {
+      for (G4int icell = ith; icell < ncells; icell += threads) {
+        G4int idist = icell / NumberOfAngles;
+        G4int iang = icell % NumberOfAngles;
+        FinalizeCell(icell, block + 1 + idist * DistanceSize + 1 +
+                                iang * CellSize);
+      }
+    }));
+  for (size_t ith = 0; ith < workers.size(); ith++) workers[ith].join();
+}
+
+// the partials are summed per particle and energy. The blocks are written
+// in increasing energy, the particles in the order they first appear
+// (for the hadronic tables, the pi+ partials before the K0L ones)
+void KM3TableBuilder::Merge(const std::vector<std::string> &partials,
+                            const std::string &TableOut, G4int threads) {
+  if (threads <= 0) threads = std::thread::hardware_concurrency();
+  if (threads <= 0) threads = 1;
+
+  std::vector<G4int> particles;
+  std::map<std::pair<G4int, G4double>, KM3TableBuilder *> builders;
+  for (size_t ip = 0; ip < partials.size(); ip++) {
+    std::ifstream infile(partials[ip].c_str(),
+                         std::ios::in | std::ios::binary);
+    char magic[8];
+    infile.read(magic, 8);
+    if (!infile.good() || (strncmp(magic, "KM3PART", 8) != 0))
+      G4Exception("Not a partial parametrization table", "", FatalException,
+                  "");
+    // peek the particle and energy to find the histograms to add to
+    std::streampos start = infile.tellg();
+    uint32_t version;
+    int32_t particle;
+    G4double energy;
+    ReadValue(infile, version);
+    ReadValue(infile, particle);
+    ReadValue(infile, energy);
+    infile.seekg(start);
+    if (!infile.good() || (version != PartialVersion) || !(energy > 0.0))
+      G4Exception("Partial parametrization table of another version", "",
+                  FatalException, "");
+    if (FindInjectedParticle(particle) == NULL)
+      G4Exception("Partial parametrization table of an unknown particle", "",
+                  FatalException, "");
+
+    if (std::find(particles.begin(), particles.end(), particle) ==
+        particles.end())
+      particles.push_back(particle);
+    KM3TableBuilder *&aBuilder = builders[std::make_pair(particle, energy)];
+    if (aBuilder == NULL) aBuilder = new KM3TableBuilder;
+    aBuilder->Read(infile, partials[ip]);
+  }
+
+  std::vector<uint32_t> types;
+  for (size_t ib = 0; ib < builders.size(); ib++)
+    types.push_back(KM3MappedFile::kEnergyBlock);
+  std::ofstream outfile(TableOut.c_str(), std::ios::out | std::ios::binary);
+  KM3MappedFile::WriteHeader(outfile, types);
+  std::vector<G4float> block(KM3MappedFile::EnergyBlockSize /
+                             sizeof(G4float));
+  for (size_t ip = 0; ip < particles.size(); ip++) {
+    std::map<std::pair<G4int, G4double>, KM3TableBuilder *>::iterator it;
+    for (it = builders.begin(); it != builders.end(); ++it) {
+      if (it->first.first != particles[ip]) continue;
+      it->second->Finalize(&block[0], threads);
+      outfile.write((const char *)&block[0], block.size() * sizeof(G4float));
+      G4cout << "Wrote particle " << particles[ip] << " at "
+             << it->first.second << " GeV ("
+             << it->second->NumberOfEvents << " events)" << G4endl;
+      delete it->second;
+    }
+  }
+  outfile.close();
+  if (!outfile.good())
+    G4Exception("Error writing parametrization table", "", FatalException,
+                "");
+}
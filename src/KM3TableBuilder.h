@@ -0,0 +1,100 @@
+#ifndef KM3TableBuilder_h
+#define KM3TableBuilder_h 1
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+
+class KM3Cathods;
+
+// histograms of one (distance, angle) bin of a table, summed over the
+// events and the OMs that fall in it
+struct KM3TableCell {
+  G4double Exposures;  // number of OM-events
+  G4double Sum;        // of the photoelectrons per OM-event
+  G4double Sum2;
+  // weight, weighted theta and phi offsets inside the bin, for every
+  // direction bin in turn
+  std::vector<G4double> Direction;
+  // weights of the time bins of every time solid angle bin in turn
+  std::vector<G4double> Time;
+};
+
+// Builds the EM and hadronic shower parametrization tables from the full
+// simulation of the configured water and detector. Mono-energetic
+// particles are injected at Vertex in a set of orientations that are
+// cycled from one event to the next, and the photons reaching a cathod
+// are histogrammed in the (distance, angle, direction, time) bins of
+// KM3EMTimePointDis before the angular acceptance, which the samplers
+// apply again. The detector should have OMs at all the distances and
+// angles of the grid, e.g. a dense lattice around the vertex.
+//
+// A job saves the raw histograms of one particle and energy. The partial
+// files of many jobs (same or different energies) are summed by Merge,
+// which normalizes the cells in parallel and writes a table in the format
+// the samplers load.
+class KM3TableBuilder {
+ public:
+  KM3TableBuilder();
+  ~KM3TableBuilder();
+
+  // the grid the samplers read
+  static const G4int NumberOfDistances = 40;
+  static const G4int NumberOfAngles = 51;
+
+  G4int Particle;    // PDG code
+  G4double Energy;   // kinetic
+  G4ThreeVector Vertex;
+  G4int NumberOfOrientations;
+  // the distances are log spaced between these
+  G4double DistanceMin;
+  G4double DistanceMax;
+
+  // the events to inject, in the evt format of HOURSevtRead
+  void WriteInjectionFile(const std::string &evtFile, G4int nevents);
+  // once the detector is built
+  void Initialize(KM3Cathods *aCathods, G4double aMaxQE,
+                  G4double aSpeedAtMaxQE, G4double aTotCathodArea);
+  // a photon (time and direction of flight) reaching a cathod
+  void AddPhoton(G4int cathodId, G4double time,
+                 const G4ThreeVector &direction);
+  void EndOfEvent();
+  void Save(const std::string &aFile) const;
+
+  static void Merge(const std::vector<std::string> &partials,
+                    const std::string &TableOut, G4int threads);
+
+ private:
+  // where an OM sits for the orientation of the current event
+  struct OMGeometry {
+    G4int Cell;
+    G4double Scale;  // to the flux at the distance of the cell
+    G4double DirectTime;
+    G4ThreeVector X, Y, Z;
+    G4double Sum;
+  };
+
+  void MakeGrid();
+  void PrepareEvent();
+  KM3TableCell *GetCell(G4int icell);
+  void Read(std::ifstream &infile, const std::string &aFile);
+  void Finalize(G4float *block, G4int threads) const;
+  void FinalizeCell(G4int icell, G4float *out) const;
+
+  KM3Cathods *allCathods;
+  G4double MaxQE;
+  G4double SpeedAtMaxQE;
+  G4double TotCathodArea;
+  G4int NumberOfEvents;
+  std::vector<G4ThreeVector> Orientations;
+  std::vector<G4double> Distances;
+  std::vector<G4double> Angles;
+  std::vector<KM3TableCell *> Cells;
+  std::vector<G4int> CathodOM;
+  std::vector<OMGeometry> OMs;
+  G4bool EventPrepared;
+};
+
+#endif
@@ -5,15 +5,20 @@
 #include "G4Track.hh"
 #include "G4Allocator.hh"
 #include "G4VUserTrackInformation.hh"
+#include "KM3Provenance.h"
 
+// Explicit provenance for tracks that do not descend from a tracked
+// parent (e.g. photons injected by a parametrization). Everything else
+// gets its provenance from the table of KM3TrackingAction.
 class KM3TrackInformation : public G4VUserTrackInformation {
  public:
-  KM3TrackInformation();
-  KM3TrackInformation(const G4Track *aTrack);
-  KM3TrackInformation(const KM3TrackInformation *aTrackInfo);
-  void SetMoreInformation(const G4Track *aTrack);                  // newmie
-  void SetMoreInformation(const KM3TrackInformation *aTrackInfo);  // newmie
-  ~KM3TrackInformation();
+  KM3TrackInformation(G4int aProvenance = 0, G4double anEnergy = 0.0,
+                      G4int aRealisation = 0)
+      : Provenance(aProvenance),
+        OriginalEnergy(anEnergy),
+        Realisation(aRealisation),
+        Scatters(0) {}
+  ~KM3TrackInformation() {}
 
   inline void *operator new(size_t);
   inline void operator delete(void *aTrackInfo);
@@ -23,25 +28,10 @@ class KM3TrackInformation : public G4VUserTrackInformation {
 
   void Print() const;
 
- private:
-  G4String originalTrackCreatorProcess;
-  G4String originalparticleName;
-  G4double originalEnergy;
-  G4int originalParentID;
-  G4bool EmittedAsScattered;  // newmie
-
- public:
-  inline G4String GetOriginalTrackCreatorProcess() const {
-    return originalTrackCreatorProcess;
-  }
-  inline G4String GetOriginalParticleName() const {
-    return originalparticleName;
-  }
-  inline G4double GetOriginalEnergy() const { return originalEnergy; }
-  inline G4int GetOriginalParentID() const { return originalParentID; }
-  inline G4bool GetEmittedAsScattered() const {
-    return EmittedAsScattered;
-  }  // newmie
+  G4int Provenance;          // packed, see KM3Provenance
+  G4double OriginalEnergy;   // total energy of the first generation ancestor
+  G4int Realisation;         // optical realisation of a photon, see KM3SD
+  G4int Scatters;            // Mie scatters of a photon, see G4OpMie
 };
 
 extern G4Allocator<KM3TrackInformation> aTrackInformationAllocator;
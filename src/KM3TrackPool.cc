@@ -0,0 +1,67 @@
+#include "KM3TrackPool.h"
+#include "G4Track.hh"
+#include "G4DynamicParticle.hh"
+#include "G4ios.hh"
+#include "KM3TrackInformation.h"
+
+KM3TrackPool::KM3TrackPool() {
+  PageFactor = 64;
+  RetainSize = 256.0 * 1024 * 1024;
+  PagesSet = false;
+  NumberOfEvents = 0;
+  NumberOfReleases = 0;
+  HighWater = 0;
+  HighWaterEvent = -1;
+}
+
+KM3TrackPool::~KM3TrackPool() { Print(); }
+
+size_t KM3TrackPool::AllocatedSize() const {
+  size_t size = aTrackInformationAllocator.GetAllocatedSize();
+  if (aTrackAllocator() != NULL) size += aTrackAllocator()->GetAllocatedSize();
+  if (pDynamicParticleAllocator() != NULL)
+    size += pDynamicParticleAllocator()->GetAllocatedSize();
+  return size;
+}
+
+void KM3TrackPool::EndOfEvent() {
+  // the pools never give pages back before a reset, so their size now
+  // is the high water mark of this event
+  size_t size = AllocatedSize();
+  if (size > HighWater) {
+    HighWater = size;
+    HighWaterEvent = NumberOfEvents;
+  }
+  NumberOfEvents++;
+
+  // the allocators are created with the first track, so the page size
+  // can only be changed here. IncreasePageSize also empties the pool,
+  // which is fine since no track is alive
+  if (!PagesSet) {
+    PagesSet = true;
+    if (PageFactor > 1) {
+      aTrackInformationAllocator.IncreasePageSize(PageFactor);
+      if (aTrackAllocator() != NULL)
+        aTrackAllocator()->IncreasePageSize(PageFactor);
+      if (pDynamicParticleAllocator() != NULL)
+        pDynamicParticleAllocator()->IncreasePageSize(PageFactor);
+      return;
+    }
+  }
+
+  if (size > RetainSize) {
+    aTrackInformationAllocator.ResetStorage();
+    if (aTrackAllocator() != NULL) aTrackAllocator()->ResetStorage();
+    if (pDynamicParticleAllocator() != NULL)
+      pDynamicParticleAllocator()->ResetStorage();
+    NumberOfReleases++;
+  }
+}
+
+void KM3TrackPool::Print() const {
+  if (NumberOfEvents == 0) return;
+  G4cout << "Track pools: high water " << HighWater / (1024.0 * 1024.0)
+         << " MB in event " << HighWaterEvent << ", released after "
+         << NumberOfReleases << " of " << NumberOfEvents << " events"
+         << G4endl;
+}
@@ -0,0 +1,37 @@
+#ifndef KM3TrackPool_h
+#define KM3TrackPool_h 1
+
+#include "globals.hh"
+
+// Event scoped pooling of the track objects. Geant4 already takes
+// G4Track, G4DynamicParticle (and our KM3TrackInformation) from
+// G4Allocator free lists, which keep every page they ever used. Here the
+// pages are made much larger, so that tens of millions of optical
+// photons cost few mallocs, and at the end of an event the pools are
+// released in bulk once they hold more than RetainSize, so that one
+// bright event does not keep the memory for the rest of the run.
+class KM3TrackPool {
+ public:
+  KM3TrackPool();
+  ~KM3TrackPool();
+
+  // called when all tracks of the event are gone
+  void EndOfEvent();
+  void Print() const;
+
+  // default page sizes are multiplied by this
+  G4int PageFactor;
+  // bytes kept in the pools from one event to the next
+  G4double RetainSize;
+
+ private:
+  size_t AllocatedSize() const;
+
+  G4bool PagesSet;
+  G4int NumberOfEvents;
+  G4int NumberOfReleases;
+  size_t HighWater;      // largest pool size at the end of an event
+  G4int HighWaterEvent;
+};
+
+#endif
@@ -2,76 +2,41 @@
 #include "G4TrackingManager.hh"
 #include "G4Track.hh"
 #include "G4TrackVector.hh"
-#include "KM3TrackInformation.h"
+#include "G4OpticalPhoton.hh"
+#include "KM3Provenance.h"
+
+using CLHEP::m;
 
 void KM3TrackingAction::PreUserTrackingAction(const G4Track *aTrack) {
-#ifdef G4TRACK_INFORMATION
-  if (aTrack->GetParentID() > 0 &&
-      aTrack->GetParentID() <= numofInitialParticles) {
-    if (aTrack->GetUserInformation() == 0) {
-      KM3TrackInformation *anInfo = new KM3TrackInformation(aTrack);
-      G4Track *theTrack = (G4Track *)aTrack;
-      theTrack->SetUserInformation(anInfo);
-      // write info on evt file about the muon capture or decay secondaries
-      G4String theCreatorProcess =
-          aTrack->GetCreatorProcess()->GetProcessName();
-      if ((theCreatorProcess == "Decay") ||
-          (theCreatorProcess == "muMinusCaptureAtRest")) {
-        G4int trackID = aTrack->GetTrackID();
-        G4int parentID = aTrack->GetParentID();
-        G4ThreeVector pos = aTrack->GetPosition();
-        G4ThreeVector ddd = aTrack->GetMomentumDirection();
-        G4double TotalEnergy = aTrack->GetTotalEnergy();
-        G4double time = aTrack->GetGlobalTime();
-        G4int idPDG = aTrack->GetDefinition()->GetPDGEncoding();
-        TheEVTtoWrite->AddMuonDecaySecondaries(
-            trackID, parentID, pos[0] / m, pos[1] / m, pos[2] / m, ddd[0],
-            ddd[1], ddd[2], TotalEnergy, time, idPDG);
-      }
-    } else {
-      //      if(aTrack->GetDefinition()==G4OpticalPhoton::OpticalPhotonDefinition()){
-      KM3TrackInformation *info =
-          (KM3TrackInformation *)(aTrack->GetUserInformation());
-      if (info->GetEmittedAsScattered() && info->GetOriginalEnergy() == 0.0) {
-        info->SetMoreInformation(aTrack);
-      }
-      //      }
-    }
-  }
-#else
-  ;
-#endif
-}
+  if (aTrack->GetDefinition() == G4OpticalPhoton::OpticalPhotonDefinition())
+    return;
 
-void KM3TrackingAction::PostUserTrackingAction(const G4Track *aTrack) {
-#ifdef G4TRACK_INFORMATION
-  if (aTrack->GetParentID() > 0) {
-    G4TrackVector *secondaries = fpTrackingManager->GimmeSecondaries();
-    if (secondaries) {
-      KM3TrackInformation *info =
-          (KM3TrackInformation *)(aTrack->GetUserInformation());
-      size_t nSeco = secondaries->size();
-      if (nSeco > 0) {
-        for (size_t i = 0; i < nSeco; i++) {
-          if ((*secondaries)[i]->GetUserInformation() == 0) {
-            KM3TrackInformation *infoNew = new KM3TrackInformation(info);
-            (*secondaries)[i]->SetUserInformation(infoNew);
-          } else {
-            //        if((*secondaries)[i]->GetDefinition()==G4OpticalPhoton::OpticalPhotonDefinition()){
-            KM3TrackInformation *infoNew =
-                (KM3TrackInformation *)((*secondaries)[i]
-                                            ->GetUserInformation());
-            if (infoNew->GetEmittedAsScattered() &&
-                infoNew->GetOriginalEnergy() == 0.0) {
-              infoNew->SetMoreInformation(info);
-            }
-            //        }
-          }
-        }
-      }
+  G4int trackID = aTrack->GetTrackID();
+  G4int parentID = aTrack->GetParentID();
+  G4int provenance;
+  if (parentID == 0) {
+    // light emitted by the primary itself
+    provenance = KM3Provenance::Pack(trackID, KM3Provenance::kCherenkov);
+  } else if (parentID <= numofInitialParticles) {
+    // first generation: remember what created it
+    G4int creator = KM3Provenance::CreatorCode(aTrack->GetCreatorProcess());
+    provenance = KM3Provenance::Pack(parentID, creator);
+    // write info on evt file about the muon capture or decay secondaries
+    if ((creator == KM3Provenance::kDecay) ||
+        (creator == KM3Provenance::kCapture)) {
+      G4ThreeVector pos = aTrack->GetPosition();
+      G4ThreeVector ddd = aTrack->GetMomentumDirection();
+      G4double TotalEnergy = aTrack->GetTotalEnergy();
+      G4double time = aTrack->GetGlobalTime();
+      G4int idPDG = aTrack->GetDefinition()->GetPDGEncoding();
+      TheEVTtoWrite->AddMuonDecaySecondaries(
+          trackID, parentID, pos[0] / m, pos[1] / m, pos[2] / m, ddd[0],
+          ddd[1], ddd[2], TotalEnergy, time, idPDG);
     }
+  } else {
+    provenance = GetProvenance(parentID);
   }
-#else
-  ;
-#endif
+  theProvenance[trackID] = provenance;
 }
+
+void KM3TrackingAction::PostUserTrackingAction(const G4Track *) { ; }
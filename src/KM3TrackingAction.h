@@ -4,6 +4,7 @@
 #include "G4UserTrackingAction.hh"
 #include "KM3EvtIO.h"
 #include "G4Types.hh"
+#include <unordered_map>
 
 class KM3TrackingAction : public G4UserTrackingAction {
  public:
@@ -13,9 +14,24 @@ class KM3TrackingAction : public G4UserTrackingAction {
   virtual void PreUserTrackingAction(const G4Track *);
   virtual void PostUserTrackingAction(const G4Track *);
 
+  // packed provenance (see KM3Provenance) of a track of this event,
+  // 0 if it is unknown. Optical photons are not stored, they use the
+  // entry of their parent
+  G4int GetProvenance(G4int trackID) const;
+  void ClearProvenance() { theProvenance.clear(); }
+
  public:
   int numofInitialParticles;
   KM3EvtIO *TheEVTtoWrite;
+
+ private:
+  std::unordered_map<G4int, G4int> theProvenance;
 };
 
+inline G4int KM3TrackingAction::GetProvenance(G4int trackID) const {
+  std::unordered_map<G4int, G4int>::const_iterator it =
+      theProvenance.find(trackID);
+  return (it == theProvenance.end()) ? 0 : it->second;
+}
+
 #endif
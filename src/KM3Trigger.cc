@@ -0,0 +1,115 @@
+#include "KM3Trigger.h"
+#include "KM3Cathods.h"
+#include "G4ios.hh"
+#include "KM3Evaluator.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+using CLHEP::ns;
+
+namespace {
+// by DOM, then time
+bool DOMFirst(const std::pair<G4double, G4int> &a,
+              const std::pair<G4double, G4int> &b) {
+  if (a.second != b.second) return a.second < b.second;
+  return a.first < b.first;
+}
+}
+
+KM3Trigger::KM3Trigger() {
+  L1Window = 10.0 * ns;
+  L1Multiplicity = 2;
+  TriggerWindow = 1000.0 * ns;
+  TriggerDOMs = 3;
+  Mode = kSummary;
+  MaxDOMs = 0;
+}
+
+void KM3Trigger::Initialize(KM3Cathods *aCathods) {
+  CathodOM.assign(aCathods->GetNumberOfCathods(), -1);
+  for (G4int iom = 0; iom < aCathods->GetNumberOfOMs(); iom++) {
+    const OpticalModule &anOM = aCathods->GetOM(iom);
+    for (size_t ic = 0; ic < anOM.CathodIds.size(); ic++)
+      CathodOM[anOM.CathodIds[ic]] = iom;
+  }
+}
+
+void KM3Trigger::ReadModel(const std::string &aFile) {
+  std::ifstream infile(aFile.c_str());
+  if (!infile.good())
+    G4Exception("Error opening the trigger file", "", FatalException, "");
+
+  KM3Evaluator fCalc(aFile);
+  G4int nline = 0;
+  std::string line;
+  while (std::getline(infile, line)) {
+    nline++;
+    std::istringstream iss(line);
+    std::string name, value;
+    if (!(iss >> name) || (name[0] == '#')) continue;
+    if (!(iss >> value))
+      G4Exception("Incomplete line in the trigger file", "", FatalException,
+                  "");
+    G4double x = fCalc.Evaluate(value, nline);
+    if (name == "L1_WINDOW")
+      L1Window = x;
+    else if (name == "L1_MULTIPLICITY")
+      L1Multiplicity = (G4int)x;
+    else if (name == "TRIGGER_WINDOW")
+      TriggerWindow = x;
+    else if (name == "TRIGGER_DOMS")
+      TriggerDOMs = (G4int)x;
+    else
+      G4Exception("Unknown parameter in the trigger file", "", FatalException,
+                  "");
+  }
+  if ((L1Multiplicity < 2) || (TriggerDOMs < 1))
+    G4Exception("Trigger multiplicities out of range", "", FatalException, "");
+}
+
+G4bool KM3Trigger::Process(const std::vector<KM3Hit *> &hits) {
+  DOMHits.clear();
+  L1s.clear();
+  MaxDOMs = 0;
+  for (size_t i = 0; i < hits.size(); i++) {
+    if (hits[i]->GetMany() == 0) continue;
+    G4int iom = CathodOM[hits[i]->GetCathodId()];
+    if (iom >= 0)
+      DOMHits.push_back(std::make_pair(hits[i]->GetTime(), iom));
+  }
+  std::sort(DOMHits.begin(), DOMHits.end(), DOMFirst);
+
+  // the L1s of every DOM, one per group of hits
+  size_t i = 0;
+  while (i < DOMHits.size()) {
+    size_t j = i + 1;
+    while ((j < DOMHits.size()) && (DOMHits[j].second == DOMHits[i].second) &&
+           (DOMHits[j].first - DOMHits[i].first <= L1Window))
+      j++;
+    if (G4int(j - i) >= L1Multiplicity) {
+      L1s.push_back(DOMHits[i]);
+      i = j;
+    } else {
+      i++;
+    }
+  }
+  if (L1s.empty()) return false;
+
+  // the DOMs with an L1 in the window from every L1
+  std::sort(L1s.begin(), L1s.end());
+  size_t last = 0;
+  for (i = 0; i < L1s.size(); i++) {
+    while ((last < L1s.size()) &&
+           (L1s[last].first - L1s[i].first <= TriggerWindow))
+      last++;
+    WindowDOMs.clear();
+    for (size_t k = i; k < last; k++) WindowDOMs.push_back(L1s[k].second);
+    std::sort(WindowDOMs.begin(), WindowDOMs.end());
+    G4int n = std::unique(WindowDOMs.begin(), WindowDOMs.end()) -
+              WindowDOMs.begin();
+    if (n > MaxDOMs) MaxDOMs = n;
+  }
+  return MaxDOMs >= TriggerDOMs;
+}
@@ -0,0 +1,59 @@
+#ifndef KM3Trigger_h
+#define KM3Trigger_h 1
+
+#include <string>
+#include <vector>
+#include <utility>
+#include "globals.hh"
+#include "KM3Hit.h"
+
+class KM3Cathods;
+
+// A simple emulation of the trigger, run on the merged hits of an event
+// (with the background, if any) to decide what is written of it.
+//
+// An L1 is a DOM with at least L1Multiplicity hits within L1Window. The
+// event triggers when L1s on at least TriggerDOMs different DOMs fall
+// within TriggerWindow. There is no causality check between the DOMs.
+class KM3Trigger {
+ public:
+  // what is written of an event that does not trigger
+  enum Untriggered {
+    kFull,     // everything, as a triggered one
+    kSummary,  // the event and the number of hits, without the hits
+    kNothing   // the event is dropped
+  };
+
+  KM3Trigger();
+  ~KM3Trigger() {};
+
+  // the DOMs of the cathods
+  void Initialize(KM3Cathods *aCathods);
+  // overrides the parameters from a file of "<name> <value>" lines, with
+  // names L1_WINDOW, L1_MULTIPLICITY, TRIGGER_WINDOW and TRIGGER_DOMS.
+  // Values are expressions with Geant4 units (e.g. 10*ns), lines
+  // starting with # are comments
+  void ReadModel(const std::string &aFile);
+
+  // true if the event triggers, the merged hits (Many 0) are skipped
+  G4bool Process(const std::vector<KM3Hit *> &hits);
+  G4int GetNumberOfL1() const { return L1s.size(); };
+  // the most DOMs with an L1 within one trigger window
+  G4int GetNumberOfTriggerDOMs() const { return MaxDOMs; };
+
+  G4double L1Window;
+  G4int L1Multiplicity;
+  G4double TriggerWindow;
+  G4int TriggerDOMs;
+  Untriggered Mode;
+
+ private:
+  std::vector<G4int> CathodOM;
+  // (time, DOM) of the hits and of the L1s
+  std::vector<std::pair<G4double, G4int> > DOMHits;
+  std::vector<std::pair<G4double, G4int> > L1s;
+  std::vector<G4int> WindowDOMs;
+  G4int MaxDOMs;
+};
+
+#endif
@@ -206,6 +206,11 @@ class event {
     */
   unsigned write(std::ostream& os);
 
+  /**
+    * @return all data words of the current event, sorted by tag
+    */
+  const ev_multimap& data() const { return evdata; }
+
   /**
     * delete all data words for specified tag
     * @param dt data tag which will be deleted